@@ -0,0 +1,64 @@
+#include "Arena.h"
+
+#include <algorithm>
+
+using namespace std;
+
+Arena::Arena(size_t blockSize)
+    : _blockSize(blockSize)
+    , _blocks()
+    , _current(0)
+    , _offset(0)
+{
+}
+
+void * Arena::Allocate(size_t size, size_t alignment)
+{
+    for (;;)
+    {
+        if (_current < _blocks.size())
+        {
+            Block & block = _blocks[_current];
+            uintptr_t address = reinterpret_cast<uintptr_t>(block.data.get()) + _offset;
+            size_t padding = (alignment - address % alignment) % alignment;
+            if (_offset + padding + size <= block.size)
+            {
+                _offset += padding + size;
+                return reinterpret_cast<void *>(address + padding);
+            }
+            if (_current + 1 < _blocks.size())
+            {
+                ++_current;
+                _offset = 0;
+                continue;
+            }
+        }
+        // Oversized requests get a block of their own, which is kept for reuse like any other
+        size_t blockSize = max(_blockSize, size + alignment);
+        _blocks.push_back(Block { unique_ptr<uint8_t[]>(new uint8_t[blockSize]), blockSize });
+        _current = _blocks.size() - 1;
+        _offset = 0;
+    }
+}
+
+void Arena::Reset()
+{
+    _current = 0;
+    _offset = 0;
+}
+
+size_t Arena::BytesUsed() const
+{
+    size_t result = _offset;
+    for (size_t index = 0; index < _current && index < _blocks.size(); ++index)
+        result += _blocks[index].size;
+    return result;
+}
+
+size_t Arena::Capacity() const
+{
+    size_t result = 0;
+    for (const Block & block : _blocks)
+        result += block.size;
+    return result;
+}
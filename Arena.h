@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for data that lives as long as one unit of work, such as the decoded form of one EIT section.
+// Memory is handed out from large blocks and given back all at once by Reset, which keeps the blocks, so once the
+// blocks have grown to the working set nothing is allocated any more. Nothing is constructed or destroyed: only
+// for trivially destructible types. Not thread safe; a decoder owns one and only runs on one thread.
+class Arena
+{
+public:
+    static const size_t DefaultBlockSize = 64 * 1024;
+
+    explicit Arena(size_t blockSize = DefaultBlockSize);
+
+    void * Allocate(size_t size, size_t alignment);
+    template <class T>
+    T * Allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena memory is released without destructors");
+        return static_cast<T *>(Allocate(count * sizeof(T), alignof(T)));
+    }
+    // Releases everything allocated, keeping the blocks
+    void Reset();
+
+    size_t BytesUsed() const;
+    size_t Capacity() const;
+
+private:
+    struct Block
+    {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+
+    Arena(const Arena &) = delete;
+    Arena & operator = (const Arena &) = delete;
+
+    size_t _blockSize;
+    std::vector<Block> _blocks;
+    // Block being allocated from, and the offset in it
+    size_t _current;
+    size_t _offset;
+};
@@ -0,0 +1,77 @@
+#include "ChunkEdges.h"
+
+#include "PidDispatcher.h"
+
+using namespace std;
+
+ChunkEdges::ChunkEdges()
+    : _edges()
+{
+}
+
+void ChunkEdges::AddPacket(const uint8_t * packet)
+{
+    uint16_t pid = PidDispatcher::PacketPID(packet);
+    auto edges = _edges.begin();
+    while ((edges != _edges.end()) && (edges->pid != pid))
+        ++edges;
+    if (edges == _edges.end())
+        edges = _edges.insert(_edges.end(), Edges { pid, false, {}, {} });
+
+    bool startsSection = (packet[1] & 0x40) != 0;
+    if (!edges->headComplete)
+    {
+        edges->head.insert(edges->head.end(), packet, packet + PacketSize);
+        edges->headComplete = startsSection || (edges->head.size() >= MaxEdgePackets * PacketSize);
+    }
+    if (startsSection)
+        edges->tail.clear();
+    else if (edges->tail.empty() || (edges->tail.size() >= MaxEdgePackets * PacketSize))
+    {
+        // Nothing started in this chunk yet, or longer than any section: no use keeping it
+        edges->tail.clear();
+        return;
+    }
+    edges->tail.insert(edges->tail.end(), packet, packet + PacketSize);
+}
+
+void ChunkEdges::Stitch(const ChunkEdges & next, vector<uint8_t> & packets) const
+{
+    for (const Edges & tail : _edges)
+    {
+        for (const Edges & head : next._edges)
+        {
+            if ((head.pid != tail.pid) || tail.tail.empty())
+                continue;
+            packets.insert(packets.end(), tail.tail.begin(), tail.tail.end());
+            packets.insert(packets.end(), head.head.begin(), head.head.end());
+        }
+    }
+}
+
+PacketListSource::PacketListSource(const vector<uint8_t> & packets)
+    : _packets(packets)
+    , _next(0)
+    , _startTime(chrono::steady_clock::now())
+{
+}
+
+const uint8_t * PacketListSource::NextPacket()
+{
+    if ((_next + 1) * ChunkEdges::PacketSize > _packets.size())
+        return nullptr;
+    return _packets.data() + _next++ * ChunkEdges::PacketSize;
+}
+
+double PacketListSource::ElapsedSeconds() const
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - _startTime).count();
+}
+
+double PacketListSource::ThroughputMBps() const
+{
+    double elapsed = ElapsedSeconds();
+    if (elapsed <= 0)
+        return 0;
+    return static_cast<double>(BytesConsumed()) / (1000.0 * 1000.0) / elapsed;
+}
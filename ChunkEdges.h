@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "PacketSource.h"
+#include "Section.h"
+
+// The packets of the subscribed PIDs at the start and at the end of one chunk of a file that is scanned in
+// chunks, so the sections that span the boundary between two chunks can be put together afterwards.
+// Per PID the head holds the packets up to and including the first one that starts a section, the tail those from
+// the last packet that starts a section on. The tail of one chunk followed by the head of the next one holds
+// every section cut by the boundary; the continuity counters tell whether the two fit.
+class ChunkEdges
+{
+public:
+    static const size_t PacketSize = 188;
+    // More packets than the longest section takes
+    static const size_t MaxEdgePackets = SectionHeader::MaxSectionSize / 184 + 2;
+
+    ChunkEdges();
+
+    // Called with every packet of the chunk on a PID that is decoded, in order
+    void AddPacket(const uint8_t * packet);
+
+    // Appends the packets that cross the boundary from this chunk to next: this chunk's tails and the next
+    // chunk's heads, PID by PID
+    void Stitch(const ChunkEdges & next, std::vector<uint8_t> & packets) const;
+
+private:
+    struct Edges
+    {
+        uint16_t pid;
+        bool headComplete;
+        std::vector<uint8_t> head;
+        std::vector<uint8_t> tail;
+    };
+
+    // Few PIDs carry SI, a linear search is fastest
+    std::vector<Edges> _edges;
+};
+
+// Packets held in memory, as the input of a parser
+class PacketListSource : public PacketSource
+{
+public:
+    explicit PacketListSource(const std::vector<uint8_t> & packets);
+
+    const uint8_t * NextPacket() override;
+    uint64_t PacketsRead() const override { return _next; }
+    uint64_t BytesConsumed() const override { return _next * ChunkEdges::PacketSize; }
+    double ElapsedSeconds() const override;
+    double ThroughputMBps() const override;
+    void AppendMetrics(OutputBuffer &) const override {}
+
+private:
+    const std::vector<uint8_t> & _packets;
+    size_t _next;
+    std::chrono::steady_clock::time_point _startTime;
+};
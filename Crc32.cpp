@@ -0,0 +1,63 @@
+#include "Crc32.h"
+
+namespace {
+
+// Slice-by-8 tables: entries[0] is the classic byte table, entries[k][i] is the CRC of byte i followed by k zero
+// bytes, so eight bytes can be folded in with eight independent lookups
+struct Crc32Tables
+{
+    uint32_t entries[8][256];
+
+    Crc32Tables()
+    {
+        for (uint32_t index = 0; index < 256; ++index)
+        {
+            uint32_t crc = index << 24;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : (crc << 1);
+            entries[0][index] = crc;
+        }
+        for (int slice = 1; slice < 8; ++slice)
+        {
+            for (uint32_t index = 0; index < 256; ++index)
+            {
+                uint32_t crc = entries[slice - 1][index];
+                entries[slice][index] = (crc << 8) ^ entries[0][crc >> 24];
+            }
+        }
+    }
+};
+
+const Crc32Tables & Tables()
+{
+    static const Crc32Tables tables;
+    return tables;
+}
+
+} // namespace
+
+uint32_t Crc32::Compute(const uint8_t * data, size_t size, uint32_t crc)
+{
+    const Crc32Tables & tables = Tables();
+    const uint32_t (* table)[256] = tables.entries;
+    while (size >= 8)
+    {
+        uint32_t high = crc ^ ((uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) |
+                               (uint32_t(data[2]) << 8) | data[3]);
+        uint32_t low = (uint32_t(data[4]) << 24) | (uint32_t(data[5]) << 16) | (uint32_t(data[6]) << 8) | data[7];
+        crc = table[7][high >> 24] ^ table[6][(high >> 16) & 0xFF] ^ table[5][(high >> 8) & 0xFF] ^
+              table[4][high & 0xFF] ^ table[3][low >> 24] ^ table[2][(low >> 16) & 0xFF] ^
+              table[1][(low >> 8) & 0xFF] ^ table[0][low & 0xFF];
+        data += 8;
+        size -= 8;
+    }
+    return ComputeBytewise(data, size, crc);
+}
+
+uint32_t Crc32::ComputeBytewise(const uint8_t * data, size_t size, uint32_t crc)
+{
+    const uint32_t * table = Tables().entries[0];
+    for (size_t index = 0; index < size; ++index)
+        crc = (crc << 8) ^ table[(crc >> 24) ^ data[index]];
+    return crc;
+}
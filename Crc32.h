@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC_32 of MPEG-2 sections (ISO/IEC 13818-1 annex A): polynomial 0x04C11DB7, initial value 0xFFFFFFFF, not
+// reflected, no final XOR. Computed over a complete section including its CRC_32 field the result is 0.
+class Crc32
+{
+public:
+    static const uint32_t InitialValue = 0xFFFFFFFF;
+
+    // Slice-by-8: eight table lookups per eight bytes, without a dependency between them
+    static uint32_t Compute(const uint8_t * data, size_t size, uint32_t crc = InitialValue);
+    // One table lookup per byte, the reference for Compute
+    static uint32_t ComputeBytewise(const uint8_t * data, size_t size, uint32_t crc = InitialValue);
+    // True if the section ends in a correct CRC_32
+    static bool Check(const uint8_t * section, size_t size) { return (size >= 4) && (Compute(section, size) == 0); }
+};
@@ -0,0 +1,127 @@
+#include "Descriptors.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const char * const ContentGenreNames[16] =
+{
+    nullptr, "movie", "news", "show", "sports", "children", "music", "arts",
+    "social", "education", "leisure", "special", nullptr, nullptr, nullptr, "user",
+};
+
+// Reads a length prefixed field at offset, advancing offset past it
+bool ReadLengthPrefixed(const uint8_t * data, size_t length, size_t & offset, ByteView & result)
+{
+    if (offset >= length)
+        return false;
+    size_t fieldLength = data[offset];
+    if (offset + 1 + fieldLength > length)
+        return false;
+    result = ByteView { data + offset + 1, fieldLength };
+    offset += 1 + fieldLength;
+    return true;
+}
+
+} // namespace
+
+bool NetworkNameDescriptor::Parse(const uint8_t * data, size_t length, NetworkNameDescriptor & result)
+{
+    result.name = ByteView { data, length };
+    return true;
+}
+
+bool ServiceDescriptor::Parse(const uint8_t * data, size_t length, ServiceDescriptor & result)
+{
+    if (length < 1)
+        return false;
+    result.serviceType = data[0];
+    size_t offset = 1;
+    return ReadLengthPrefixed(data, length, offset, result.providerName) &&
+           ReadLengthPrefixed(data, length, offset, result.serviceName);
+}
+
+bool ShortEventDescriptor::Parse(const uint8_t * data, size_t length, ShortEventDescriptor & result)
+{
+    if (length < 3)
+        return false;
+    result.language = data;
+    size_t offset = 3;
+    return ReadLengthPrefixed(data, length, offset, result.name) &&
+           ReadLengthPrefixed(data, length, offset, result.text);
+}
+
+bool ExtendedEventDescriptor::Parse(const uint8_t * data, size_t length, ExtendedEventDescriptor & result)
+{
+    if (length < 4)
+        return false;
+    result.number = data[0] >> 4;
+    result.lastNumber = data[0] & 0x0F;
+    result.language = data + 1;
+    size_t offset = 4;
+    return ReadLengthPrefixed(data, length, offset, result.items) &&
+           ReadLengthPrefixed(data, length, offset, result.text);
+}
+
+bool ExtendedEventDescriptor::NextItem(size_t & offset, ExtendedEventItem & item) const
+{
+    size_t next = offset;
+    if (!ReadLengthPrefixed(items.data, items.size, next, item.description) ||
+        !ReadLengthPrefixed(items.data, items.size, next, item.item))
+        return false;
+    offset = next;
+    return true;
+}
+
+bool ComponentDescriptor::Parse(const uint8_t * data, size_t length, ComponentDescriptor & result)
+{
+    if (length < 6)
+        return false;
+    result.streamContentExt = data[0] >> 4;
+    result.streamContent = data[0] & 0x0F;
+    result.componentType = data[1];
+    result.componentTag = data[2];
+    result.language = data + 3;
+    result.text = ByteView { data + 6, length - 6 };
+    return true;
+}
+
+bool ContentDescriptor::Parse(const uint8_t * data, size_t length, ContentDescriptor & result)
+{
+    if (length % 2 != 0)
+        return false;
+    result.entries = ByteView { data, length };
+    return true;
+}
+
+bool ParentalRatingDescriptor::Parse(const uint8_t * data, size_t length, ParentalRatingDescriptor & result)
+{
+    if (length % 4 != 0)
+        return false;
+    result.entries = ByteView { data, length };
+    return true;
+}
+
+const char * ContentGenreName(uint8_t level1)
+{
+    return ContentGenreNames[level1 & 0x0F];
+}
+
+bool ParseContentGenre(const char * text, uint8_t & level1)
+{
+    for (uint8_t genre = 0; genre < 16; ++genre)
+    {
+        if (ContentGenreNames[genre] && (strcmp(text, ContentGenreNames[genre]) == 0))
+        {
+            level1 = genre;
+            return true;
+        }
+    }
+    char * end = nullptr;
+    unsigned long value = strtoul(text, &end, 0);
+    if ((end == text) || (*end != '\0') || (value > 0x0F))
+        return false;
+    level1 = static_cast<uint8_t>(value);
+    return true;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class DescriptorTag : uint8_t
+{
+    NetworkNameDescriptor = 0x40,
+    ServiceListDescriptor = 0x41,
+    ServiceDescriptor = 0x48,
+    ShortEventDescriptor = 0x4D,
+    ExtendedEventDescriptor = 0x4E,
+    TimeShiftDescriptor = 0x4F,
+    ComponentDescriptor = 0x50,
+    ContentDescriptor = 0x54,
+    ParentalRatingDescriptor = 0x55,
+};
+
+enum class StreamContentType : uint8_t
+{
+    Reserved = 0x0,
+    MPEG2Video = 0x1,
+    MPEGAudio = 0x2,
+    DVBSubtitles = 0x3,
+    AC3Audio = 0x4,
+    H264Video = 0x5,
+    HE_AACAudio = 0x6,
+    DTSAudio = 0x7,
+    DVB_SRMData = 0x8,
+    HEVCVideo = 0x9,
+    Reserved2 = 0xA,
+    Reserved3 = 0xB,
+    UserDefined1 = 0xC,
+    UserDefined2 = 0xD,
+    UserDefined3 = 0xE,
+    UserDefined4 = 0xF,
+};
+
+// Bytes inside a descriptor (or section) buffer. Never owns the data.
+struct ByteView
+{
+    const uint8_t * data;
+    size_t size;
+
+    bool Empty() const { return size == 0; }
+    const char * Chars() const { return reinterpret_cast<const char *>(data); }
+};
+
+// Typed views on EN 300 468 descriptors. Parse checks every field against the descriptor length and returns
+// false for a malformed descriptor; nothing is copied or allocated, all views point into the descriptor data.
+// Text fields still carry their DVB character set selector.
+
+// 0x40
+struct NetworkNameDescriptor
+{
+    ByteView name;
+
+    static bool Parse(const uint8_t * data, size_t length, NetworkNameDescriptor & result);
+};
+
+// 0x48
+struct ServiceDescriptor
+{
+    uint8_t serviceType;
+    ByteView providerName;
+    ByteView serviceName;
+
+    static bool Parse(const uint8_t * data, size_t length, ServiceDescriptor & result);
+};
+
+// 0x4D
+struct ShortEventDescriptor
+{
+    const uint8_t * language;   // ISO 639-2, 3 characters
+    ByteView name;
+    ByteView text;
+
+    static bool Parse(const uint8_t * data, size_t length, ShortEventDescriptor & result);
+};
+
+struct ExtendedEventItem
+{
+    ByteView description;
+    ByteView item;
+};
+
+// 0x4E. An event's extended text can be spread over up to 16 descriptors, numbered 0 to lastNumber.
+struct ExtendedEventDescriptor
+{
+    uint8_t number;
+    uint8_t lastNumber;
+    const uint8_t * language;
+    ByteView items;
+    ByteView text;
+
+    // Steps through the items; start with offset 0. Returns false after the last (or at a malformed) item.
+    bool NextItem(size_t & offset, ExtendedEventItem & item) const;
+
+    static bool Parse(const uint8_t * data, size_t length, ExtendedEventDescriptor & result);
+};
+
+// 0x50
+struct ComponentDescriptor
+{
+    uint8_t streamContentExt;
+    uint8_t streamContent;
+    uint8_t componentType;
+    uint8_t componentTag;
+    const uint8_t * language;
+    ByteView text;
+
+    static bool Parse(const uint8_t * data, size_t length, ComponentDescriptor & result);
+};
+
+// 0x54. Genre classification, two nibbles per entry (EN 300 468 table 29) plus a user byte.
+struct ContentDescriptor
+{
+    ByteView entries;
+
+    size_t Count() const { return entries.size / 2; }
+    uint8_t Level1(size_t index) const { return entries.data[index * 2] >> 4; }
+    uint8_t Level2(size_t index) const { return entries.data[index * 2] & 0x0F; }
+    uint8_t UserByte(size_t index) const { return entries.data[index * 2 + 1]; }
+
+    static bool Parse(const uint8_t * data, size_t length, ContentDescriptor & result);
+};
+
+// 0x55. Minimum age per country; rating values 0x01-0x0F mean an age of rating + 3.
+struct ParentalRatingDescriptor
+{
+    static const uint8_t MaxAgeRating = 0x0F;
+
+    ByteView entries;
+
+    size_t Count() const { return entries.size / 4; }
+    const uint8_t * Country(size_t index) const { return entries.data + index * 4; }
+    uint8_t Rating(size_t index) const { return entries.data[index * 4 + 3]; }
+
+    static unsigned MinimumAge(uint8_t rating) { return rating + 3u; }
+    static bool Parse(const uint8_t * data, size_t length, ParentalRatingDescriptor & result);
+};
+
+// Short name of a content_nibble_level_1 genre (EN 300 468 table 29), nullptr for undefined and reserved ones
+const char * ContentGenreName(uint8_t level1);
+// Genre by its short name or its number. Returns false for anything else.
+bool ParseContentGenre(const char * text, uint8_t & level1);
@@ -0,0 +1,536 @@
+#include "DvbText.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+// Upper halves (0xA0-0xFF) of ISO/IEC 8859 parts 1 to 15, as Unicode code points. 0 marks an unassigned position.
+const uint16_t ISO8859UpperHalf[16][96] =
+{
+    // unused
+    { 0 },
+    // ISO/IEC 8859-1
+    {
+        0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7, 0x00A8, 0x00A9, 0x00AA, 0x00AB,
+        0x00AC, 0x00AD, 0x00AE, 0x00AF, 0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+        0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF, 0x00C0, 0x00C1, 0x00C2, 0x00C3,
+        0x00C4, 0x00C5, 0x00C6, 0x00C7, 0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+        0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7, 0x00D8, 0x00D9, 0x00DA, 0x00DB,
+        0x00DC, 0x00DD, 0x00DE, 0x00DF, 0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+        0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF, 0x00F0, 0x00F1, 0x00F2, 0x00F3,
+        0x00F4, 0x00F5, 0x00F6, 0x00F7, 0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF,
+    },
+    // ISO/IEC 8859-2
+    {
+        0x00A0, 0x0104, 0x02D8, 0x0141, 0x00A4, 0x013D, 0x015A, 0x00A7, 0x00A8, 0x0160, 0x015E, 0x0164,
+        0x0179, 0x00AD, 0x017D, 0x017B, 0x00B0, 0x0105, 0x02DB, 0x0142, 0x00B4, 0x013E, 0x015B, 0x02C7,
+        0x00B8, 0x0161, 0x015F, 0x0165, 0x017A, 0x02DD, 0x017E, 0x017C, 0x0154, 0x00C1, 0x00C2, 0x0102,
+        0x00C4, 0x0139, 0x0106, 0x00C7, 0x010C, 0x00C9, 0x0118, 0x00CB, 0x011A, 0x00CD, 0x00CE, 0x010E,
+        0x0110, 0x0143, 0x0147, 0x00D3, 0x00D4, 0x0150, 0x00D6, 0x00D7, 0x0158, 0x016E, 0x00DA, 0x0170,
+        0x00DC, 0x00DD, 0x0162, 0x00DF, 0x0155, 0x00E1, 0x00E2, 0x0103, 0x00E4, 0x013A, 0x0107, 0x00E7,
+        0x010D, 0x00E9, 0x0119, 0x00EB, 0x011B, 0x00ED, 0x00EE, 0x010F, 0x0111, 0x0144, 0x0148, 0x00F3,
+        0x00F4, 0x0151, 0x00F6, 0x00F7, 0x0159, 0x016F, 0x00FA, 0x0171, 0x00FC, 0x00FD, 0x0163, 0x02D9,
+    },
+    // ISO/IEC 8859-3
+    {
+        0x00A0, 0x0126, 0x02D8, 0x00A3, 0x00A4, 0x0000, 0x0124, 0x00A7, 0x00A8, 0x0130, 0x015E, 0x011E,
+        0x0134, 0x00AD, 0x0000, 0x017B, 0x00B0, 0x0127, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x0125, 0x00B7,
+        0x00B8, 0x0131, 0x015F, 0x011F, 0x0135, 0x00BD, 0x0000, 0x017C, 0x00C0, 0x00C1, 0x00C2, 0x0000,
+        0x00C4, 0x010A, 0x0108, 0x00C7, 0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+        0x0000, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x0120, 0x00D6, 0x00D7, 0x011C, 0x00D9, 0x00DA, 0x00DB,
+        0x00DC, 0x016C, 0x015C, 0x00DF, 0x00E0, 0x00E1, 0x00E2, 0x0000, 0x00E4, 0x010B, 0x0109, 0x00E7,
+        0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF, 0x0000, 0x00F1, 0x00F2, 0x00F3,
+        0x00F4, 0x0121, 0x00F6, 0x00F7, 0x011D, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x016D, 0x015D, 0x02D9,
+    },
+    // ISO/IEC 8859-4
+    {
+        0x00A0, 0x0104, 0x0138, 0x0156, 0x00A4, 0x0128, 0x013B, 0x00A7, 0x00A8, 0x0160, 0x0112, 0x0122,
+        0x0166, 0x00AD, 0x017D, 0x00AF, 0x00B0, 0x0105, 0x02DB, 0x0157, 0x00B4, 0x0129, 0x013C, 0x02C7,
+        0x00B8, 0x0161, 0x0113, 0x0123, 0x0167, 0x014A, 0x017E, 0x014B, 0x0100, 0x00C1, 0x00C2, 0x00C3,
+        0x00C4, 0x00C5, 0x00C6, 0x012E, 0x010C, 0x00C9, 0x0118, 0x00CB, 0x0116, 0x00CD, 0x00CE, 0x012A,
+        0x0110, 0x0145, 0x014C, 0x0136, 0x00D4, 0x00D5, 0x00D6, 0x00D7, 0x00D8, 0x0172, 0x00DA, 0x00DB,
+        0x00DC, 0x0168, 0x016A, 0x00DF, 0x0101, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x012F,
+        0x010D, 0x00E9, 0x0119, 0x00EB, 0x0117, 0x00ED, 0x00EE, 0x012B, 0x0111, 0x0146, 0x014D, 0x0137,
+        0x00F4, 0x00F5, 0x00F6, 0x00F7, 0x00F8, 0x0173, 0x00FA, 0x00FB, 0x00FC, 0x0169, 0x016B, 0x02D9,
+    },
+    // ISO/IEC 8859-5
+    {
+        0x00A0, 0x0401, 0x0402, 0x0403, 0x0404, 0x0405, 0x0406, 0x0407, 0x0408, 0x0409, 0x040A, 0x040B,
+        0x040C, 0x00AD, 0x040E, 0x040F, 0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+        0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F, 0x0420, 0x0421, 0x0422, 0x0423,
+        0x0424, 0x0425, 0x0426, 0x0427, 0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+        0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437, 0x0438, 0x0439, 0x043A, 0x043B,
+        0x043C, 0x043D, 0x043E, 0x043F, 0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+        0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F, 0x2116, 0x0451, 0x0452, 0x0453,
+        0x0454, 0x0455, 0x0456, 0x0457, 0x0458, 0x0459, 0x045A, 0x045B, 0x045C, 0x00A7, 0x045E, 0x045F,
+    },
+    // ISO/IEC 8859-6
+    {
+        0x00A0, 0x0000, 0x0000, 0x0000, 0x00A4, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x060C, 0x00AD, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x061B, 0x0000, 0x0000, 0x0000, 0x061F, 0x0000, 0x0621, 0x0622, 0x0623,
+        0x0624, 0x0625, 0x0626, 0x0627, 0x0628, 0x0629, 0x062A, 0x062B, 0x062C, 0x062D, 0x062E, 0x062F,
+        0x0630, 0x0631, 0x0632, 0x0633, 0x0634, 0x0635, 0x0636, 0x0637, 0x0638, 0x0639, 0x063A, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0640, 0x0641, 0x0642, 0x0643, 0x0644, 0x0645, 0x0646, 0x0647,
+        0x0648, 0x0649, 0x064A, 0x064B, 0x064C, 0x064D, 0x064E, 0x064F, 0x0650, 0x0651, 0x0652, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // ISO/IEC 8859-7
+    {
+        0x00A0, 0x2018, 0x2019, 0x00A3, 0x20AC, 0x20AF, 0x00A6, 0x00A7, 0x00A8, 0x00A9, 0x037A, 0x00AB,
+        0x00AC, 0x00AD, 0x0000, 0x2015, 0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x0384, 0x0385, 0x0386, 0x00B7,
+        0x0388, 0x0389, 0x038A, 0x00BB, 0x038C, 0x00BD, 0x038E, 0x038F, 0x0390, 0x0391, 0x0392, 0x0393,
+        0x0394, 0x0395, 0x0396, 0x0397, 0x0398, 0x0399, 0x039A, 0x039B, 0x039C, 0x039D, 0x039E, 0x039F,
+        0x03A0, 0x03A1, 0x0000, 0x03A3, 0x03A4, 0x03A5, 0x03A6, 0x03A7, 0x03A8, 0x03A9, 0x03AA, 0x03AB,
+        0x03AC, 0x03AD, 0x03AE, 0x03AF, 0x03B0, 0x03B1, 0x03B2, 0x03B3, 0x03B4, 0x03B5, 0x03B6, 0x03B7,
+        0x03B8, 0x03B9, 0x03BA, 0x03BB, 0x03BC, 0x03BD, 0x03BE, 0x03BF, 0x03C0, 0x03C1, 0x03C2, 0x03C3,
+        0x03C4, 0x03C5, 0x03C6, 0x03C7, 0x03C8, 0x03C9, 0x03CA, 0x03CB, 0x03CC, 0x03CD, 0x03CE, 0x0000,
+    },
+    // ISO/IEC 8859-8
+    {
+        0x00A0, 0x0000, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7, 0x00A8, 0x00A9, 0x00D7, 0x00AB,
+        0x00AC, 0x00AD, 0x00AE, 0x00AF, 0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+        0x00B8, 0x00B9, 0x00F7, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x2017, 0x05D0, 0x05D1, 0x05D2, 0x05D3, 0x05D4, 0x05D5, 0x05D6, 0x05D7,
+        0x05D8, 0x05D9, 0x05DA, 0x05DB, 0x05DC, 0x05DD, 0x05DE, 0x05DF, 0x05E0, 0x05E1, 0x05E2, 0x05E3,
+        0x05E4, 0x05E5, 0x05E6, 0x05E7, 0x05E8, 0x05E9, 0x05EA, 0x0000, 0x0000, 0x200E, 0x200F, 0x0000,
+    },
+    // ISO/IEC 8859-9
+    {
+        0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7, 0x00A8, 0x00A9, 0x00AA, 0x00AB,
+        0x00AC, 0x00AD, 0x00AE, 0x00AF, 0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+        0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF, 0x00C0, 0x00C1, 0x00C2, 0x00C3,
+        0x00C4, 0x00C5, 0x00C6, 0x00C7, 0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+        0x011E, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7, 0x00D8, 0x00D9, 0x00DA, 0x00DB,
+        0x00DC, 0x0130, 0x015E, 0x00DF, 0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+        0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF, 0x011F, 0x00F1, 0x00F2, 0x00F3,
+        0x00F4, 0x00F5, 0x00F6, 0x00F7, 0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x0131, 0x015F, 0x00FF,
+    },
+    // ISO/IEC 8859-10
+    {
+        0x00A0, 0x0104, 0x0112, 0x0122, 0x012A, 0x0128, 0x0136, 0x00A7, 0x013B, 0x0110, 0x0160, 0x0166,
+        0x017D, 0x00AD, 0x016A, 0x014A, 0x00B0, 0x0105, 0x0113, 0x0123, 0x012B, 0x0129, 0x0137, 0x00B7,
+        0x013C, 0x0111, 0x0161, 0x0167, 0x017E, 0x2015, 0x016B, 0x014B, 0x0100, 0x00C1, 0x00C2, 0x00C3,
+        0x00C4, 0x00C5, 0x00C6, 0x012E, 0x010C, 0x00C9, 0x0118, 0x00CB, 0x0116, 0x00CD, 0x00CE, 0x00CF,
+        0x00D0, 0x0145, 0x014C, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x0168, 0x00D8, 0x0172, 0x00DA, 0x00DB,
+        0x00DC, 0x00DD, 0x00DE, 0x00DF, 0x0101, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x012F,
+        0x010D, 0x00E9, 0x0119, 0x00EB, 0x0117, 0x00ED, 0x00EE, 0x00EF, 0x00F0, 0x0146, 0x014D, 0x00F3,
+        0x00F4, 0x00F5, 0x00F6, 0x0169, 0x00F8, 0x0173, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x0138,
+    },
+    // ISO/IEC 8859-11
+    {
+        0x00A0, 0x0E01, 0x0E02, 0x0E03, 0x0E04, 0x0E05, 0x0E06, 0x0E07, 0x0E08, 0x0E09, 0x0E0A, 0x0E0B,
+        0x0E0C, 0x0E0D, 0x0E0E, 0x0E0F, 0x0E10, 0x0E11, 0x0E12, 0x0E13, 0x0E14, 0x0E15, 0x0E16, 0x0E17,
+        0x0E18, 0x0E19, 0x0E1A, 0x0E1B, 0x0E1C, 0x0E1D, 0x0E1E, 0x0E1F, 0x0E20, 0x0E21, 0x0E22, 0x0E23,
+        0x0E24, 0x0E25, 0x0E26, 0x0E27, 0x0E28, 0x0E29, 0x0E2A, 0x0E2B, 0x0E2C, 0x0E2D, 0x0E2E, 0x0E2F,
+        0x0E30, 0x0E31, 0x0E32, 0x0E33, 0x0E34, 0x0E35, 0x0E36, 0x0E37, 0x0E38, 0x0E39, 0x0E3A, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0E3F, 0x0E40, 0x0E41, 0x0E42, 0x0E43, 0x0E44, 0x0E45, 0x0E46, 0x0E47,
+        0x0E48, 0x0E49, 0x0E4A, 0x0E4B, 0x0E4C, 0x0E4D, 0x0E4E, 0x0E4F, 0x0E50, 0x0E51, 0x0E52, 0x0E53,
+        0x0E54, 0x0E55, 0x0E56, 0x0E57, 0x0E58, 0x0E59, 0x0E5A, 0x0E5B, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // part 12 was never published
+    { 0 },
+    // ISO/IEC 8859-13
+    {
+        0x00A0, 0x201D, 0x00A2, 0x00A3, 0x00A4, 0x201E, 0x00A6, 0x00A7, 0x00D8, 0x00A9, 0x0156, 0x00AB,
+        0x00AC, 0x00AD, 0x00AE, 0x00C6, 0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x201C, 0x00B5, 0x00B6, 0x00B7,
+        0x00F8, 0x00B9, 0x0157, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00E6, 0x0104, 0x012E, 0x0100, 0x0106,
+        0x00C4, 0x00C5, 0x0118, 0x0112, 0x010C, 0x00C9, 0x0179, 0x0116, 0x0122, 0x0136, 0x012A, 0x013B,
+        0x0160, 0x0143, 0x0145, 0x00D3, 0x014C, 0x00D5, 0x00D6, 0x00D7, 0x0172, 0x0141, 0x015A, 0x016A,
+        0x00DC, 0x017B, 0x017D, 0x00DF, 0x0105, 0x012F, 0x0101, 0x0107, 0x00E4, 0x00E5, 0x0119, 0x0113,
+        0x010D, 0x00E9, 0x017A, 0x0117, 0x0123, 0x0137, 0x012B, 0x013C, 0x0161, 0x0144, 0x0146, 0x00F3,
+        0x014D, 0x00F5, 0x00F6, 0x00F7, 0x0173, 0x0142, 0x015B, 0x016B, 0x00FC, 0x017C, 0x017E, 0x2019,
+    },
+    // ISO/IEC 8859-14
+    {
+        0x00A0, 0x1E02, 0x1E03, 0x00A3, 0x010A, 0x010B, 0x1E0A, 0x00A7, 0x1E80, 0x00A9, 0x1E82, 0x1E0B,
+        0x1EF2, 0x00AD, 0x00AE, 0x0178, 0x1E1E, 0x1E1F, 0x0120, 0x0121, 0x1E40, 0x1E41, 0x00B6, 0x1E56,
+        0x1E81, 0x1E57, 0x1E83, 0x1E60, 0x1EF3, 0x1E84, 0x1E85, 0x1E61, 0x00C0, 0x00C1, 0x00C2, 0x00C3,
+        0x00C4, 0x00C5, 0x00C6, 0x00C7, 0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+        0x0174, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x1E6A, 0x00D8, 0x00D9, 0x00DA, 0x00DB,
+        0x00DC, 0x00DD, 0x0176, 0x00DF, 0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+        0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF, 0x0175, 0x00F1, 0x00F2, 0x00F3,
+        0x00F4, 0x00F5, 0x00F6, 0x1E6B, 0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x0177, 0x00FF,
+    },
+    // ISO/IEC 8859-15
+    {
+        0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x20AC, 0x00A5, 0x0160, 0x00A7, 0x0161, 0x00A9, 0x00AA, 0x00AB,
+        0x00AC, 0x00AD, 0x00AE, 0x00AF, 0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x017D, 0x00B5, 0x00B6, 0x00B7,
+        0x017E, 0x00B9, 0x00BA, 0x00BB, 0x0152, 0x0153, 0x0178, 0x00BF, 0x00C0, 0x00C1, 0x00C2, 0x00C3,
+        0x00C4, 0x00C5, 0x00C6, 0x00C7, 0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+        0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7, 0x00D8, 0x00D9, 0x00DA, 0x00DB,
+        0x00DC, 0x00DD, 0x00DE, 0x00DF, 0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+        0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF, 0x00F0, 0x00F1, 0x00F2, 0x00F3,
+        0x00F4, 0x00F5, 0x00F6, 0x00F7, 0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF,
+    },
+};
+
+// Precomposed characters for ISO 6937 diacritic (0xC1-0xCF) + base letter (0x40-0x7F). 0 means there is none.
+const uint16_t ISO6937Composed[15][64] =
+{
+    // 0xC1 U+0300
+    {
+        0x0000, 0x00C0, 0x0000, 0x0000, 0x0000, 0x00C8, 0x0000, 0x0000, 0x0000, 0x00CC, 0x0000, 0x0000, 0x0000, 0x0000, 0x01F8, 0x00D2,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00D9, 0x0000, 0x1E80, 0x0000, 0x1EF2, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x00E0, 0x0000, 0x0000, 0x0000, 0x00E8, 0x0000, 0x0000, 0x0000, 0x00EC, 0x0000, 0x0000, 0x0000, 0x0000, 0x01F9, 0x00F2,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00F9, 0x0000, 0x1E81, 0x0000, 0x1EF3, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xC2 U+0301
+    {
+        0x0000, 0x00C1, 0x0000, 0x0106, 0x0000, 0x00C9, 0x0000, 0x01F4, 0x0000, 0x00CD, 0x0000, 0x1E30, 0x0139, 0x1E3E, 0x0143, 0x00D3,
+        0x1E54, 0x0000, 0x0154, 0x015A, 0x0000, 0x00DA, 0x0000, 0x1E82, 0x0000, 0x00DD, 0x0179, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x00E1, 0x0000, 0x0107, 0x0000, 0x00E9, 0x0000, 0x01F5, 0x0000, 0x00ED, 0x0000, 0x1E31, 0x013A, 0x1E3F, 0x0144, 0x00F3,
+        0x1E55, 0x0000, 0x0155, 0x015B, 0x0000, 0x00FA, 0x0000, 0x1E83, 0x0000, 0x00FD, 0x017A, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xC3 U+0302
+    {
+        0x0000, 0x00C2, 0x0000, 0x0108, 0x0000, 0x00CA, 0x0000, 0x011C, 0x0124, 0x00CE, 0x0134, 0x0000, 0x0000, 0x0000, 0x0000, 0x00D4,
+        0x0000, 0x0000, 0x0000, 0x015C, 0x0000, 0x00DB, 0x0000, 0x0174, 0x0000, 0x0176, 0x1E90, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x00E2, 0x0000, 0x0109, 0x0000, 0x00EA, 0x0000, 0x011D, 0x0125, 0x00EE, 0x0135, 0x0000, 0x0000, 0x0000, 0x0000, 0x00F4,
+        0x0000, 0x0000, 0x0000, 0x015D, 0x0000, 0x00FB, 0x0000, 0x0175, 0x0000, 0x0177, 0x1E91, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xC4 U+0303
+    {
+        0x0000, 0x00C3, 0x0000, 0x0000, 0x0000, 0x1EBC, 0x0000, 0x0000, 0x0000, 0x0128, 0x0000, 0x0000, 0x0000, 0x0000, 0x00D1, 0x00D5,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0168, 0x1E7C, 0x0000, 0x0000, 0x1EF8, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x00E3, 0x0000, 0x0000, 0x0000, 0x1EBD, 0x0000, 0x0000, 0x0000, 0x0129, 0x0000, 0x0000, 0x0000, 0x0000, 0x00F1, 0x00F5,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0169, 0x1E7D, 0x0000, 0x0000, 0x1EF9, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xC5 U+0304
+    {
+        0x0000, 0x0100, 0x0000, 0x0000, 0x0000, 0x0112, 0x0000, 0x1E20, 0x0000, 0x012A, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x014C,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016A, 0x0000, 0x0000, 0x0000, 0x0232, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0101, 0x0000, 0x0000, 0x0000, 0x0113, 0x0000, 0x1E21, 0x0000, 0x012B, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x014D,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016B, 0x0000, 0x0000, 0x0000, 0x0233, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xC6 U+0306
+    {
+        0x0000, 0x0102, 0x0000, 0x0000, 0x0000, 0x0114, 0x0000, 0x011E, 0x0000, 0x012C, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x014E,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016C, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0103, 0x0000, 0x0000, 0x0000, 0x0115, 0x0000, 0x011F, 0x0000, 0x012D, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x014F,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016D, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xC7 U+0307
+    {
+        0x0000, 0x0226, 0x1E02, 0x010A, 0x1E0A, 0x0116, 0x1E1E, 0x0120, 0x1E22, 0x0130, 0x0000, 0x0000, 0x0000, 0x1E40, 0x1E44, 0x022E,
+        0x1E56, 0x0000, 0x1E58, 0x1E60, 0x1E6A, 0x0000, 0x0000, 0x1E86, 0x1E8A, 0x1E8E, 0x017B, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0227, 0x1E03, 0x010B, 0x1E0B, 0x0117, 0x1E1F, 0x0121, 0x1E23, 0x0000, 0x0000, 0x0000, 0x0000, 0x1E41, 0x1E45, 0x022F,
+        0x1E57, 0x0000, 0x1E59, 0x1E61, 0x1E6B, 0x0000, 0x0000, 0x1E87, 0x1E8B, 0x1E8F, 0x017C, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xC8 U+0308
+    {
+        0x0000, 0x00C4, 0x0000, 0x0000, 0x0000, 0x00CB, 0x0000, 0x0000, 0x1E26, 0x00CF, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00D6,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00DC, 0x0000, 0x1E84, 0x1E8C, 0x0178, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x00E4, 0x0000, 0x0000, 0x0000, 0x00EB, 0x0000, 0x0000, 0x1E27, 0x00EF, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00F6,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x1E97, 0x00FC, 0x0000, 0x1E85, 0x1E8D, 0x00FF, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xC9 (unused)
+    {
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xCA U+030A
+    {
+        0x0000, 0x00C5, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016E, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x00E5, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x016F, 0x0000, 0x1E98, 0x0000, 0x1E99, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xCB U+0327
+    {
+        0x0000, 0x0000, 0x0000, 0x00C7, 0x1E10, 0x0228, 0x0000, 0x0122, 0x1E28, 0x0000, 0x0000, 0x0136, 0x013B, 0x0000, 0x0145, 0x0000,
+        0x0000, 0x0000, 0x0156, 0x015E, 0x0162, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x00E7, 0x1E11, 0x0229, 0x0000, 0x0123, 0x1E29, 0x0000, 0x0000, 0x0137, 0x013C, 0x0000, 0x0146, 0x0000,
+        0x0000, 0x0000, 0x0157, 0x015F, 0x0163, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xCC (unused)
+    {
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xCD U+030B
+    {
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0150,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0170, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0151,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0171, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xCE U+0328
+    {
+        0x0000, 0x0104, 0x0000, 0x0000, 0x0000, 0x0118, 0x0000, 0x0000, 0x0000, 0x012E, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x01EA,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0172, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x0105, 0x0000, 0x0000, 0x0000, 0x0119, 0x0000, 0x0000, 0x0000, 0x012F, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x01EB,
+        0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0173, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+    // 0xCF U+030C
+    {
+        0x0000, 0x01CD, 0x0000, 0x010C, 0x010E, 0x011A, 0x0000, 0x01E6, 0x021E, 0x01CF, 0x0000, 0x01E8, 0x013D, 0x0000, 0x0147, 0x01D1,
+        0x0000, 0x0000, 0x0158, 0x0160, 0x0164, 0x01D3, 0x0000, 0x0000, 0x0000, 0x0000, 0x017D, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+        0x0000, 0x01CE, 0x0000, 0x010D, 0x010F, 0x011B, 0x0000, 0x01E7, 0x021F, 0x01D0, 0x01F0, 0x01E9, 0x013E, 0x0000, 0x0148, 0x01D2,
+        0x0000, 0x0000, 0x0159, 0x0161, 0x0165, 0x01D4, 0x0000, 0x0000, 0x0000, 0x0000, 0x017E, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    },
+};
+
+// Unicode combining marks for the ISO 6937 diacritics 0xC1-0xCF, used when there is no precomposed character
+const uint16_t ISO6937Diacritics[15] =
+{
+    0x0300, 0x0301, 0x0302, 0x0303, 0x0304, 0x0306, 0x0307, 0x0308, 0x0000, 0x030A, 0x0327, 0x0000, 0x030B, 0x0328, 0x030C,
+};
+
+// EN 300 468 figure A.1 (ISO/IEC 6937 with the euro sign), 0xA0-0xFF. The diacritics 0xC1-0xCF are handled
+// separately.
+const uint16_t ISO6937UpperHalf[96] =
+{
+    0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x20AC, 0x00A5, 0x0023, 0x00A7, 0x00A4, 0x2018, 0x201C, 0x00AB,
+    0x2190, 0x2191, 0x2192, 0x2193, 0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00D7, 0x00B5, 0x00B6, 0x00B7,
+    0x00F7, 0x2019, 0x201D, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x2015, 0x00B9, 0x00AE, 0x00A9, 0x2122, 0x266A, 0x00AC, 0x00A6, 0x0000, 0x0000, 0x0000, 0x0000,
+    0x215B, 0x215C, 0x215D, 0x215E, 0x2126, 0x00C6, 0x0110, 0x00AA, 0x0126, 0x0000, 0x0132, 0x013F,
+    0x0141, 0x00D8, 0x0152, 0x00BA, 0x00DE, 0x0166, 0x014A, 0x0149, 0x0138, 0x00E6, 0x0111, 0x00F0,
+    0x0127, 0x0131, 0x0133, 0x0140, 0x0142, 0x00F8, 0x0153, 0x00DF, 0x00FE, 0x0167, 0x014B, 0x00AD,
+};
+
+const uint8_t EmphasisOn = 0x86;
+const uint8_t EmphasisOff = 0x87;
+const uint8_t CarriageReturnLineFeed = 0x8A;
+
+// UTF-8 encoding of one byte of a single byte character set. A length of 0 means the byte produces no output.
+struct Utf8Char
+{
+    uint8_t length;
+    char bytes[3];
+};
+
+struct SingleByteTable
+{
+    Utf8Char chars[256];
+};
+
+Utf8Char EncodeUtf8(uint16_t codePoint)
+{
+    Utf8Char result {};
+    if (codePoint == 0)
+        result.length = 0;
+    else if (codePoint < 0x80)
+    {
+        result.length = 1;
+        result.bytes[0] = static_cast<char>(codePoint);
+    }
+    else if (codePoint < 0x800)
+    {
+        result.length = 2;
+        result.bytes[0] = static_cast<char>(0xC0 | (codePoint >> 6));
+        result.bytes[1] = static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+        result.length = 3;
+        result.bytes[0] = static_cast<char>(0xE0 | (codePoint >> 12));
+        result.bytes[1] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        result.bytes[2] = static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    return result;
+}
+
+void AppendCodePoint(string & result, uint16_t codePoint)
+{
+    Utf8Char encoded = EncodeUtf8(codePoint);
+    result.append(encoded.bytes, encoded.length);
+}
+
+void FillTable(SingleByteTable & table, const uint16_t * upperHalf)
+{
+    // Control characters produce nothing, except for the CR/LF code
+    for (unsigned c = 0; c < 0x20; ++c)
+        table.chars[c] = EncodeUtf8(0);
+    for (unsigned c = 0x20; c < 0x80; ++c)
+        table.chars[c] = EncodeUtf8(static_cast<uint16_t>(c));
+    for (unsigned c = 0x80; c < 0xA0; ++c)
+        table.chars[c] = EncodeUtf8(0);
+    table.chars[CarriageReturnLineFeed] = EncodeUtf8('\n');
+    for (unsigned c = 0xA0; c < 0x100; ++c)
+        table.chars[c] = EncodeUtf8(upperHalf ? upperHalf[c - 0xA0] : 0);
+}
+
+// Index 0 is the default (ISO 6937) table, 1 to 15 are ISO 8859 parts 1 to 15
+const SingleByteTable * Tables()
+{
+    static SingleByteTable * tables = []()
+    {
+        SingleByteTable * result = new SingleByteTable[16];
+        FillTable(result[0], ISO6937UpperHalf);
+        for (int part = 1; part < 16; ++part)
+            FillTable(result[part], ISO8859UpperHalf[part]);
+        return result;
+    }();
+    return tables;
+}
+
+// Length of the run of printable ASCII (0x20-0x7F) at the start of data. Checks 8 bytes at a time.
+size_t AsciiRun(const uint8_t * data, size_t length)
+{
+    static const uint64_t Ones = 0x0101010101010101ull;
+    static const uint64_t HighBits = 0x8080808080808080ull;
+    size_t run = 0;
+    while (run + 8 <= length)
+    {
+        uint64_t word;
+        memcpy(&word, data + run, sizeof(word));
+        // Any byte with the high bit set, or any byte below 0x20
+        if (((word & HighBits) | ((word - Ones * 0x20) & ~word & HighBits)) != 0)
+            break;
+        run += 8;
+    }
+    while ((run < length) && (data[run] >= 0x20) && (data[run] < 0x80))
+        ++run;
+    return run;
+}
+
+void AppendSingleByte(string & result, const uint8_t * data, size_t length, int tableIndex)
+{
+    const SingleByteTable & table = Tables()[tableIndex];
+    bool iso6937 = (tableIndex == 0);
+    size_t index = 0;
+    while (index < length)
+    {
+        size_t run = AsciiRun(data + index, length - index);
+        if (run > 0)
+        {
+            result.append(reinterpret_cast<const char *>(data + index), run);
+            index += run;
+            continue;
+        }
+        uint8_t c = data[index++];
+        if (iso6937 && (c >= 0xC1) && (c <= 0xCF))
+        {
+            // Non-spacing diacritic, applies to the character that follows
+            if ((index >= length) || (data[index] < 0x20) || (data[index] >= 0x80))
+                continue;
+            uint8_t base = data[index++];
+            uint16_t composed = (base >= 0x40) ? ISO6937Composed[c - 0xC1][base - 0x40] : 0;
+            if (composed != 0)
+                AppendCodePoint(result, composed);
+            else
+            {
+                result += static_cast<char>(base);
+                AppendCodePoint(result, ISO6937Diacritics[c - 0xC1]);
+            }
+            continue;
+        }
+        const Utf8Char & encoded = table.chars[c];
+        result.append(encoded.bytes, encoded.length);
+    }
+}
+
+void AppendUCS2(string & result, const uint8_t * data, size_t length)
+{
+    for (size_t index = 0; index + 1 < length; index += 2)
+    {
+        uint16_t codePoint = static_cast<uint16_t>((data[index] << 8) | data[index + 1]);
+        if (codePoint == (0xE000 | CarriageReturnLineFeed))
+            result += '\n';
+        else if ((codePoint >= 0x20) && ((codePoint < 0xE080) || (codePoint > 0xE09F)) &&
+                 ((codePoint < 0xD800) || (codePoint > 0xDFFF)))
+            AppendCodePoint(result, codePoint);
+    }
+}
+
+void AppendUTF8(string & result, const uint8_t * data, size_t length)
+{
+    // Control codes are encoded as U+E080-U+E09F (EE 82 80 - EE 82 9F)
+    size_t index = 0;
+    while (index < length)
+    {
+        size_t run = AsciiRun(data + index, length - index);
+        if (run > 0)
+        {
+            result.append(reinterpret_cast<const char *>(data + index), run);
+            index += run;
+            continue;
+        }
+        uint8_t c = data[index];
+        if ((c == 0xEE) && (index + 2 < length) && (data[index + 1] == 0x82) &&
+            (data[index + 2] >= 0x80) && (data[index + 2] <= 0x9F))
+        {
+            if (data[index + 2] == CarriageReturnLineFeed)
+                result += '\n';
+            index += 3;
+        }
+        else
+        {
+            if (c >= 0x80)
+                result += static_cast<char>(c);
+            ++index;
+        }
+    }
+}
+
+void AppendAsciiOnly(string & result, const uint8_t * data, size_t length)
+{
+    for (size_t index = 0; index < length; ++index)
+    {
+        if ((data[index] >= 0x20) && (data[index] < 0x80))
+            result += static_cast<char>(data[index]);
+    }
+}
+
+} // namespace
+
+void AppendDvbText(string & result, const uint8_t * data, size_t length)
+{
+    if (length == 0)
+        return;
+    result.reserve(result.size() + length);
+    uint8_t selector = data[0];
+    if (selector >= 0x20)
+    {
+        AppendSingleByte(result, data, length, 0);
+        return;
+    }
+    if ((selector >= 0x01) && (selector <= 0x0B))
+    {
+        // 0x01 selects ISO 8859-5, up to 0x0B for ISO 8859-15
+        AppendSingleByte(result, data + 1, length - 1, selector + 4);
+        return;
+    }
+    switch (selector)
+    {
+    case 0x10:
+        {
+            if (length < 3)
+                return;
+            int part = (data[1] << 8) | data[2];
+            if ((part >= 1) && (part <= 15))
+                AppendSingleByte(result, data + 3, length - 3, part);
+            else
+                AppendAsciiOnly(result, data + 3, length - 3);
+        }
+        break;
+    case 0x11:
+        AppendUCS2(result, data + 1, length - 1);
+        break;
+    case 0x15:
+        AppendUTF8(result, data + 1, length - 1);
+        break;
+    case 0x1F:
+        // Followed by an encoding_type_id we do not know
+        if (length > 2)
+            AppendAsciiOnly(result, data + 2, length - 2);
+        break;
+    case 0x12:  // KS X 1001-2004
+    case 0x13:  // GB-2312-1980
+    case 0x14:  // Big5
+    default:
+        AppendAsciiOnly(result, data + 1, length - 1);
+        break;
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Descriptors.h"
+
+// Converts DVB SI text (EN 300 468 Annex A) to UTF-8 and appends it to result.
+// Supported are the default table (ISO/IEC 6937 with the euro sign at 0xA4, including the non-spacing
+// diacritics 0xC1-0xCF), the ISO/IEC 8859 selectors 0x01-0x0B and 0x10, UCS-2 (0x11) and UTF-8 (0x15).
+// Emphasis on/off codes are dropped and the CR/LF code becomes a newline. Korean and Chinese character sets are not
+// supported; only their ASCII characters are kept.
+void AppendDvbText(std::string & result, const uint8_t * data, size_t length);
+
+inline void AppendDvbText(std::string & result, const ByteView & text)
+{
+    AppendDvbText(result, text.data, text.size);
+}
+
+inline std::string DvbTextToUtf8(const ByteView & text)
+{
+    std::string result;
+    AppendDvbText(result, text.data, text.size);
+    return result;
+}
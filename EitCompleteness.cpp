@@ -0,0 +1,193 @@
+#include "EitCompleteness.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include "Crc32.h"
+#include "Section.h"
+
+using namespace std;
+
+namespace {
+
+const uint8_t PresentFollowingActual = 0x4E;
+const uint8_t PresentFollowingOther = 0x4F;
+const uint8_t FirstScheduleActual = 0x50;
+const uint8_t FirstScheduleOther = 0x60;
+// EIT header fields after the long section header: transport_stream_id, original_network_id,
+// segment_last_section_number and last_table_id
+const size_t EITHeaderSize = SectionHeader::LongHeaderSize + 6;
+
+// First table_id of the group the table belongs to
+uint8_t FirstTableId(uint8_t tableId)
+{
+    if (tableId < FirstScheduleActual)
+        return tableId;
+    return (tableId < FirstScheduleOther) ? FirstScheduleActual : FirstScheduleOther;
+}
+
+unsigned Group(uint8_t tableId)
+{
+    switch (FirstTableId(tableId))
+    {
+    case PresentFollowingActual:
+        return EitCompleteness::ActualPresentFollowing;
+    case PresentFollowingOther:
+        return EitCompleteness::OtherPresentFollowing;
+    case FirstScheduleActual:
+        return EitCompleteness::ActualSchedule;
+    default:
+        return EitCompleteness::OtherSchedule;
+    }
+}
+
+unsigned PopCount(unsigned value)
+{
+    unsigned count = 0;
+    for (; value != 0; value &= value - 1)
+        ++count;
+    return count;
+}
+
+} // namespace
+
+EitCompleteness::EitCompleteness(unsigned tables)
+    : _tables(tables)
+    , _subTables()
+    , _services()
+    , _epoch(0)
+    , _confirmedCount(0)
+    , _subTableCount()
+    , _completeCount()
+    , _missingTableCount()
+    , _complete(false)
+{
+}
+
+bool EitCompleteness::ParseTables(const char * text, unsigned & tables)
+{
+    tables = 0;
+    istringstream stream(text);
+    string name;
+    while (getline(stream, name, ','))
+    {
+        if (name == "pf")
+            tables |= ActualPresentFollowing;
+        else if (name == "schedule")
+            tables |= ActualSchedule;
+        else if (name == "pf-other")
+            tables |= OtherPresentFollowing;
+        else if (name == "schedule-other")
+            tables |= OtherSchedule;
+        else if (name == "actual")
+            tables |= Actual;
+        else if (name == "all")
+            tables |= All;
+        else
+            return false;
+    }
+    return tables != 0;
+}
+
+void EitCompleteness::AddSection(const uint8_t * section, size_t size)
+{
+    SectionHeader header;
+    if (!SectionHeader::Parse(section, size, header) || !IsEITTableId(header.tableId) || !header.currentNext ||
+        (header.TotalSize() < EITHeaderSize + SectionHeader::CRCSize) || !(_tables & Group(header.tableId)))
+        return;
+    uint64_t serviceKey = (uint64_t(section[10]) << 40) | (uint64_t(section[11]) << 32) |
+                          (uint64_t(section[8]) << 24) | (uint64_t(section[9]) << 16) | header.extension;
+    uint64_t key = (uint64_t(header.tableId) << 48) | serviceKey;
+    uint8_t sectionNumber = header.sectionNumber;
+    uint64_t sectionBit = uint64_t(1) << (sectionNumber % 64);
+
+    auto position = _subTables.find(key);
+    if ((position != _subTables.end()) && (position->second.version == header.version) &&
+        (position->second.received[sectionNumber / 64] & sectionBit))
+    {
+        // A repeat, the usual case once everything has come by once
+        SubTable & subTable = position->second;
+        if (subTable.confirmedEpoch != _epoch)
+        {
+            subTable.confirmedEpoch = _epoch;
+            ++_confirmedCount;
+            UpdateComplete();
+        }
+        return;
+    }
+
+    if (!Crc32::Check(section, header.TotalSize()))
+        return;
+    if ((position == _subTables.end()) || (position->second.version != header.version))
+    {
+        if (position == _subTables.end())
+        {
+            position = _subTables.emplace(key, SubTable()).first;
+            _subTableCount.Add();
+        }
+        else if (position->second.complete)
+            _completeCount.Set(_completeCount - 1);
+        SubTable & subTable = position->second;
+        memset(&subTable, 0, sizeof(subTable));
+        subTable.version = header.version;
+        subTable.lastSectionNumber = header.lastSectionNumber;
+        // Everything has to come round again before the EIT counts as complete
+        ++_epoch;
+        _confirmedCount = 0;
+        subTable.confirmedEpoch = _epoch - 1;
+    }
+    SubTable & subTable = position->second;
+    subTable.received[sectionNumber / 64] |= sectionBit;
+    subTable.segmentsSeen |= 1u << (sectionNumber / 8);
+    subTable.segmentLast[sectionNumber / 8] = section[12];
+    if (!subTable.complete && IsComplete(subTable))
+    {
+        subTable.complete = true;
+        _completeCount.Add();
+    }
+    UpdateService(header.tableId, serviceKey, section[13]);
+    UpdateComplete();
+}
+
+bool EitCompleteness::IsComplete(const SubTable & subTable)
+{
+    for (unsigned segment = 0; segment <= subTable.lastSectionNumber / 8u; ++segment)
+    {
+        if (!(subTable.segmentsSeen & (1u << segment)))
+            return false;
+        unsigned first = segment * 8;
+        unsigned last = min<unsigned>({ max<unsigned>(subTable.segmentLast[segment], first), first + 7,
+                                        subTable.lastSectionNumber });
+        for (unsigned number = first; number <= last; ++number)
+        {
+            if (!(subTable.received[number / 64] & (uint64_t(1) << (number % 64))))
+                return false;
+        }
+    }
+    return true;
+}
+
+void EitCompleteness::UpdateService(uint8_t tableId, uint64_t serviceKey, uint8_t lastTableId)
+{
+    uint8_t firstTableId = FirstTableId(tableId);
+    ServiceTables & service = _services[(uint64_t(firstTableId) << 48) | serviceKey];
+    service.present = static_cast<uint16_t>(service.present | (1u << (tableId - firstTableId)));
+    // last_table_id is the table itself for present/following, and at most 15 tables on for the schedule
+    if ((lastTableId >= firstTableId) && (lastTableId < firstTableId + 16) && (firstTableId >= FirstScheduleActual))
+        service.lastTableId = lastTableId;
+    else
+        service.lastTableId = max(service.lastTableId, tableId);
+    unsigned expected = (2u << (service.lastTableId - firstTableId)) - 1;
+    uint8_t missing = static_cast<uint8_t>(PopCount(expected & ~unsigned(service.present)));
+    _missingTableCount.Set(_missingTableCount - service.missing + missing);
+    service.missing = missing;
+}
+
+void EitCompleteness::UpdateComplete()
+{
+    uint64_t subTables = _subTableCount;
+    bool complete = (subTables > 0) && (_completeCount == subTables) && (_confirmedCount == subTables) &&
+                    (_missingTableCount == 0);
+    _complete.store(complete, memory_order_release);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include "Metrics.h"
+
+// Tells when every section of the selected EIT sub_tables has been received, so reading can stop once the guide
+// is complete instead of at the end of the input.
+// A sub_table (table_id, service_id, transport_stream_id, original_network_id) is complete when every segment up
+// to last_section_number has its sections up to segment_last_section_number. For the schedule, the tables of a
+// service up to last_table_id must all be there. Services only become known when their EIT comes by, so the EIT
+// as a whole is taken as complete once, after the last new sub_table (or version) was seen, every sub_table has
+// been repeated: the carousel has gone round without bringing anything new.
+class EitCompleteness
+{
+public:
+    // Groups of sub_tables to track
+    enum Tables : unsigned
+    {
+        ActualPresentFollowing = 0x01,
+        ActualSchedule = 0x02,
+        OtherPresentFollowing = 0x04,
+        OtherSchedule = 0x08,
+        Actual = ActualPresentFollowing | ActualSchedule,
+        All = Actual | OtherPresentFollowing | OtherSchedule,
+    };
+
+    explicit EitCompleteness(unsigned tables = Actual);
+
+    // Comma separated pf, schedule, pf-other, schedule-other, actual or all
+    static bool ParseTables(const char * text, unsigned & tables);
+
+    // Called with every EIT section, repeats included. The CRC is checked for sections that bring something new.
+    void AddSection(const uint8_t * section, size_t size);
+
+    // These can be read from another thread than the one adding sections
+    bool IsComplete() const { return _complete.load(std::memory_order_acquire); }
+    uint64_t SubTables() const { return _subTableCount; }
+    uint64_t CompleteSubTables() const { return _completeCount; }
+    // Schedule tables below last_table_id that have not been seen at all
+    uint64_t MissingTables() const { return _missingTableCount; }
+
+private:
+    struct SubTable
+    {
+        uint64_t received[4];       // Bit per section_number
+        uint32_t segmentsSeen;      // Bit per segment of 8 sections
+        uint32_t confirmedEpoch;
+        uint8_t segmentLast[32];    // segment_last_section_number per segment
+        uint8_t version;
+        uint8_t lastSectionNumber;
+        bool complete;
+    };
+    // The tables of one service in one of the four groups
+    struct ServiceTables
+    {
+        uint16_t present;           // Bit per table_id from the first of the group
+        uint8_t lastTableId;
+        uint8_t missing;
+    };
+
+    EitCompleteness(const EitCompleteness &) = delete;
+    EitCompleteness & operator = (const EitCompleteness &) = delete;
+
+    static bool IsComplete(const SubTable & subTable);
+    void UpdateService(uint8_t tableId, uint64_t serviceKey, uint8_t lastTableId);
+    void UpdateComplete();
+
+    unsigned _tables;
+    std::unordered_map<uint64_t, SubTable> _subTables;
+    std::unordered_map<uint64_t, ServiceTables> _services;
+    // Bumped whenever a new sub_table or version turns up; a sub_table is confirmed when it repeats in this epoch
+    uint32_t _epoch;
+    uint64_t _confirmedCount;
+    Counter _subTableCount;
+    Counter _completeCount;
+    Counter _missingTableCount;
+    std::atomic<bool> _complete;
+};
@@ -0,0 +1,250 @@
+#include "EitDecoder.h"
+
+#include "Crc32.h"
+#include "DvbText.h"
+#include "EpgStore.h"
+#include "Section.h"
+
+using namespace std;
+
+namespace {
+
+// transport_stream_id, original_network_id, segment_last_section_number and last_table_id follow the long header
+const size_t EITHeaderSize = SectionHeader::LongHeaderSize + 6;
+// event_id, start_time, duration, running_status, free_CA_mode and descriptors_loop_length
+const size_t EventHeaderSize = 12;
+const size_t DescriptorHeaderSize = 2;
+
+uint32_t BCD(uint8_t value)
+{
+    return (value >> 4) * 10u + (value & 0x0F);
+}
+
+uint32_t PackLanguage(const uint8_t * code)
+{
+    return (uint32_t(code[0]) << 16) | (uint32_t(code[1]) << 8) | code[2];
+}
+
+} // namespace
+
+uint32_t DecodeDvbDuration(const uint8_t * data)
+{
+    return BCD(data[0]) * 3600 + BCD(data[1]) * 60 + BCD(data[2]);
+}
+
+uint32_t DecodeDvbTime(const uint8_t * data)
+{
+    // Modified Julian Date 40587 is 1970-01-01
+    uint32_t mjd = (uint32_t(data[0]) << 8) | data[1];
+    if (mjd < 40587)
+        return 0;
+    return (mjd - 40587) * 86400 + DecodeDvbDuration(data + 2);
+}
+
+EitDecoder::EitDecoder(EitSectionHandler & handler)
+    : _handler(handler)
+    , _assembler(*this)
+    , _arena()
+    , _sections()
+    , _events()
+    , _crcErrors()
+    , _malformedSections()
+{
+}
+
+void EitDecoder::PushPacket(const uint8_t * packet)
+{
+    _assembler.PushPacket(packet);
+}
+
+void EitDecoder::OnSection(const uint8_t * section, size_t size)
+{
+    SectionHeader header;
+    if (!SectionHeader::Parse(section, size, header))
+        return;
+    if (!Crc32::Check(section, header.TotalSize()))
+    {
+        _crcErrors.Add();
+        return;
+    }
+    EitSection result;
+    if (!Parse(section, header.TotalSize(), _arena, result))
+    {
+        _malformedSections.Add();
+        _arena.Reset();
+        return;
+    }
+    _sections.Add();
+    _events.Add(result.eventCount);
+    _handler.OnEitSection(result);
+    _arena.Reset();
+}
+
+bool EitDecoder::Parse(const uint8_t * section, size_t size, Arena & arena, EitSection & result)
+{
+    SectionHeader header;
+    if (!SectionHeader::Parse(section, size, header) || !IsEITTableId(header.tableId) ||
+        (header.TotalSize() < EITHeaderSize + SectionHeader::CRCSize))
+        return false;
+    result.tableId = header.tableId;
+    result.serviceId = header.extension;
+    result.version = header.version;
+    result.currentNext = header.currentNext;
+    result.sectionNumber = header.sectionNumber;
+    result.lastSectionNumber = header.lastSectionNumber;
+    result.transportStreamId = static_cast<uint16_t>((section[8] << 8) | section[9]);
+    result.originalNetworkId = static_cast<uint16_t>((section[10] << 8) | section[11]);
+    result.segmentLastSectionNumber = section[12];
+    result.lastTableId = section[13];
+
+    // First pass counts, so the arrays can be allocated at their final size
+    const uint8_t * end = section + header.TotalSize() - SectionHeader::CRCSize;
+    size_t eventCount = 0;
+    size_t descriptorCount = 0;
+    for (const uint8_t * event = section + EITHeaderSize; event < end;)
+    {
+        if (event + EventHeaderSize > end)
+            return false;
+        const uint8_t * descriptor = event + EventHeaderSize;
+        const uint8_t * descriptorsEnd = descriptor + (((event[10] & 0x0F) << 8) | event[11]);
+        if (descriptorsEnd > end)
+            return false;
+        while (descriptor < descriptorsEnd)
+        {
+            if ((descriptor + DescriptorHeaderSize > descriptorsEnd) ||
+                (descriptor + DescriptorHeaderSize + descriptor[1] > descriptorsEnd))
+                return false;
+            descriptor += DescriptorHeaderSize + descriptor[1];
+            ++descriptorCount;
+        }
+        ++eventCount;
+        event = descriptorsEnd;
+    }
+
+    EitEvent * events = arena.Allocate<EitEvent>(eventCount);
+    EitDescriptor * descriptors = arena.Allocate<EitDescriptor>(descriptorCount);
+    result.events = events;
+    result.eventCount = eventCount;
+    result.descriptors = descriptors;
+    result.descriptorCount = descriptorCount;
+    for (const uint8_t * event = section + EITHeaderSize; event < end; ++events)
+    {
+        const uint8_t * descriptor = event + EventHeaderSize;
+        const uint8_t * descriptorsEnd = descriptor + (((event[10] & 0x0F) << 8) | event[11]);
+        events->eventId = static_cast<uint16_t>((event[0] << 8) | event[1]);
+        events->start = DecodeDvbTime(event + 2);
+        events->duration = DecodeDvbDuration(event + 7);
+        events->runningStatus = static_cast<uint8_t>(event[10] >> 5);
+        events->freeCA = (event[10] & 0x10) != 0;
+        events->nvod = (event[2] & event[3] & event[4] & event[5] & event[6]) == 0xFF;
+        events->descriptors = descriptors;
+        events->descriptorCount = 0;
+        while (descriptor < descriptorsEnd)
+        {
+            descriptors->tag = descriptor[0];
+            descriptors->length = descriptor[1];
+            descriptors->data = descriptor + DescriptorHeaderSize;
+            descriptor += DescriptorHeaderSize + descriptor[1];
+            ++descriptors;
+            ++events->descriptorCount;
+        }
+        event = descriptorsEnd;
+    }
+    return true;
+}
+
+void AddEventDescriptor(uint8_t tag, const uint8_t * data, size_t length, EpgEvent & record, EventText & text)
+{
+    switch (DescriptorTag(tag))
+    {
+    case DescriptorTag::ShortEventDescriptor:
+        {
+            ShortEventDescriptor shortEvent;
+            if (!ShortEventDescriptor::Parse(data, length, shortEvent))
+                break;
+            record.language = PackLanguage(shortEvent.language);
+            AppendDvbText(text.title, shortEvent.name);
+            AppendDvbText(text.text, shortEvent.text);
+        }
+        break;
+    case DescriptorTag::ExtendedEventDescriptor:
+        {
+            // Parts arrive in descriptor number order
+            ExtendedEventDescriptor extendedEvent;
+            if (!ExtendedEventDescriptor::Parse(data, length, extendedEvent))
+                break;
+            size_t offset = 0;
+            ExtendedEventItem item;
+            while (extendedEvent.NextItem(offset, item))
+            {
+                AppendDvbText(text.extendedText, item.description);
+                text.extendedText += ": ";
+                AppendDvbText(text.extendedText, item.item);
+                text.extendedText += '\n';
+            }
+            AppendDvbText(text.extendedText, extendedEvent.text);
+        }
+        break;
+    case DescriptorTag::ContentDescriptor:
+        {
+            ContentDescriptor content;
+            if (!ContentDescriptor::Parse(data, length, content))
+                break;
+            for (size_t index = 0; index < content.Count(); ++index)
+            {
+                if ((record.content == 0) && (record.genres == 0))
+                    record.content = static_cast<uint8_t>((content.Level1(index) << 4) | content.Level2(index));
+                record.genres |= static_cast<uint16_t>(1u << content.Level1(index));
+            }
+        }
+        break;
+    case DescriptorTag::ParentalRatingDescriptor:
+        {
+            // Ratings above 0x0F are defined by the broadcaster and cannot be compared
+            ParentalRatingDescriptor parentalRating;
+            if (!ParentalRatingDescriptor::Parse(data, length, parentalRating))
+                break;
+            for (size_t index = 0; index < parentalRating.Count(); ++index)
+            {
+                uint8_t rating = parentalRating.Rating(index);
+                if ((rating <= ParentalRatingDescriptor::MaxAgeRating) && (rating > record.parentalRating))
+                    record.parentalRating = rating;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+size_t StoreEitSection(const EitSection & section, EpgStore & store, EventText & text)
+{
+    ServiceKey key { section.originalNetworkId, section.transportStreamId, section.serviceId };
+    StringPool & strings = store.Strings();
+    for (size_t index = 0; index < section.eventCount; ++index)
+    {
+        const EitEvent & event = section.events[index];
+        EpgEvent record {};
+        record.start = event.start;
+        record.duration = event.duration;
+        record.eventId = event.eventId;
+        record.tableId = section.tableId;
+        record.version = section.version;
+        record.flags = static_cast<uint8_t>((event.runningStatus & EpgEvent::RunningStatusMask) |
+                                            (event.freeCA ? EpgEvent::FreeCAFlag : 0) |
+                                            (event.nvod ? EpgEvent::NVODFlag : 0));
+        if (!store.InWindow(record))
+            continue;
+        text.Clear();
+        for (size_t descriptor = 0; descriptor < event.descriptorCount; ++descriptor)
+        {
+            const EitDescriptor & eventDescriptor = event.descriptors[descriptor];
+            AddEventDescriptor(eventDescriptor.tag, eventDescriptor.data, eventDescriptor.length, record, text);
+        }
+        record.title = strings.Intern(text.title);
+        record.text = strings.Intern(text.text);
+        record.extendedText = strings.Intern(text.extendedText);
+        store.Upsert(key, record);
+    }
+    return section.eventCount;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Arena.h"
+#include "Descriptors.h"
+#include "Metrics.h"
+#include "PidDispatcher.h"
+#include "SectionAssembler.h"
+
+class EpgStore;
+struct EpgEvent;
+
+struct EitDescriptor
+{
+    uint8_t tag;
+    uint8_t length;
+    const uint8_t * data;       // Into the section
+};
+
+struct EitEvent
+{
+    uint16_t eventId;
+    uint32_t start;             // Unix time (UTC)
+    uint32_t duration;          // Seconds
+    uint8_t runningStatus;
+    bool freeCA;
+    bool nvod;                  // NVOD reference event: start time all ones
+    const EitDescriptor * descriptors;
+    size_t descriptorCount;
+};
+
+// One decoded EIT section (EN 300 468 5.2.4). The events and descriptors are flat arrays in the decoder's arena,
+// descriptor data points into the section; both are only valid during the EitSectionHandler call.
+struct EitSection
+{
+    uint8_t tableId;
+    uint16_t serviceId;
+    uint8_t version;
+    bool currentNext;
+    uint8_t sectionNumber;
+    uint8_t lastSectionNumber;
+    uint16_t transportStreamId;
+    uint16_t originalNetworkId;
+    uint8_t segmentLastSectionNumber;
+    uint8_t lastTableId;
+    const EitEvent * events;
+    size_t eventCount;
+    const EitDescriptor * descriptors;
+    size_t descriptorCount;
+};
+
+class EitSectionHandler
+{
+public:
+    virtual ~EitSectionHandler() {}
+
+    virtual void OnEitSection(const EitSection & section) = 0;
+};
+
+// EIT decoder that replaces libdvbpsi on the EIT PID. libdvbpsi allocates a table, an event node per event and a
+// descriptor node per descriptor for every section, which the caller frees again right away; this decoder parses a
+// section into flat arrays in an arena that is reset after each section, so decoding does not allocate at all.
+// Sections come in as packets (through its own SectionAssembler), or as complete sections from a SectionFilter.
+// Every section is handed over on its own, as soon as it is complete and its CRC_32 is correct.
+class EitDecoder : public PacketSink, public SectionHandler
+{
+public:
+    explicit EitDecoder(EitSectionHandler & handler);
+
+    void PushPacket(const uint8_t * packet) override;
+    void OnSection(const uint8_t * section, size_t size) override;
+
+    // Parses an EIT section whose CRC_32 was checked into arrays allocated from arena. Returns false if it is not
+    // an EIT section or its lengths do not add up.
+    static bool Parse(const uint8_t * section, size_t size, Arena & arena, EitSection & result);
+
+    // Counters can be read from another thread than the one decoding
+    uint64_t Sections() const { return _sections; }
+    uint64_t Events() const { return _events; }
+    uint64_t CRCErrors() const { return _crcErrors; }
+    uint64_t MalformedSections() const { return _malformedSections; }
+    const SectionAssembler & Assembler() const { return _assembler; }
+
+private:
+    EitSectionHandler & _handler;
+    SectionAssembler _assembler;
+    Arena _arena;
+    Counter _sections;
+    Counter _events;
+    Counter _crcErrors;
+    Counter _malformedSections;
+};
+
+// Buffers for the text of one event, kept between events so converting text does not allocate either
+struct EventText
+{
+    std::string title;
+    std::string text;
+    std::string extendedText;
+
+    void Clear()
+    {
+        title.clear();
+        text.clear();
+        extendedText.clear();
+    }
+};
+
+// Takes what the EPG keeps from one event descriptor: the language, title and text of the short event
+// descriptor, the items and text of the extended event descriptors, the genres of the content descriptor and the
+// strictest parental rating
+void AddEventDescriptor(uint8_t tag, const uint8_t * data, size_t length, EpgEvent & record, EventText & text);
+
+// Stores the events of a section that fall in the store's window. Returns the number of events in the section.
+size_t StoreEitSection(const EitSection & section, EpgStore & store, EventText & text);
+
+// MJD and BCD time as used in EIT, TDT and TOT: 5 bytes to Unix time, 3 bytes of BCD duration to seconds
+uint32_t DecodeDvbTime(const uint8_t * data);
+uint32_t DecodeDvbDuration(const uint8_t * data);
@@ -0,0 +1,93 @@
+#include "EpgChangeFeed.h"
+
+#include "EitDecoder.h"
+
+using namespace std;
+
+namespace {
+
+uint64_t SectionKey(const ServiceKey & key, uint8_t tableId, uint8_t sectionNumber)
+{
+    return (key.Packed() << 16) | (static_cast<uint64_t>(tableId) << 8) | sectionNumber;
+}
+
+uint64_t EventKey(const ServiceKey & key, uint16_t eventId)
+{
+    return (key.Packed() << 16) | eventId;
+}
+
+} // namespace
+
+EitEventTracker::EitEventTracker()
+    : _sections()
+    , _references()
+    , _eventIds()
+{
+}
+
+size_t EitEventTracker::Update(const EitSection & section, EpgStore & store)
+{
+    _eventIds.clear();
+    for (size_t index = 0; index < section.eventCount; ++index)
+        _eventIds.push_back(section.events[index].eventId);
+    ServiceKey key { section.originalNetworkId, section.transportStreamId, section.serviceId };
+    return Update(key, section.tableId, section.sectionNumber, section.version, _eventIds.data(), _eventIds.size(),
+                  store);
+}
+
+size_t EitEventTracker::Update(const ServiceKey & key, uint8_t tableId, uint8_t sectionNumber, uint8_t version,
+                               const uint16_t * eventIds, size_t count, EpgStore & store)
+{
+    auto inserted = _sections.emplace(SectionKey(key, tableId, sectionNumber), SectionEvents { version, {} });
+    SectionEvents & current = inserted.first->second;
+    if (!inserted.second && (current.version == version))
+        return 0;
+
+    // Count the new references first, so events that both versions carry never drop to zero
+    for (size_t index = 0; index < count; ++index)
+        ++_references[EventKey(key, eventIds[index])];
+    size_t removed = 0;
+    for (uint16_t eventId : current.eventIds)
+    {
+        auto references = _references.find(EventKey(key, eventId));
+        if (--references->second > 0)
+            continue;
+        _references.erase(references);
+        if (store.Remove(key, eventId))
+            ++removed;
+    }
+    current.version = version;
+    current.eventIds.assign(eventIds, eventIds + count);
+    return removed;
+}
+
+EpgChangeFeed::EpgChangeFeed(OutputFormat format, int fileHandle)
+    : _output(fileHandle)
+    , _sink(CreateEpgSink(format, _output))
+    , _pending(false)
+    , _added()
+    , _modified()
+    , _removed()
+{
+}
+
+void EpgChangeFeed::OnEventChange(EpgChange change, const ServiceKey & key, const EpgEvent & event,
+                                  const StringPool & strings)
+{
+    _sink->Change(change, key, event, strings.Table());
+    switch (change)
+    {
+    case EpgChange::Added: _added.Add(); break;
+    case EpgChange::Modified: _modified.Add(); break;
+    case EpgChange::Removed: _removed.Add(); break;
+    }
+    _pending = true;
+}
+
+void EpgChangeFeed::Flush()
+{
+    if (!_pending)
+        return;
+    _output.Flush();
+    _pending = false;
+}
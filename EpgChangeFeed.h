@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "EpgSink.h"
+#include "EpgStore.h"
+#include "Metrics.h"
+#include "OutputBuffer.h"
+
+struct EitSection;
+
+// Remembers which events the current version of every EIT section announces, so the events that a new version no
+// longer carries can be removed from the store. An event stays as long as some section, present/following or
+// schedule, still announces it.
+class EitEventTracker
+{
+public:
+    EitEventTracker();
+
+    // Records the events of a section and removes the events nobody announces anymore from the store. A repeat of
+    // the version already recorded changes nothing. Returns the number of events removed.
+    size_t Update(const EitSection & section, EpgStore & store);
+    // The same for libdvbpsi, which delivers whole tables: pass section number 0 for those
+    size_t Update(const ServiceKey & key, uint8_t tableId, uint8_t sectionNumber, uint8_t version,
+                  const uint16_t * eventIds, size_t count, EpgStore & store);
+
+    size_t SectionCount() const { return _sections.size(); }
+
+private:
+    struct SectionEvents
+    {
+        uint8_t version;
+        std::vector<uint16_t> eventIds;
+    };
+
+    // By service, table_id and section_number
+    std::unordered_map<uint64_t, SectionEvents> _sections;
+    // Number of sections announcing an event, by service and event_id
+    std::unordered_map<uint64_t, uint32_t> _references;
+    std::vector<uint16_t> _eventIds;
+};
+
+// Writes the changes to an EpgStore to a file handle as they are made: added, modified and removed events only,
+// instead of the whole guide. Set it as the store's change listener. Formats are those of EpgSink::Change.
+class EpgChangeFeed : public EpgChangeListener
+{
+public:
+    EpgChangeFeed(OutputFormat format, int fileHandle);
+
+    void OnEventChange(EpgChange change, const ServiceKey & key, const EpgEvent & event,
+                       const StringPool & strings) override;
+    // Writes out the changes made so far. Called after every decoded section, so consumers see changes as soon as
+    // they are decoded rather than when the buffer fills up.
+    void Flush();
+
+    uint64_t Added() const { return _added; }
+    uint64_t Modified() const { return _modified; }
+    uint64_t Removed() const { return _removed; }
+    // Written to the sink, Flush or not
+    uint64_t Changes() const { return _added + _modified + _removed; }
+
+private:
+    OutputBuffer _output;
+    std::unique_ptr<EpgSink> _sink;
+    bool _pending;
+    Counter _added;
+    Counter _modified;
+    Counter _removed;
+};
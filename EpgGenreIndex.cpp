@@ -0,0 +1,145 @@
+#include "EpgGenreIndex.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+const size_t WordBits = 64;
+
+bool StartsBefore(const EpgTimeIndex::GridEntry & first, const EpgTimeIndex::GridEntry & second)
+{
+    return first.event->start < second.event->start;
+}
+
+} // namespace
+
+EpgGenreIndex::EpgGenreIndex()
+    : _events()
+    , _starts()
+    , _maxDuration(0)
+    , _genres()
+    , _ratings()
+{
+}
+
+void EpgGenreIndex::Build(const EpgTimeIndex & index)
+{
+    _events.clear();
+    _maxDuration = 0;
+    for (size_t service = 0; service < index.ServiceCount(); ++service)
+    {
+        const EpgTimeIndex::Schedule & schedule = index.Service(service);
+        for (size_t event = 0; event < schedule.count; ++event)
+            _events.push_back(EpgTimeIndex::GridEntry { static_cast<uint32_t>(service), schedule.events + event });
+        _maxDuration = max(_maxDuration, schedule.maxDuration);
+    }
+    // Each service is sorted already, so this mostly merges
+    stable_sort(_events.begin(), _events.end(), StartsBefore);
+
+    size_t words = (_events.size() + WordBits - 1) / WordBits;
+    for (Bitmap & bitmap : _genres)
+        bitmap.assign(words, 0);
+    for (Bitmap & bitmap : _ratings)
+        bitmap.assign(words, 0);
+    _starts.resize(_events.size());
+    for (size_t number = 0; number < _events.size(); ++number)
+    {
+        const EpgEvent & event = *_events[number].event;
+        _starts[number] = event.start;
+        uint64_t bit = uint64_t(1) << (number % WordBits);
+        for (size_t genre = 0; genre < GenreCount; ++genre)
+        {
+            if (event.genres & (1u << genre))
+                _genres[genre][number / WordBits] |= bit;
+        }
+        _ratings[event.parentalRating % RatingCount][number / WordBits] |= bit;
+    }
+}
+
+void EpgGenreIndex::Select(const Query & query, Selection & selection) const
+{
+    for (size_t genre = 0; genre < GenreCount; ++genre)
+    {
+        if (query.genres & (1u << genre))
+            selection.genres.push_back(_genres[genre].data());
+    }
+    if (query.maxRating != 0)
+    {
+        for (size_t rating = 0; (rating <= query.maxRating) && (rating < RatingCount); ++rating)
+            selection.ratings.push_back(_ratings[rating].data());
+    }
+}
+
+uint64_t EpgGenreIndex::Word(const Selection & selection, size_t word, size_t first, size_t last) const
+{
+    uint64_t bits = ~uint64_t(0);
+    if (!selection.genres.empty())
+    {
+        uint64_t genres = 0;
+        for (const uint64_t * bitmap : selection.genres)
+            genres |= bitmap[word];
+        bits &= genres;
+    }
+    if (!selection.ratings.empty())
+    {
+        uint64_t ratings = 0;
+        for (const uint64_t * bitmap : selection.ratings)
+            ratings |= bitmap[word];
+        bits &= ratings;
+    }
+    // Cut off the bits outside [first, last)
+    size_t base = word * WordBits;
+    if (first > base)
+        bits &= ~uint64_t(0) << (first - base);
+    if (last < base + WordBits)
+        bits &= (uint64_t(1) << (last - base)) - 1;
+    return bits;
+}
+
+void EpgGenreIndex::Range(const Query & query, size_t & candidates, size_t & starting, size_t & end) const
+{
+    // No event starting before from - maxDuration can still be running at from
+    uint32_t earliest = (query.from > _maxDuration) ? query.from - _maxDuration : 0;
+    candidates = static_cast<size_t>(lower_bound(_starts.begin(), _starts.end(), earliest) - _starts.begin());
+    starting = static_cast<size_t>(lower_bound(_starts.begin(), _starts.end(), query.from) - _starts.begin());
+    end = static_cast<size_t>(lower_bound(_starts.begin(), _starts.end(), query.to) - _starts.begin());
+    starting = max(starting, candidates);
+    end = max(end, starting);
+}
+
+void EpgGenreIndex::Find(const Query & query, vector<EpgTimeIndex::GridEntry> & result) const
+{
+    result.clear();
+    size_t candidates = 0;
+    size_t starting = 0;
+    size_t end = 0;
+    Range(query, candidates, starting, end);
+    if (candidates == end)
+        return;
+    Selection selection;
+    Select(query, selection);
+    for (size_t word = candidates / WordBits; word <= (end - 1) / WordBits; ++word)
+    {
+        uint64_t bits = Word(selection, word, candidates, end);
+        while (bits != 0)
+        {
+            size_t number = word * WordBits + static_cast<size_t>(__builtin_ctzll(bits));
+            bits &= bits - 1;
+            // Events that started before from are only in the grid if they still run
+            if ((number >= starting) || (_events[number].event->End() > query.from))
+                result.push_back(_events[number]);
+        }
+    }
+}
+
+size_t EpgGenreIndex::MemoryUsage() const
+{
+    size_t result = _events.capacity() * sizeof(_events[0]) + _starts.capacity() * sizeof(uint32_t);
+    for (const Bitmap & bitmap : _genres)
+        result += bitmap.capacity() * sizeof(uint64_t);
+    for (const Bitmap & bitmap : _ratings)
+        result += bitmap.capacity() * sizeof(uint64_t);
+    return result;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "EpgTimeIndex.h"
+
+// Genre and parental rating filters over all events of an EpgTimeIndex, kept as bitmaps. The events of all
+// services are numbered in start time order, so a time window is one range of bits, and there is a bitmap per
+// level 1 genre and per parental rating. A query ORs the bitmaps of the genres and ratings it takes and ANDs the
+// result with the time range, a 64 bit word at a time; only the events whose bits are left are looked at.
+// The index points into the time index's source; rebuild it after the store changes.
+class EpgGenreIndex
+{
+public:
+    static const size_t GenreCount = 16;
+    static const size_t RatingCount = 16;
+
+    struct Query
+    {
+        uint16_t genres;        // Bit per level 1 genre (EpgEvent::genres), 0 for any
+        uint8_t maxRating;      // Strictest parental rating to include, 0 for any. Unrated events are included.
+        uint32_t from;
+        uint32_t to;
+    };
+
+    EpgGenreIndex();
+
+    // Whether the event passes the genre and rating filter of the query; the time range is not looked at
+    static bool Matches(const Query & query, const EpgEvent & event)
+    {
+        return ((query.genres == 0) || ((event.genres & query.genres) != 0)) &&
+               ((query.maxRating == 0) || (event.parentalRating <= query.maxRating));
+    }
+
+    void Build(const EpgTimeIndex & index);
+
+    // Events overlapping [from, to) that match, in start time order. result is cleared first.
+    void Find(const Query & query, std::vector<EpgTimeIndex::GridEntry> & result) const;
+
+    size_t EventCount() const { return _events.size(); }
+    size_t MemoryUsage() const;
+
+private:
+    typedef std::vector<uint64_t> Bitmap;
+
+    struct Selection
+    {
+        std::vector<const uint64_t *> genres;
+        std::vector<const uint64_t *> ratings;
+    };
+
+    void Select(const Query & query, Selection & selection) const;
+    // Matching bits of the word, for the events [first, last)
+    uint64_t Word(const Selection & selection, size_t word, size_t first, size_t last) const;
+    // Events that may still run at from, and the first event starting at or after from and at to
+    void Range(const Query & query, size_t & candidates, size_t & starting, size_t & end) const;
+
+    std::vector<EpgTimeIndex::GridEntry> _events;
+    std::vector<uint32_t> _starts;
+    uint32_t _maxDuration;
+    Bitmap _genres[GenreCount];
+    // Rating 0 holds the unrated events
+    Bitmap _ratings[RatingCount];
+};
@@ -0,0 +1,291 @@
+#include "EpgSharedMemory.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const char SharedEpgWriter::Magic[8] = { 'D', 'V', 'B', 'E', 'P', 'G', 'M', '\0' };
+const chrono::milliseconds SharedEpgWriter::PublishInterval(1000);
+
+namespace {
+
+const size_t PageSize = 4096;
+
+size_t AlignToPage(size_t size)
+{
+    return (size + PageSize - 1) & ~(PageSize - 1);
+}
+
+// shm_open wants a name starting with a slash
+string SegmentName(const string & name)
+{
+    return ((name.size() > 0) && (name[0] == '/')) ? name : "/" + name;
+}
+
+} // namespace
+
+SharedEpgWriter::SharedEpgWriter()
+    : _name()
+    , _segment(nullptr)
+    , _segmentSize(0)
+    , _header(nullptr)
+    , _generation(0)
+    , _lastPublished()
+    , _publications()
+    , _oversized()
+    , _lastSize()
+{
+}
+
+SharedEpgWriter::~SharedEpgWriter()
+{
+    Close();
+}
+
+bool SharedEpgWriter::Create(const string & name, size_t slotCapacity)
+{
+    Close();
+    if (!atomic<uint64_t>().is_lock_free())
+    {
+        cerr << "Shared memory publication needs lock-free 64 bit atomics" << endl;
+        return false;
+    }
+    _name = SegmentName(name);
+    slotCapacity = AlignToPage(slotCapacity);
+    size_t headerSize = AlignToPage(sizeof(SharedEpgHeader));
+    size_t segmentSize = headerSize + SharedEpgHeader::SlotCount * slotCapacity;
+
+    // A new segment rather than the old one resized, as readers may still have that mapped
+    shm_unlink(_name.c_str());
+    int fileHandle = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fileHandle < 0)
+    {
+        cerr << "Cannot create shared memory " << _name << ": " << strerror(errno) << endl;
+        return false;
+    }
+    if (ftruncate(fileHandle, static_cast<off_t>(segmentSize)) != 0)
+    {
+        cerr << "Cannot size shared memory " << _name << ": " << strerror(errno) << endl;
+        close(fileHandle);
+        shm_unlink(_name.c_str());
+        return false;
+    }
+    void * mapping = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileHandle, 0);
+    close(fileHandle);
+    if (mapping == MAP_FAILED)
+    {
+        cerr << "Cannot map shared memory " << _name << ": " << strerror(errno) << endl;
+        shm_unlink(_name.c_str());
+        return false;
+    }
+    _segment = static_cast<uint8_t *>(mapping);
+    _segmentSize = segmentSize;
+
+    // The segment starts out zeroed; the magic goes in last, so a reader never takes a half set up header
+    SharedEpgHeader * header = new (_segment) SharedEpgHeader;
+    header->formatVersion = FormatVersion;
+    header->slotCount = SharedEpgHeader::SlotCount;
+    header->slotCapacity = slotCapacity;
+    header->segmentSize = segmentSize;
+    header->published.store(0, memory_order_relaxed);
+    header->writerOpen.store(1, memory_order_relaxed);
+    header->reserved = 0;
+    for (uint32_t slot = 0; slot < SharedEpgHeader::SlotCount; ++slot)
+    {
+        header->slots[slot].sequence.store(0, memory_order_relaxed);
+        header->slots[slot].size.store(0, memory_order_relaxed);
+        header->slots[slot].offset = headerSize + slot * slotCapacity;
+    }
+    atomic_thread_fence(memory_order_release);
+    memcpy(header->magic, Magic, sizeof(Magic));
+    _header = header;
+    // The first change is published right away
+    _generation = 0;
+    _lastPublished = chrono::steady_clock::time_point();
+    return true;
+}
+
+void SharedEpgWriter::Close()
+{
+    if (_header)
+        _header->writerOpen.store(0, memory_order_release);
+    if (_segment)
+        munmap(_segment, _segmentSize);
+    _segment = nullptr;
+    _segmentSize = 0;
+    _header = nullptr;
+}
+
+void SharedEpgWriter::Update(const EpgStore & store)
+{
+    if (!_header || (store.Generation() == _generation))
+        return;
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    if (now - _lastPublished < PublishInterval)
+        return;
+    Publish(store);
+}
+
+bool SharedEpgWriter::Publish(const EpgStore & store)
+{
+    if (!_header)
+        return false;
+    _generation = store.Generation();
+    _lastPublished = chrono::steady_clock::now();
+
+    uint64_t publication = _header->published.load(memory_order_relaxed) + 1;
+    SharedEpgSlot & slot = _header->slots[publication % SharedEpgHeader::SlotCount];
+    uint64_t sequence = slot.sequence.load(memory_order_relaxed);
+    // Odd from here: a reader still using this slot finds its guide gone when it checks
+    slot.sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    size_t size = EpgSnapshot::Write(store, _segment + slot.offset, static_cast<size_t>(_header->slotCapacity));
+    if (size == 0)
+    {
+        // Nothing was written, the slot still holds what it held
+        slot.sequence.store(sequence, memory_order_release);
+        if (_oversized == 0)
+            cerr << "The EPG does not fit in a shared memory slot of " << (_header->slotCapacity >> 20)
+                 << " MiB, it is not published" << endl;
+        _oversized.Add();
+        return false;
+    }
+    slot.size.store(size, memory_order_relaxed);
+    slot.sequence.store(sequence + 2, memory_order_release);
+    _header->published.store(publication, memory_order_release);
+    _publications.Add();
+    _lastSize.Set(size);
+    return true;
+}
+
+SharedEpgReader::SharedEpgReader()
+    : _segment(nullptr)
+    , _segmentSize(0)
+    , _header(nullptr)
+    , _slot(0)
+    , _sequence(0)
+    , _retries(0)
+{
+}
+
+SharedEpgReader::~SharedEpgReader()
+{
+    Close();
+}
+
+bool SharedEpgReader::Open(const string & name)
+{
+    Close();
+    string segmentName = SegmentName(name);
+    int fileHandle = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    if (fileHandle < 0)
+    {
+        cerr << "Cannot open shared memory " << segmentName << ": " << strerror(errno) << endl;
+        return false;
+    }
+    struct stat status;
+    if ((fstat(fileHandle, &status) != 0) || (static_cast<size_t>(status.st_size) < sizeof(SharedEpgHeader)))
+    {
+        cerr << segmentName << " is not a published EPG" << endl;
+        close(fileHandle);
+        return false;
+    }
+    size_t segmentSize = static_cast<size_t>(status.st_size);
+    void * mapping = mmap(nullptr, segmentSize, PROT_READ, MAP_SHARED, fileHandle, 0);
+    close(fileHandle);
+    if (mapping == MAP_FAILED)
+    {
+        cerr << "Cannot map shared memory " << segmentName << ": " << strerror(errno) << endl;
+        return false;
+    }
+    _segment = static_cast<const uint8_t *>(mapping);
+    _segmentSize = segmentSize;
+
+    const SharedEpgHeader * header = static_cast<const SharedEpgHeader *>(mapping);
+    bool valid = (memcmp(header->magic, SharedEpgWriter::Magic, sizeof(SharedEpgWriter::Magic)) == 0);
+    atomic_thread_fence(memory_order_acquire);
+    valid = valid && (header->formatVersion == SharedEpgWriter::FormatVersion) &&
+            (header->slotCount == SharedEpgHeader::SlotCount) && (header->segmentSize <= segmentSize);
+    for (uint32_t slot = 0; valid && (slot < SharedEpgHeader::SlotCount); ++slot)
+    {
+        valid = (header->slots[slot].offset % PageSize == 0) && (header->slots[slot].offset <= segmentSize) &&
+                (header->slotCapacity <= segmentSize - header->slots[slot].offset);
+    }
+    if (!valid)
+    {
+        cerr << segmentName << " is not a published EPG" << endl;
+        Close();
+        return false;
+    }
+    _header = header;
+    return true;
+}
+
+void SharedEpgReader::Close()
+{
+    if (_segment)
+        munmap(const_cast<uint8_t *>(_segment), _segmentSize);
+    _segment = nullptr;
+    _segmentSize = 0;
+    _header = nullptr;
+}
+
+bool SharedEpgReader::Acquire(EpgSnapshot & snapshot)
+{
+    if (!_header)
+        return false;
+    for (;;)
+    {
+        uint64_t publication = _header->published.load(memory_order_acquire);
+        if (publication == 0)
+            return false;
+        _slot = static_cast<uint32_t>(publication % SharedEpgHeader::SlotCount);
+        const SharedEpgSlot & slot = _header->slots[_slot];
+        _sequence = slot.sequence.load(memory_order_acquire);
+        if ((_sequence & 1) == 0)
+        {
+            size_t size = static_cast<size_t>(slot.size.load(memory_order_relaxed));
+            if (size > _header->slotCapacity)
+                size = static_cast<size_t>(_header->slotCapacity);
+            // A snapshot overwritten while it is attached is caught by Validate, either way
+            bool attached = snapshot.Attach(_segment + slot.offset, size);
+            if (Validate())
+                return attached;
+        }
+        // The writer has come round to this slot again since the publication was read
+        ++_retries;
+    }
+}
+
+bool SharedEpgReader::Validate() const
+{
+    if (!_header)
+        return false;
+    atomic_thread_fence(memory_order_acquire);
+    return _header->slots[_slot].sequence.load(memory_order_relaxed) == _sequence;
+}
+
+bool SharedEpgReader::Read(vector<uint64_t> & buffer, EpgSnapshot & snapshot)
+{
+    EpgSnapshot current;
+    for (;;)
+    {
+        if (!Acquire(current))
+            return false;
+        const SharedEpgSlot & slot = _header->slots[_slot];
+        size_t size = current.Size();
+        buffer.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        memcpy(buffer.data(), _segment + slot.offset, size);
+        if (Validate())
+            break;
+        ++_retries;
+    }
+    return snapshot.Attach(buffer.data(), current.Size());
+}
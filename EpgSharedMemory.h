@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "EpgSnapshot.h"
+#include "EpgStore.h"
+#include "Metrics.h"
+
+// The EPG published in a POSIX shared memory segment, for local processes that need the current guide without
+// decoding it themselves. The segment holds a header and two slots; every publication writes a complete EpgSnapshot
+// into the slot the last one did not use, then makes it the current one. Each slot has its own sequence number,
+// odd while the writer fills it (a seqlock), so a reader maps the segment read-only, attaches an EpgSnapshot to the
+// current slot and checks afterwards that the sequence did not change: no locks and no system calls on the read
+// path, and the writer never waits for a reader. A reader that is too slow (the writer came round to its slot
+// again) sees the check fail and reads the newer guide instead.
+struct SharedEpgSlot
+{
+    std::atomic<uint64_t> sequence;     // Odd while the writer fills the slot
+    std::atomic<uint64_t> size;         // Of the snapshot in the slot
+    uint64_t offset;                    // From the start of the segment, page aligned
+};
+
+struct SharedEpgHeader
+{
+    static const uint32_t SlotCount = 2;
+
+    char magic[8];
+    uint32_t formatVersion;             // Of the segment layout; the slots hold snapshots with their own version
+    uint32_t slotCount;
+    uint64_t slotCapacity;
+    uint64_t segmentSize;
+    // Number of the last publication, 0 before the first. Its slot is published % SlotCount.
+    std::atomic<uint64_t> published;
+    // Cleared when the writer closes the segment; a writer started later creates a new one under the same name
+    std::atomic<uint32_t> writerOpen;
+    uint32_t reserved;
+    SharedEpgSlot slots[SlotCount];
+};
+
+// Publishes an EpgStore. Used on the thread that changes the store.
+class SharedEpgWriter
+{
+public:
+    static const char Magic[8];
+    static const uint32_t FormatVersion = 1;
+    // Slot pages are only backed by memory once written to, so a generous size costs nothing up front
+    static const size_t DefaultSlotCapacity = 256 << 20;
+    // Changes are published at most this often; Publish publishes right away
+    static const std::chrono::milliseconds PublishInterval;
+
+    SharedEpgWriter();
+    ~SharedEpgWriter();
+
+    // Creates the segment, replacing one left by an earlier writer. Readers that still have that one mapped keep the
+    // last guide it held, and see WriterClosed.
+    bool Create(const std::string & name, size_t slotCapacity = DefaultSlotCapacity);
+    // Marks the segment closed and unmaps it. The segment stays, so readers can still open the last guide.
+    void Close();
+    bool IsOpen() const { return _header != nullptr; }
+
+    // Publishes the store if it changed and the last publication is PublishInterval ago
+    void Update(const EpgStore & store);
+    // Publishes the store now. Returns false if its snapshot does not fit in a slot.
+    bool Publish(const EpgStore & store);
+
+    uint64_t Publications() const { return _publications; }
+    // Publications dropped as the snapshot was larger than a slot
+    uint64_t Oversized() const { return _oversized; }
+    uint64_t LastSize() const { return _lastSize; }
+    const std::string & Name() const { return _name; }
+
+private:
+    SharedEpgWriter(const SharedEpgWriter &) = delete;
+    SharedEpgWriter & operator = (const SharedEpgWriter &) = delete;
+
+    std::string _name;
+    uint8_t * _segment;
+    size_t _segmentSize;
+    SharedEpgHeader * _header;
+    uint64_t _generation;
+    std::chrono::steady_clock::time_point _lastPublished;
+    Counter _publications;
+    Counter _oversized;
+    Counter _lastSize;
+};
+
+// Reads the EPG a SharedEpgWriter publishes, from another process
+class SharedEpgReader
+{
+public:
+    SharedEpgReader();
+    ~SharedEpgReader();
+
+    bool Open(const std::string & name);
+    void Close();
+    bool IsOpen() const { return _header != nullptr; }
+
+    // Attaches snapshot to the current guide in place. Returns false if nothing has been published yet.
+    // The guide can be overwritten at any time; check Validate after using it, and Acquire again if that fails.
+    bool Acquire(EpgSnapshot & snapshot);
+    // Whether the guide of the last Acquire was left alone until now
+    bool Validate() const;
+    // Copies the current guide into buffer and attaches snapshot to the copy, which stays valid for as long as
+    // buffer does. Returns false if nothing has been published yet.
+    bool Read(std::vector<uint64_t> & buffer, EpgSnapshot & snapshot);
+
+    // Number of the last publication, to tell cheaply whether there is a newer guide
+    uint64_t Published() const { return _header ? _header->published.load(std::memory_order_acquire) : 0; }
+    // Whether the writer of this segment has gone; reopen to find a new one
+    bool WriterClosed() const { return !_header || (_header->writerOpen.load(std::memory_order_acquire) == 0); }
+    // Number of times Acquire found a slot being written, or the guide it read overwritten
+    uint64_t Retries() const { return _retries; }
+
+private:
+    SharedEpgReader(const SharedEpgReader &) = delete;
+    SharedEpgReader & operator = (const SharedEpgReader &) = delete;
+
+    const uint8_t * _segment;
+    size_t _segmentSize;
+    const SharedEpgHeader * _header;
+    uint32_t _slot;
+    uint64_t _sequence;
+    uint64_t _retries;
+};
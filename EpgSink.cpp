@@ -0,0 +1,420 @@
+#include "EpgSink.h"
+
+#include <cstring>
+#include <ctime>
+#include "Descriptors.h"
+
+using namespace std;
+
+namespace {
+
+bool HasLanguage(uint32_t language)
+{
+    return ((language >> 16) & 0xFF) >= 'A';
+}
+
+void AppendLanguage(OutputBuffer & output, uint32_t language)
+{
+    char code[3] = { static_cast<char>(language >> 16), static_cast<char>(language >> 8), static_cast<char>(language) };
+    for (char & c : code)
+    {
+        if ((c >= 'A') && (c <= 'Z'))
+            c = static_cast<char>(c - 'A' + 'a');
+    }
+    output.Append(code, sizeof(code));
+}
+
+// Service id as used for XMLTV channels and in JSON: onid.tsid.sid
+void AppendServiceId(OutputBuffer & output, const ServiceKey & key)
+{
+    output.AppendUnsigned(key.originalNetworkId);
+    output.Append('.');
+    output.AppendUnsigned(key.transportStreamId);
+    output.Append('.');
+    output.AppendUnsigned(key.serviceId);
+}
+
+// Copies text, writing the characters for which escape returns a replacement as that replacement.
+// Runs of plain characters are appended in one go.
+template<typename Escape>
+void AppendEscaped(OutputBuffer & output, const char * text, size_t length, Escape escape)
+{
+    size_t runStart = 0;
+    for (size_t index = 0; index < length; ++index)
+    {
+        const char * replacement = escape(static_cast<uint8_t>(text[index]));
+        if (!replacement)
+            continue;
+        output.Append(text + runStart, index - runStart);
+        output.Append(replacement);
+        runStart = index + 1;
+    }
+    output.Append(text + runStart, length - runStart);
+}
+
+const char * JsonEscape(uint8_t c)
+{
+    static const char * ControlEscapes[32] =
+    {
+        "\\u0000", "\\u0001", "\\u0002", "\\u0003", "\\u0004", "\\u0005", "\\u0006", "\\u0007",
+        "\\b",     "\\t",     "\\n",     "\\u000b", "\\f",     "\\r",     "\\u000e", "\\u000f",
+        "\\u0010", "\\u0011", "\\u0012", "\\u0013", "\\u0014", "\\u0015", "\\u0016", "\\u0017",
+        "\\u0018", "\\u0019", "\\u001a", "\\u001b", "\\u001c", "\\u001d", "\\u001e", "\\u001f",
+    };
+    if (c < 0x20)
+        return ControlEscapes[c];
+    if (c == '"')
+        return "\\\"";
+    if (c == '\\')
+        return "\\\\";
+    return nullptr;
+}
+
+const char * XmlEscape(uint8_t c)
+{
+    switch (c)
+    {
+    case '&': return "&amp;";
+    case '<': return "&lt;";
+    case '>': return "&gt;";
+    case '"': return "&quot;";
+    case '\n':
+    case '\t':
+        return nullptr;
+    default:
+        // Other control characters are not allowed in XML 1.0
+        return (c < 0x20) ? "" : nullptr;
+    }
+}
+
+// Same layout as the iostream based listing: values as "    1 (0x0001)", times as dd-mm-yyyy hh:mm:ss local time
+class TextSink : public EpgSink
+{
+public:
+    explicit TextSink(OutputBuffer & output)
+        : EpgSink(output)
+        , _offset(0)
+        , _offsetValidFrom(1)
+        , _offsetValidUntil(0)
+    {}
+
+    void Service(const ServiceKey & key, size_t eventCount) override
+    {
+        _output.Append("\nService ");
+        AppendValue(key.originalNetworkId);
+        _output.Append(" / ", 3);
+        AppendValue(key.transportStreamId);
+        _output.Append(" / ", 3);
+        AppendValue(key.serviceId);
+        _output.Append(": ", 2);
+        _output.AppendUnsigned(eventCount);
+        _output.Append(" events\n");
+    }
+    void Event(const ServiceKey &, const EpgEvent & event, const StringTable & strings) override
+    {
+        _output.Append("  ", 2);
+        AppendTime(event.start);
+        _output.Append(" - ", 3);
+        AppendTime(event.End());
+        _output.Append(' ');
+        AppendValue(event.eventId);
+        _output.Append(' ');
+        _output.Append(strings.Data(event.title), strings.Length(event.title));
+        if (event.text != StringPool::Empty)
+        {
+            _output.Append(": ", 2);
+            _output.Append(strings.Data(event.text), strings.Length(event.text));
+        }
+        _output.Append('\n');
+    }
+    // The event line, after a +, ~ or - marker and the service id
+    void Change(EpgChange change, const ServiceKey & key, const EpgEvent & event, const StringTable & strings) override
+    {
+        static const char Markers[] = { '+', '~', '-' };
+        _output.Append(Markers[static_cast<int>(change)]);
+        _output.Append(' ');
+        AppendServiceId(_output, key);
+        Event(key, event, strings);
+    }
+
+private:
+    void AppendValue(uint16_t value)
+    {
+        _output.AppendUnsigned(value, 5);
+        _output.Append(" (0x", 4);
+        _output.AppendHex(value, 4);
+        _output.Append(')');
+    }
+    void AppendTime(uint32_t time)
+    {
+        // localtime_r is the expensive part. UTC offsets only change on a half hour, so one lookup per half hour
+        // covers all events starting in it.
+        if ((time < _offsetValidFrom) || (time >= _offsetValidUntil))
+        {
+            time_t value = time;
+            struct tm local;
+            localtime_r(&value, &local);
+            _offset = local.tm_gmtoff;
+            _offsetValidFrom = time - time % 1800;
+            _offsetValidUntil = _offsetValidFrom + 1800;
+        }
+        CivilTime civil = CivilTime::FromUnixTime(int64_t(time) + _offset);
+        _output.AppendUnsigned(civil.day, 2, '0');
+        _output.Append('-');
+        _output.AppendUnsigned(civil.month, 2, '0');
+        _output.Append('-');
+        _output.AppendUnsigned(civil.year, 4, '0');
+        _output.Append(' ');
+        _output.AppendUnsigned(civil.hour, 2, '0');
+        _output.Append(':');
+        _output.AppendUnsigned(civil.minute, 2, '0');
+        _output.Append(':');
+        _output.AppendUnsigned(civil.second, 2, '0');
+    }
+
+    long _offset;
+    uint32_t _offsetValidFrom;
+    uint32_t _offsetValidUntil;
+};
+
+// One object per event per line:
+// {"service":"1.2.10","onid":1,"tsid":2,"sid":10,"event_id":3,"start":"...","duration":60,...}
+// Changes start with "change":"added", "modified" or "removed".
+class JsonSink : public EpgSink
+{
+public:
+    explicit JsonSink(OutputBuffer & output) : EpgSink(output) {}
+
+    void Service(const ServiceKey &, size_t) override {}
+    void Event(const ServiceKey & key, const EpgEvent & event, const StringTable & strings) override
+    {
+        _output.Append('{');
+        AppendEvent(key, event, strings);
+    }
+    void Change(EpgChange change, const ServiceKey & key, const EpgEvent & event, const StringTable & strings) override
+    {
+        _output.Append("{\"change\":\"");
+        _output.Append(EpgChangeName(change));
+        _output.Append("\",");
+        AppendEvent(key, event, strings);
+    }
+
+private:
+    void AppendEvent(const ServiceKey & key, const EpgEvent & event, const StringTable & strings)
+    {
+        _output.Append("\"service\":\"");
+        AppendServiceId(_output, key);
+        _output.Append("\",\"onid\":");
+        _output.AppendUnsigned(key.originalNetworkId);
+        _output.Append(",\"tsid\":");
+        _output.AppendUnsigned(key.transportStreamId);
+        _output.Append(",\"sid\":");
+        _output.AppendUnsigned(key.serviceId);
+        _output.Append(",\"event_id\":");
+        _output.AppendUnsigned(event.eventId);
+        _output.Append(",\"start\":\"");
+        _output.AppendIsoTime(event.start);
+        _output.Append("\",\"duration\":");
+        _output.AppendUnsigned(event.duration);
+        _output.Append(",\"running_status\":");
+        _output.AppendUnsigned(event.RunningStatus());
+        _output.Append(",\"free_ca\":");
+        _output.Append((event.flags & EpgEvent::FreeCAFlag) ? "true" : "false");
+        if (HasLanguage(event.language))
+        {
+            _output.Append(",\"language\":\"");
+            AppendLanguage(_output, event.language);
+            _output.Append('"');
+        }
+        if (event.genres != 0)
+        {
+            _output.Append(",\"content\":");
+            _output.AppendUnsigned(event.content);
+            if (const char * genre = ContentGenreName(event.Genre()))
+            {
+                _output.Append(",\"genre\":\"");
+                _output.Append(genre);
+                _output.Append('"');
+            }
+        }
+        if (event.parentalRating != 0)
+        {
+            _output.Append(",\"minimum_age\":");
+            _output.AppendUnsigned(ParentalRatingDescriptor::MinimumAge(event.parentalRating));
+        }
+        AppendString("title", event.title, strings);
+        AppendString("text", event.text, strings);
+        AppendString("extended_text", event.extendedText, strings);
+        _output.Append("}\n", 2);
+    }
+    void AppendString(const char * name, uint32_t id, const StringTable & strings)
+    {
+        if (id == StringPool::Empty)
+            return;
+        _output.Append(",\"");
+        _output.Append(name);
+        _output.Append("\":\"");
+        AppendEscaped(_output, strings.Data(id), strings.Length(id), JsonEscape);
+        _output.Append('"');
+    }
+};
+
+class XmltvSink : public EpgSink
+{
+public:
+    XmltvSink(OutputBuffer & output, const ServiceNames * names) : EpgSink(output), _names(names) {}
+
+    void Begin(const vector<ServiceKey> & services) override
+    {
+        _output.Append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                       "<!DOCTYPE tv SYSTEM \"xmltv.dtd\">\n"
+                       "<tv generator-info-name=\"dvbepg\">\n");
+        // The service name where the SDT gave one, and the DVB triplet, which always names the channel
+        for (const ServiceKey & key : services)
+        {
+            _output.Append("  <channel id=\"");
+            AppendServiceId(_output, key);
+            _output.Append("\">\n");
+            string name = _names ? _names->Name(key) : string();
+            if (!name.empty())
+            {
+                _output.Append("    <display-name>");
+                AppendEscaped(_output, name.data(), name.size(), XmlEscape);
+                _output.Append("</display-name>\n");
+            }
+            _output.Append("    <display-name>");
+            AppendServiceId(_output, key);
+            _output.Append("</display-name>\n  </channel>\n");
+        }
+    }
+    void Service(const ServiceKey &, size_t) override {}
+    void Event(const ServiceKey & key, const EpgEvent & event, const StringTable & strings) override
+    {
+        _output.Append("  <programme start=\"");
+        _output.AppendXmltvTime(event.start);
+        _output.Append("\" stop=\"");
+        _output.AppendXmltvTime(event.End());
+        _output.Append("\" channel=\"");
+        AppendServiceId(_output, key);
+        _output.Append("\">\n");
+        AppendElement("title", event.title, event.language, strings);
+        AppendElement("sub-title", event.text, event.language, strings);
+        AppendElement("desc", event.extendedText, event.language, strings);
+        if (const char * genre = (event.genres != 0) ? ContentGenreName(event.Genre()) : nullptr)
+        {
+            _output.Append("    <category lang=\"en\">");
+            _output.Append(genre);
+            _output.Append("</category>\n");
+        }
+        if (event.parentalRating != 0)
+        {
+            _output.Append("    <rating system=\"DVB\">\n      <value>");
+            _output.AppendUnsigned(ParentalRatingDescriptor::MinimumAge(event.parentalRating));
+            _output.Append("</value>\n    </rating>\n");
+        }
+        _output.Append("  </programme>\n");
+    }
+    void End() override
+    {
+        _output.Append("</tv>\n");
+    }
+
+private:
+    void AppendElement(const char * name, uint32_t id, uint32_t language, const StringTable & strings)
+    {
+        if (id == StringPool::Empty)
+            return;
+        _output.Append("    <");
+        _output.Append(name);
+        if (HasLanguage(language))
+        {
+            _output.Append(" lang=\"");
+            AppendLanguage(_output, language);
+            _output.Append('"');
+        }
+        _output.Append('>');
+        AppendEscaped(_output, strings.Data(id), strings.Length(id), XmlEscape);
+        _output.Append("</");
+        _output.Append(name);
+        _output.Append(">\n");
+    }
+
+    const ServiceNames * _names;
+};
+
+} // namespace
+
+const char * OutputFormatName(OutputFormat format)
+{
+    switch (format)
+    {
+    case OutputFormat::Text: return "text";
+    case OutputFormat::Json: return "json";
+    case OutputFormat::Xmltv: return "xmltv";
+    }
+    return "?";
+}
+
+bool ParseOutputFormat(const char * text, OutputFormat & format)
+{
+    string value = text;
+    if (value == "text")
+        format = OutputFormat::Text;
+    else if (value == "json")
+        format = OutputFormat::Json;
+    else if (value == "xmltv")
+        format = OutputFormat::Xmltv;
+    else
+        return false;
+    return true;
+}
+
+unique_ptr<EpgSink> CreateEpgSink(OutputFormat format, OutputBuffer & output, const ServiceNames * names)
+{
+    switch (format)
+    {
+    case OutputFormat::Json: return unique_ptr<EpgSink>(new JsonSink(output));
+    case OutputFormat::Xmltv: return unique_ptr<EpgSink>(new XmltvSink(output, names));
+    case OutputFormat::Text:
+    default:
+        return unique_ptr<EpgSink>(new TextSink(output));
+    }
+}
+
+void WriteEpg(const EpgStore & store, EpgSink & sink)
+{
+    vector<ServiceKey> services;
+    services.reserve(store.ServiceCount());
+    for (size_t index = 0; index < store.ServiceCount(); ++index)
+        services.push_back(store.Service(index).key);
+    sink.Begin(services);
+    StringTable strings = store.Strings().Table();
+    for (size_t index = 0; index < store.ServiceCount(); ++index)
+    {
+        const ServiceSchedule & schedule = store.Service(index);
+        sink.Service(schedule.key, schedule.events.size());
+        for (const EpgEvent & event : schedule.events)
+            sink.Event(schedule.key, event, strings);
+    }
+    sink.End();
+}
+
+void WriteEpg(const EpgSnapshot & snapshot, EpgSink & sink)
+{
+    vector<ServiceKey> services;
+    services.reserve(snapshot.ServiceCount());
+    for (size_t index = 0; index < snapshot.ServiceCount(); ++index)
+        services.push_back(snapshot.Service(index).Key());
+    sink.Begin(services);
+    StringTable strings = snapshot.Strings();
+    for (size_t index = 0; index < snapshot.ServiceCount(); ++index)
+    {
+        const SnapshotService & service = snapshot.Service(index);
+        ServiceKey key = service.Key();
+        sink.Service(key, service.eventCount);
+        const EpgEvent * events = snapshot.Events(service);
+        for (size_t event = 0; event < service.eventCount; ++event)
+            sink.Event(key, events[event], strings);
+    }
+    sink.End();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "EpgSnapshot.h"
+#include "EpgStore.h"
+#include "OutputBuffer.h"
+
+enum class OutputFormat
+{
+    Text,       // human readable listing
+    Json,       // one JSON object per event per line
+    Xmltv,      // XMLTV document
+};
+
+const char * OutputFormatName(OutputFormat format);
+bool ParseOutputFormat(const char * text, OutputFormat & format);
+
+// The names of the services, for the formats that list them
+class ServiceNames
+{
+public:
+    virtual ~ServiceNames() {}
+
+    // Empty if the service is not known
+    virtual std::string Name(const ServiceKey & key) const = 0;
+};
+
+// Writes a guide to an OutputBuffer in some format. Begin gets all services up front (XMLTV lists the channels
+// before the programmes), then every service is passed to Service followed by its events in start time order.
+class EpgSink
+{
+public:
+    explicit EpgSink(OutputBuffer & output) : _output(output) {}
+    virtual ~EpgSink() {}
+
+    virtual void Begin(const std::vector<ServiceKey> &) {}
+    virtual void Service(const ServiceKey & key, size_t eventCount) = 0;
+    virtual void Event(const ServiceKey & key, const EpgEvent & event, const StringTable & strings) = 0;
+    virtual void End() {}
+    // One entry of a change feed (see EpgChangeFeed), outside Begin and End. Formats without a notation for
+    // changes write the event as it is.
+    virtual void Change(EpgChange, const ServiceKey & key, const EpgEvent & event, const StringTable & strings)
+    {
+        Event(key, event, strings);
+    }
+
+protected:
+    OutputBuffer & _output;
+};
+
+// Without names, the DVB triplet names the services
+std::unique_ptr<EpgSink> CreateEpgSink(OutputFormat format, OutputBuffer & output,
+                                       const ServiceNames * names = nullptr);
+
+// Feeds a complete guide to the sink
+void WriteEpg(const EpgStore & store, EpgSink & sink);
+void WriteEpg(const EpgSnapshot & snapshot, EpgSink & sink);
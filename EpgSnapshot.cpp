@@ -0,0 +1,279 @@
+#include "EpgSnapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const char EpgSnapshot::Magic[8] = { 'D', 'V', 'B', 'E', 'P', 'G', 'S', '\0' };
+
+namespace {
+
+uint64_t Align(uint64_t offset)
+{
+    return (offset + 7) & ~uint64_t(7);
+}
+
+bool WriteAll(int fileHandle, const void * data, size_t size)
+{
+    const uint8_t * bytes = static_cast<const uint8_t *>(data);
+    while (size > 0)
+    {
+        ssize_t written = write(fileHandle, bytes, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool WritePadding(int fileHandle, uint64_t & offset)
+{
+    static const uint8_t Zeros[8] = {};
+    uint64_t aligned = Align(offset);
+    bool result = WriteAll(fileHandle, Zeros, static_cast<size_t>(aligned - offset));
+    offset = aligned;
+    return result;
+}
+
+bool ServiceKeyBefore(const SnapshotService & service, uint64_t key)
+{
+    return service.Key().Packed() < key;
+}
+
+// Header and service index of the snapshot of the store
+SnapshotHeader Layout(const EpgStore & store, vector<SnapshotService> & services)
+{
+    const StringPool & strings = store.Strings();
+    SnapshotHeader header {};
+    memcpy(header.magic, EpgSnapshot::Magic, sizeof(header.magic));
+    header.formatVersion = EpgSnapshot::FormatVersion;
+    header.byteOrder = SnapshotHeader::ByteOrderMark;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.serviceSize = sizeof(SnapshotService);
+    header.eventSize = sizeof(EpgEvent);
+    header.serviceCount = static_cast<uint32_t>(store.ServiceCount());
+
+    services.clear();
+    services.reserve(store.ServiceCount());
+    uint64_t eventCount = 0;
+    for (size_t index = 0; index < store.ServiceCount(); ++index)
+    {
+        const ServiceSchedule & schedule = store.Service(index);
+        services.push_back(SnapshotService { schedule.key.originalNetworkId, schedule.key.transportStreamId,
+                                             schedule.key.serviceId, 0, eventCount, schedule.events.size() });
+        eventCount += schedule.events.size();
+    }
+    header.eventCount = eventCount;
+    header.servicesOffset = Align(sizeof(SnapshotHeader));
+    header.eventsOffset = Align(header.servicesOffset + services.size() * sizeof(SnapshotService));
+    header.stringsOffset = Align(header.eventsOffset + eventCount * sizeof(EpgEvent));
+    header.stringsSize = strings.Bytes();
+    header.fileSize = header.stringsOffset + header.stringsSize;
+    return header;
+}
+
+} // namespace
+
+bool EpgSnapshot::Write(const EpgStore & store, const string & path)
+{
+    const StringPool & strings = store.Strings();
+    vector<SnapshotService> services;
+    SnapshotHeader header = Layout(store, services);
+    uint64_t eventCount = header.eventCount;
+
+    string temporaryPath = path + ".tmp";
+    int fileHandle = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fileHandle < 0)
+    {
+        cerr << "Cannot create " << temporaryPath << ": " << strerror(errno) << endl;
+        return false;
+    }
+    uint64_t offset = sizeof(header);
+    bool ok = WriteAll(fileHandle, &header, sizeof(header)) && WritePadding(fileHandle, offset) &&
+              WriteAll(fileHandle, services.data(), services.size() * sizeof(SnapshotService));
+    offset += services.size() * sizeof(SnapshotService);
+    ok = ok && WritePadding(fileHandle, offset);
+    for (size_t index = 0; ok && (index < store.ServiceCount()); ++index)
+    {
+        const vector<EpgEvent> & events = store.Service(index).events;
+        ok = WriteAll(fileHandle, events.data(), events.size() * sizeof(EpgEvent));
+    }
+    offset += eventCount * sizeof(EpgEvent);
+    ok = ok && WritePadding(fileHandle, offset) && WriteAll(fileHandle, strings.RawData(), strings.Bytes());
+    if (!ok)
+        cerr << "Cannot write " << temporaryPath << ": " << strerror(errno) << endl;
+    if (close(fileHandle) != 0)
+        ok = false;
+    if (ok && (rename(temporaryPath.c_str(), path.c_str()) != 0))
+    {
+        cerr << "Cannot rename " << temporaryPath << " to " << path << ": " << strerror(errno) << endl;
+        ok = false;
+    }
+    if (!ok)
+        unlink(temporaryPath.c_str());
+    return ok;
+}
+
+size_t EpgSnapshot::Write(const EpgStore & store, void * data, size_t size)
+{
+    vector<SnapshotService> services;
+    SnapshotHeader header = Layout(store, services);
+    if ((header.fileSize > size) || (reinterpret_cast<uintptr_t>(data) % 8 != 0))
+        return 0;
+    uint8_t * bytes = static_cast<uint8_t *>(data);
+    // The padding is zeroed like in a file, so the same store always gives the same bytes
+    memset(bytes, 0, static_cast<size_t>(header.stringsOffset));
+    memcpy(bytes, &header, sizeof(header));
+    memcpy(bytes + header.servicesOffset, services.data(), services.size() * sizeof(SnapshotService));
+    uint8_t * events = bytes + header.eventsOffset;
+    for (size_t index = 0; index < store.ServiceCount(); ++index)
+    {
+        const vector<EpgEvent> & schedule = store.Service(index).events;
+        memcpy(events, schedule.data(), schedule.size() * sizeof(EpgEvent));
+        events += schedule.size() * sizeof(EpgEvent);
+    }
+    memcpy(bytes + header.stringsOffset, store.Strings().RawData(), store.Strings().Bytes());
+    return static_cast<size_t>(header.fileSize);
+}
+
+EpgSnapshot::EpgSnapshot()
+    : _data(nullptr)
+    , _size(0)
+    , _mapping(MAP_FAILED)
+    , _mappingSize(0)
+    , _header(nullptr)
+    , _services(nullptr)
+    , _events(nullptr)
+    , _strings { "", 0 }
+{
+}
+
+EpgSnapshot::~EpgSnapshot()
+{
+    Close();
+}
+
+bool EpgSnapshot::Open(const string & path)
+{
+    Close();
+    int fileHandle = open(path.c_str(), O_RDONLY);
+    if (fileHandle < 0)
+    {
+        cerr << "Cannot open " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    struct stat status;
+    if ((fstat(fileHandle, &status) != 0) || !S_ISREG(status.st_mode) ||
+        (static_cast<size_t>(status.st_size) < sizeof(SnapshotHeader)))
+    {
+        cerr << path << " is not an EPG snapshot" << endl;
+        close(fileHandle);
+        return false;
+    }
+    _mappingSize = static_cast<size_t>(status.st_size);
+    _mapping = mmap(nullptr, _mappingSize, PROT_READ, MAP_SHARED, fileHandle, 0);
+    close(fileHandle);
+    if (_mapping == MAP_FAILED)
+    {
+        cerr << "Cannot map " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    // Lookups jump around in the service index and the events
+    madvise(_mapping, _mappingSize, MADV_RANDOM);
+    if (!Attach(_mapping, _mappingSize))
+    {
+        cerr << path << " is not a valid EPG snapshot" << endl;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool EpgSnapshot::Attach(const void * data, size_t size)
+{
+    _data = static_cast<const uint8_t *>(data);
+    _size = size;
+    if (Validate())
+        return true;
+    _data = nullptr;
+    _size = 0;
+    _header = nullptr;
+    return false;
+}
+
+void EpgSnapshot::Close()
+{
+    if (_mapping != MAP_FAILED)
+        munmap(_mapping, _mappingSize);
+    _mapping = MAP_FAILED;
+    _mappingSize = 0;
+    _data = nullptr;
+    _size = 0;
+    _header = nullptr;
+    _services = nullptr;
+    _events = nullptr;
+    _strings = StringTable { "", 0 };
+}
+
+bool EpgSnapshot::Validate()
+{
+    if ((_data == nullptr) || (_size < sizeof(SnapshotHeader)) || (reinterpret_cast<uintptr_t>(_data) % 8 != 0))
+        return false;
+    const SnapshotHeader * header = reinterpret_cast<const SnapshotHeader *>(_data);
+    if ((memcmp(header->magic, Magic, sizeof(Magic)) != 0) || (header->formatVersion != FormatVersion) ||
+        (header->byteOrder != SnapshotHeader::ByteOrderMark) || (header->headerSize != sizeof(SnapshotHeader)) ||
+        (header->serviceSize != sizeof(SnapshotService)) || (header->eventSize != sizeof(EpgEvent)))
+        return false;
+    // Every section must lie inside the data, in order, without overflowing
+    if ((header->fileSize > _size) ||
+        (header->servicesOffset < sizeof(SnapshotHeader)) || (header->servicesOffset % 8 != 0) ||
+        (header->serviceCount > (header->fileSize - header->servicesOffset) / sizeof(SnapshotService)) ||
+        (header->eventsOffset < header->servicesOffset + header->serviceCount * sizeof(SnapshotService)) ||
+        (header->eventsOffset % 8 != 0) || (header->eventsOffset > header->fileSize) ||
+        (header->eventCount > (header->fileSize - header->eventsOffset) / sizeof(EpgEvent)) ||
+        (header->stringsOffset < header->eventsOffset + header->eventCount * sizeof(EpgEvent)) ||
+        (header->stringsOffset > header->fileSize) ||
+        (header->stringsSize > header->fileSize - header->stringsOffset) ||
+        (header->stringsSize < sizeof(uint16_t) + 1))
+        return false;
+    const SnapshotService * services = reinterpret_cast<const SnapshotService *>(_data + header->servicesOffset);
+    // Checking the event ranges is one pass over the (small) service index, and keeps Events() unchecked
+    for (uint32_t index = 0; index < header->serviceCount; ++index)
+    {
+        if ((services[index].firstEvent > header->eventCount) ||
+            (services[index].eventCount > header->eventCount - services[index].firstEvent))
+            return false;
+    }
+    _header = header;
+    _services = services;
+    _events = reinterpret_cast<const EpgEvent *>(_data + header->eventsOffset);
+    _strings = StringTable { reinterpret_cast<const char *>(_data + header->stringsOffset),
+                             static_cast<size_t>(header->stringsSize) };
+    return true;
+}
+
+const SnapshotService * EpgSnapshot::Find(const ServiceKey & key) const
+{
+    if (!_header)
+        return nullptr;
+    uint64_t packed = key.Packed();
+    const SnapshotService * end = _services + _header->serviceCount;
+    const SnapshotService * position = lower_bound(_services, end, packed, ServiceKeyBefore);
+    if ((position == end) || (position->Key().Packed() != packed))
+        return nullptr;
+    return position;
+}
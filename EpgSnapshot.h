@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "EpgStore.h"
+
+// Binary EPG snapshot, laid out so a reader can map it and use it in place:
+//
+//   SnapshotHeader      fixed size, at offset 0
+//   SnapshotService[]   sorted by packed service key, at servicesOffset
+//   EpgEvent[]          the events of all services, each service's range sorted by start time, at eventsOffset
+//   string pool         StringPool entries (16 bit length, bytes, zero), event string ids are offsets, at stringsOffset
+//
+// All sections start at a multiple of 8 bytes. Values are in host byte order; byteOrder tells a reader on another
+// architecture that the file is not for it.
+struct SnapshotHeader
+{
+    static const uint32_t ByteOrderMark = 0x01020304;
+
+    char magic[8];
+    uint32_t formatVersion;
+    uint32_t byteOrder;
+    uint32_t headerSize;
+    uint32_t serviceSize;
+    uint32_t eventSize;
+    uint32_t serviceCount;
+    uint64_t eventCount;
+    uint64_t servicesOffset;
+    uint64_t eventsOffset;
+    uint64_t stringsOffset;
+    uint64_t stringsSize;
+    uint64_t fileSize;
+};
+static_assert(sizeof(SnapshotHeader) == 80, "SnapshotHeader layout is part of the file format");
+
+struct SnapshotService
+{
+    uint16_t originalNetworkId;
+    uint16_t transportStreamId;
+    uint16_t serviceId;
+    uint16_t reserved;
+    uint64_t firstEvent;
+    uint64_t eventCount;
+
+    ServiceKey Key() const { return ServiceKey { originalNetworkId, transportStreamId, serviceId }; }
+};
+static_assert(sizeof(SnapshotService) == 24, "SnapshotService layout is part of the file format");
+
+// Read-only view on a snapshot, either mapped from a file or attached to memory owned by someone else.
+// Opening only checks the header and the section bounds; nothing is parsed or copied.
+class EpgSnapshot
+{
+public:
+    static const char Magic[8];
+    static const uint32_t FormatVersion = 2;
+
+    // Writes the store to path. The file is written next to it and renamed into place, so a reader never maps a
+    // half written snapshot.
+    static bool Write(const EpgStore & store, const std::string & path);
+    // Lays the snapshot out in memory instead, at data (8 byte aligned). Returns its size, or 0 without writing
+    // anything if it needs more than size bytes.
+    static size_t Write(const EpgStore & store, void * data, size_t size);
+
+    EpgSnapshot();
+    ~EpgSnapshot();
+
+    bool Open(const std::string & path);
+    bool Attach(const void * data, size_t size);
+    void Close();
+    bool IsOpen() const { return _header != nullptr; }
+
+    size_t ServiceCount() const { return _header ? _header->serviceCount : 0; }
+    // Services in key order
+    const SnapshotService & Service(size_t index) const { return _services[index]; }
+    const SnapshotService * Find(const ServiceKey & key) const;
+    const EpgEvent * Events(const SnapshotService & service) const { return _events + service.firstEvent; }
+    size_t EventCount() const { return _header ? _header->eventCount : 0; }
+
+    // String ids outside the pool give the empty string
+    StringTable Strings() const { return _strings; }
+    std::string String(uint32_t id) const { return _strings.Get(id); }
+    size_t StringBytes() const { return _strings.size; }
+    size_t Size() const { return _size; }
+
+private:
+    EpgSnapshot(const EpgSnapshot &) = delete;
+    EpgSnapshot & operator = (const EpgSnapshot &) = delete;
+
+    bool Validate();
+
+    const uint8_t * _data;
+    size_t _size;
+    void * _mapping;
+    size_t _mappingSize;
+    const SnapshotHeader * _header;
+    const SnapshotService * _services;
+    const EpgEvent * _events;
+    StringTable _strings;
+};
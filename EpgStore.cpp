@@ -0,0 +1,260 @@
+#include "EpgStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include "Section.h"
+
+using namespace std;
+
+namespace {
+
+bool StartsBefore(const EpgEvent & event, uint32_t start)
+{
+    return event.start < start;
+}
+
+bool IndexKeyBefore(const pair<uint64_t, uint32_t> & entry, uint64_t key)
+{
+    return entry.first < key;
+}
+
+// Equal apart from the version number and the sub_table that carried it
+bool SameContent(const EpgEvent & event, const EpgEvent & other)
+{
+    EpgEvent probe = other;
+    probe.version = event.version;
+    probe.tableId = event.tableId;
+    return memcmp(&event, &probe, sizeof(EpgEvent)) == 0;
+}
+
+// Ranks the EIT sub_tables for events written by different ones, whose version numbers cannot be compared
+unsigned TablePrecedence(uint8_t tableId)
+{
+    return (IsActualEITTableId(tableId) ? 2u : 0u) + (IsPresentFollowingTableId(tableId) ? 1u : 0u);
+}
+
+// Whether a merge replaces the stored event with source
+bool Supersedes(const EpgEvent & source, const EpgEvent & stored)
+{
+    if (source.tableId == stored.tableId)
+        return IsNewerVersion(source.version, stored.version);
+    return TablePrecedence(source.tableId) > TablePrecedence(stored.tableId);
+}
+
+} // namespace
+
+const char * EpgChangeName(EpgChange change)
+{
+    switch (change)
+    {
+    case EpgChange::Added: return "added";
+    case EpgChange::Modified: return "modified";
+    case EpgChange::Removed: return "removed";
+    }
+    return "?";
+}
+
+EpgStore::EpgStore()
+    : _strings()
+    , _schedules()
+    , _index()
+    , _listener(nullptr)
+    , _windowed(false)
+    , _windowFrom(0)
+    , _windowUntil(0)
+    , _generation(0)
+{
+}
+
+ServiceSchedule & EpgStore::FindOrAdd(const ServiceKey & key)
+{
+    uint64_t packed = key.Packed();
+    auto position = lower_bound(_index.begin(), _index.end(), packed, IndexKeyBefore);
+    if ((position != _index.end()) && (position->first == packed))
+        return _schedules[position->second];
+
+    _index.insert(position, make_pair(packed, static_cast<uint32_t>(_schedules.size())));
+    _schedules.push_back(ServiceSchedule { key, vector<EpgEvent>() });
+    return _schedules.back();
+}
+
+const ServiceSchedule * EpgStore::Find(const ServiceKey & key) const
+{
+    uint64_t packed = key.Packed();
+    auto position = lower_bound(_index.begin(), _index.end(), packed, IndexKeyBefore);
+    if ((position == _index.end()) || (position->first != packed))
+        return nullptr;
+    return &_schedules[position->second];
+}
+
+bool EpgStore::Upsert(const ServiceKey & key, const EpgEvent & event)
+{
+    if (!InWindow(event))
+        return false;
+    vector<EpgEvent> & events = FindOrAdd(key).events;
+
+    // The common case is a repeat of an event we already have, at the same start time
+    auto position = lower_bound(events.begin(), events.end(), event.start, StartsBefore);
+    auto existing = events.end();
+    if ((position != events.end()) && (position->start == event.start) && (position->eventId == event.eventId))
+        existing = position;
+    else
+    {
+        existing = find_if(events.begin(), events.end(),
+                           [&event](const EpgEvent & other) { return other.eventId == event.eventId; });
+    }
+
+    EpgChange change = EpgChange::Added;
+    if (existing != events.end())
+    {
+        if (existing->start == event.start)
+        {
+            // EpgEvent has no padding, so comparing the bytes is comparing all fields
+            if (memcmp(&*existing, &event, sizeof(EpgEvent)) == 0)
+                return false;
+            bool modified = !SameContent(*existing, event);
+            *existing = event;
+            ++_generation;
+            if (modified)
+                Notify(EpgChange::Modified, key, event);
+            return true;
+        }
+        // The event moved
+        events.erase(existing);
+        position = lower_bound(events.begin(), events.end(), event.start, StartsBefore);
+        change = EpgChange::Modified;
+    }
+
+    if ((position != events.end()) && (position->start == event.start))
+    {
+        Notify(EpgChange::Removed, key, *position);
+        *position = event;
+    }
+    else
+        events.insert(position, event);
+    ++_generation;
+    Notify(change, key, event);
+    return true;
+}
+
+bool EpgStore::Remove(const ServiceKey & key, uint16_t eventId)
+{
+    uint64_t packed = key.Packed();
+    auto position = lower_bound(_index.begin(), _index.end(), packed, IndexKeyBefore);
+    if ((position == _index.end()) || (position->first != packed))
+        return false;
+    vector<EpgEvent> & events = _schedules[position->second].events;
+    auto existing = find_if(events.begin(), events.end(),
+                            [eventId](const EpgEvent & event) { return event.eventId == eventId; });
+    if (existing == events.end())
+        return false;
+    EpgEvent removed = *existing;
+    events.erase(existing);
+    ++_generation;
+    Notify(EpgChange::Removed, key, removed);
+    return true;
+}
+
+size_t EpgStore::SetWindow(uint32_t from, uint32_t until)
+{
+    _windowed = true;
+    _windowFrom = from;
+    _windowUntil = until;
+    size_t removed = 0;
+    for (ServiceSchedule & schedule : _schedules)
+    {
+        // The expired events lead the schedule and the ones beyond the window trail it, so both go in one erase
+        vector<EpgEvent> & events = schedule.events;
+        auto last = lower_bound(events.begin(), events.end(), until, StartsBefore);
+        auto first = find_if(events.begin(), last, [from](const EpgEvent & event) { return event.End() >= from; });
+        if (_listener)
+        {
+            for (auto event = events.begin(); event != first; ++event)
+                Notify(EpgChange::Removed, schedule.key, *event);
+            for (auto event = last; event != events.end(); ++event)
+                Notify(EpgChange::Removed, schedule.key, *event);
+        }
+        removed += (first - events.begin()) + (events.end() - last);
+        events.erase(last, events.end());
+        events.erase(events.begin(), first);
+    }
+    if (removed > 0)
+        ++_generation;
+    return removed;
+}
+
+void EpgStore::Compact()
+{
+    StringPool strings;
+    for (ServiceSchedule & schedule : _schedules)
+    {
+        schedule.events.shrink_to_fit();
+        for (EpgEvent & event : schedule.events)
+        {
+            event.title = strings.Intern(_strings.Data(event.title), _strings.Length(event.title));
+            event.text = strings.Intern(_strings.Data(event.text), _strings.Length(event.text));
+            event.extendedText = strings.Intern(_strings.Data(event.extendedText), _strings.Length(event.extendedText));
+        }
+    }
+    _strings = move(strings);
+}
+
+size_t EpgStore::Merge(const EpgStore & other)
+{
+    size_t changed = 0;
+    for (size_t index = 0; index < other.ServiceCount(); ++index)
+    {
+        const ServiceSchedule & schedule = other.Service(index);
+        const ServiceSchedule * existing = Find(schedule.key);
+        for (const EpgEvent & source : schedule.events)
+        {
+            if (existing)
+            {
+                // Usually the same event at the same start time
+                const vector<EpgEvent> & events = existing->events;
+                auto match = lower_bound(events.begin(), events.end(), source.start, StartsBefore);
+                if ((match == events.end()) || (match->eventId != source.eventId))
+                    match = find_if(events.begin(), events.end(),
+                                    [&source](const EpgEvent & event) { return event.eventId == source.eventId; });
+                if ((match != events.end()) && !Supersedes(source, *match))
+                    continue;
+            }
+            // String ids are offsets into the other store's pool
+            EpgEvent event = source;
+            event.title = _strings.Intern(other._strings.Data(source.title), other._strings.Length(source.title));
+            event.text = _strings.Intern(other._strings.Data(source.text), other._strings.Length(source.text));
+            event.extendedText = _strings.Intern(other._strings.Data(source.extendedText),
+                                                 other._strings.Length(source.extendedText));
+            if (Upsert(schedule.key, event))
+                ++changed;
+            // Adding the first event may have moved the schedules
+            existing = Find(schedule.key);
+        }
+    }
+    return changed;
+}
+
+size_t EpgStore::EventCount() const
+{
+    size_t result = 0;
+    for (const ServiceSchedule & schedule : _schedules)
+        result += schedule.events.size();
+    return result;
+}
+
+size_t EpgStore::MemoryUsage() const
+{
+    size_t result = _strings.MemoryUsage() + _schedules.capacity() * sizeof(ServiceSchedule) +
+                    _index.capacity() * sizeof(_index[0]);
+    for (const ServiceSchedule & schedule : _schedules)
+        result += schedule.events.capacity() * sizeof(EpgEvent);
+    return result;
+}
+
+void EpgStore::Clear()
+{
+    _strings = StringPool();
+    _schedules.clear();
+    _index.clear();
+    ++_generation;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "StringPool.h"
+
+struct ServiceKey
+{
+    uint16_t originalNetworkId;
+    uint16_t transportStreamId;
+    uint16_t serviceId;
+
+    uint64_t Packed() const
+    {
+        return (static_cast<uint64_t>(originalNetworkId) << 32) |
+               (static_cast<uint64_t>(transportStreamId) << 16) |
+               serviceId;
+    }
+    static ServiceKey Unpack(uint64_t packed)
+    {
+        return ServiceKey { static_cast<uint16_t>(packed >> 32), static_cast<uint16_t>(packed >> 16),
+                            static_cast<uint16_t>(packed) };
+    }
+    bool operator == (const ServiceKey & other) const { return Packed() == other.Packed(); }
+    bool operator < (const ServiceKey & other) const { return Packed() < other.Packed(); }
+};
+
+// Compact event record with a fixed layout. Text is held as ids into the store's StringPool.
+struct EpgEvent
+{
+    static const uint8_t RunningStatusMask = 0x07;
+    static const uint8_t FreeCAFlag = 0x08;
+    static const uint8_t NVODFlag = 0x10;
+
+    uint32_t start;         // Unix time (UTC)
+    uint32_t duration;      // Seconds
+    uint32_t title;         // Short event name
+    uint32_t text;          // Short event text
+    uint32_t extendedText;  // Extended event items and text, concatenated
+    uint32_t language : 24; // ISO 639-2 code, first character in the most significant byte
+    uint32_t tableId : 8;   // EIT sub_table that last wrote the event, 0 if not known
+    uint16_t eventId;
+    uint8_t version;        // version_number of that sub_table
+    uint8_t flags;          // Running status, free CA mode, NVOD
+    uint8_t content;        // First entry of the content descriptor: level 1 and level 2 nibble, 0 for none
+    uint8_t parentalRating; // Strictest rating of the parental rating descriptor, 0 for none
+    uint16_t genres;        // Bit per level 1 nibble of all content descriptor entries
+
+    uint32_t End() const { return start + duration; }
+    uint8_t RunningStatus() const { return flags & RunningStatusMask; }
+    uint8_t Genre() const { return content >> 4; }
+};
+static_assert(sizeof(EpgEvent) == 32, "EpgEvent is compared bytewise and must not contain padding");
+
+// Events of one service, in a contiguous array sorted by start time
+struct ServiceSchedule
+{
+    ServiceKey key;
+    std::vector<EpgEvent> events;
+};
+
+enum class EpgChange
+{
+    Added,
+    Modified,
+    Removed,
+};
+
+const char * EpgChangeName(EpgChange change);
+
+// Told about every change to the events of an EpgStore, as it is made. A new version of an event that is otherwise
+// the same is not a change.
+class EpgChangeListener
+{
+public:
+    virtual ~EpgChangeListener() {}
+
+    virtual void OnEventChange(EpgChange change, const ServiceKey & key, const EpgEvent & event,
+                               const StringPool & strings) = 0;
+};
+
+// In-memory EPG, keyed by (original_network_id, transport_stream_id, service_id).
+// Services are found by binary search in a sorted index, events by binary search in their service's array.
+class EpgStore
+{
+public:
+    EpgStore();
+
+    StringPool & Strings() { return _strings; }
+    const StringPool & Strings() const { return _strings; }
+
+    // Adds the event, or replaces the one with the same event_id. An event with a different id at the same start
+    // time is superseded and removed. Returns false if the stored event was identical, or is outside the window.
+    bool Upsert(const ServiceKey & key, const EpgEvent & event);
+    // Removes the event with this event_id. Returns false if there is none.
+    bool Remove(const ServiceKey & key, uint16_t eventId);
+
+    // Adds all events of other, with their strings. Where both stores hold an event_id from the same EIT sub_table,
+    // the newer version wins, on equal versions the event already in this store is kept. Versions of different
+    // sub_tables are counted separately and say nothing; there the actual transport stream goes before other ones,
+    // then present/following before schedule. Returns the number of events added or replaced.
+    size_t Merge(const EpgStore & other);
+
+    // Keeps only the events that end at or after from and start before until: the events outside are removed (and
+    // reported as removed) and Upsert ignores them from now on. Returns the number of events removed.
+    size_t SetWindow(uint32_t from, uint32_t until);
+    // Whether Upsert would take the event; lets a decoder skip interning the text of one it would not
+    bool InWindow(const EpgEvent & event) const
+    {
+        return !_windowed || ((event.End() >= _windowFrom) && (event.start < _windowUntil));
+    }
+    // Rebuilds the string pool with only the strings of the events held, and gives back the spare capacity of the
+    // event arrays. Costs a pass over all events; string ids change.
+    void Compact();
+
+    const ServiceSchedule * Find(const ServiceKey & key) const;
+    // Services in key order
+    size_t ServiceCount() const { return _index.size(); }
+    const ServiceSchedule & Service(size_t index) const { return _schedules[_index[index].second]; }
+
+    // Listener for the changes made by Upsert, Remove and Merge, nullptr for none. Clear is not reported.
+    void SetChangeListener(EpgChangeListener * listener) { _listener = listener; }
+    EpgChangeListener * ChangeListener() const { return _listener; }
+
+    // Goes up with every change to the events, listener or not, so a copy of the store can tell it is out of date.
+    // Compact changes no events.
+    uint64_t Generation() const { return _generation; }
+
+    size_t EventCount() const;
+    size_t MemoryUsage() const;
+    void Clear();
+
+private:
+    ServiceSchedule & FindOrAdd(const ServiceKey & key);
+    void Notify(EpgChange change, const ServiceKey & key, const EpgEvent & event) const
+    {
+        if (_listener)
+            _listener->OnEventChange(change, key, event, _strings);
+    }
+
+    StringPool _strings;
+    std::vector<ServiceSchedule> _schedules;
+    // Packed key and index into _schedules, sorted by key
+    std::vector<std::pair<uint64_t, uint32_t>> _index;
+    EpgChangeListener * _listener;
+    bool _windowed;
+    uint32_t _windowFrom;
+    uint32_t _windowUntil;
+    uint64_t _generation;
+};
@@ -0,0 +1,477 @@
+#include "EpgTextIndex.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// Rewrite the posting lists once this many documents are dead, and more of them than live ones
+const size_t MinimumDeadForCompaction = 4096;
+const uint32_t NoDocument = 0xFFFFFFFF;
+
+// Base letters of U+0100 - U+017F (Latin Extended-A); the ligatures at U+0132/U+0133 and U+0152/U+0153 are expanded
+// before this table is looked at
+const char LatinExtendedA[] =
+    "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiiiiijjkkkllllllllllnnnnnnnnnoooooooorrrrrrsssssssstttttt"
+    "uuuuuuuuuuuuwwyyyzzzzzzs";
+static_assert(sizeof(LatinExtendedA) == 0x80 + 1, "A letter per code point of U+0100 - U+017F");
+
+// The same for U+00C0 - U+00FF (Latin-1 Supplement); '-' marks the multiplication and division signs
+const char Latin1Supplement[] = "aaaaaaaceeeeiiiidnooooo-ouuuuyttaaaaaaaceeeeiiiidnooooo-ouuuuyty";
+static_assert(sizeof(Latin1Supplement) == 0x40 + 1, "A letter per code point of U+00C0 - U+00FF");
+
+// Next code point of UTF-8 text, advancing offset past it. A malformed sequence gives U+FFFD for its first byte.
+uint32_t NextCodePoint(const uint8_t * text, size_t length, size_t & offset)
+{
+    uint8_t first = text[offset++];
+    if (first < 0x80)
+        return first;
+    size_t extra = (first >= 0xF0) ? 3 : (first >= 0xE0) ? 2 : (first >= 0xC0) ? 1 : 0;
+    if ((extra == 0) || (first >= 0xF8) || (offset + extra > length))
+        return 0xFFFD;
+    uint32_t codePoint = first & (0x3F >> extra);
+    for (size_t index = 0; index < extra; ++index)
+    {
+        if ((text[offset + index] & 0xC0) != 0x80)
+            return 0xFFFD;
+        codePoint = (codePoint << 6) | (text[offset + index] & 0x3F);
+    }
+    offset += extra;
+    return codePoint;
+}
+
+void AppendUtf8(string & result, uint32_t codePoint)
+{
+    if (codePoint < 0x80)
+        result += static_cast<char>(codePoint);
+    else if (codePoint < 0x800)
+    {
+        result += static_cast<char>(0xC0 | (codePoint >> 6));
+        result += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000)
+    {
+        result += static_cast<char>(0xE0 | (codePoint >> 12));
+        result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        result += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+        result += static_cast<char>(0xF0 | (codePoint >> 18));
+        result += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        result += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        result += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+}
+
+// Apostrophes join the parts of a word ("don't" is one token)
+bool IsJoiner(uint32_t codePoint)
+{
+    return (codePoint == '\'') || (codePoint == 0x2019);
+}
+
+// Appends the normalized form of a letter or digit to token. Returns false for anything that separates words:
+// ASCII punctuation and controls, the Latin-1 signs, general punctuation and symbols, and malformed text.
+bool AppendNormalized(string & token, uint32_t codePoint)
+{
+    if (codePoint < 0x80)
+    {
+        if ((codePoint >= 'A') && (codePoint <= 'Z'))
+            token += static_cast<char>(codePoint - 'A' + 'a');
+        else if (((codePoint >= 'a') && (codePoint <= 'z')) || ((codePoint >= '0') && (codePoint <= '9')))
+            token += static_cast<char>(codePoint);
+        else
+            return false;
+        return true;
+    }
+    switch (codePoint)
+    {
+    case 0xC6: case 0xE6: token += "ae"; return true;
+    case 0xDE: case 0xFE: token += "th"; return true;
+    case 0xDF: token += "ss"; return true;
+    case 0x132: case 0x133: token += "ij"; return true;
+    case 0x152: case 0x153: token += "oe"; return true;
+    default: break;
+    }
+    if (codePoint < 0xC0)
+        return false;
+    if (codePoint < 0x100)
+    {
+        char letter = Latin1Supplement[codePoint - 0xC0];
+        if (letter == '-')
+            return false;
+        token += letter;
+        return true;
+    }
+    if (codePoint < 0x180)
+    {
+        token += LatinExtendedA[codePoint - 0x100];
+        return true;
+    }
+    if ((codePoint >= 0x391) && (codePoint <= 0x3A9))
+        codePoint += 0x20;      // Greek capitals
+    else if ((codePoint >= 0x410) && (codePoint <= 0x42F))
+        codePoint += 0x20;      // Cyrillic capitals
+    else if ((codePoint >= 0x400) && (codePoint <= 0x40F))
+        codePoint += 0x50;
+    else if (((codePoint >= 0x2000) && (codePoint <= 0x2BFF)) || ((codePoint >= 0x3000) && (codePoint <= 0x303F)) ||
+             (codePoint == 0xFEFF) || (codePoint == 0xFFFD))
+        return false;
+    AppendUtf8(token, codePoint);
+    return true;
+}
+
+// FNV-1a over the texts of the event, to tell whether a modified event needs tokenizing again
+uint64_t TextHash(const EpgEvent & event, const StringTable & strings)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (uint32_t id : { event.title, event.text, event.extendedText })
+    {
+        const char * data = strings.Data(id);
+        size_t length = strings.Length(id);
+        for (size_t index = 0; index < length; ++index)
+            hash = (hash ^ static_cast<uint8_t>(data[index])) * 0x100000001B3ull;
+        // Keeps "ab" + "c" apart from "a" + "bc"
+        hash = (hash ^ 0xFF) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+uint64_t EventKey(uint64_t service, uint16_t eventId)
+{
+    return (service << 16) | eventId;
+}
+
+bool IsSpace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+} // namespace
+
+EpgTextIndex::EpgTextIndex()
+    : _documents()
+    , _documentIds()
+    , _dictionary()
+    , _deadCount(0)
+    , _tokens()
+    , _indexed()
+    , _unchanged()
+    , _compactions()
+{
+}
+
+void EpgTextIndex::Build(const EpgStore & store)
+{
+    Clear();
+    StringTable strings = store.Strings().Table();
+    for (size_t service = 0; service < store.ServiceCount(); ++service)
+    {
+        const ServiceSchedule & schedule = store.Service(service);
+        for (const EpgEvent & event : schedule.events)
+            Index(schedule.key, event, strings);
+    }
+}
+
+void EpgTextIndex::Build(const EpgSnapshot & snapshot)
+{
+    Clear();
+    StringTable strings = snapshot.Strings();
+    for (size_t service = 0; service < snapshot.ServiceCount(); ++service)
+    {
+        const SnapshotService & schedule = snapshot.Service(service);
+        const EpgEvent * events = snapshot.Events(schedule);
+        for (size_t event = 0; event < schedule.eventCount; ++event)
+            Index(schedule.Key(), events[event], strings);
+    }
+}
+
+void EpgTextIndex::OnEventChange(EpgChange change, const ServiceKey & key, const EpgEvent & event,
+                                 const StringPool & strings)
+{
+    if (change == EpgChange::Removed)
+    {
+        auto existing = _documentIds.find(EventKey(key.Packed(), event.eventId));
+        if (existing == _documentIds.end())
+            return;
+        Retire(existing->second);
+        _documentIds.erase(existing);
+    }
+    else
+        Index(key, event, strings.Table());
+    if ((_deadCount >= MinimumDeadForCompaction) && (_deadCount > _documentIds.size()))
+        Compact();
+}
+
+void EpgTextIndex::Index(const ServiceKey & key, const EpgEvent & event, const StringTable & strings)
+{
+    uint64_t service = key.Packed();
+    uint64_t hash = TextHash(event, strings);
+    uint32_t & documentId = _documentIds.insert(make_pair(EventKey(service, event.eventId), NoDocument)).first->second;
+    if (documentId != NoDocument)
+    {
+        Document & document = _documents[documentId];
+        if (document.textHash == hash)
+        {
+            // Moved or otherwise changed, but the words are the same
+            document.start = event.start;
+            _unchanged.Add();
+            return;
+        }
+        Retire(documentId);
+    }
+    documentId = static_cast<uint32_t>(_documents.size());
+    _documents.push_back(Document { service, hash, event.start, event.eventId, true });
+
+    _tokens.clear();
+    for (uint32_t id : { event.title, event.text, event.extendedText })
+        Tokenize(strings.Data(id), strings.Length(id), _tokens);
+    sort(_tokens.begin(), _tokens.end());
+    _tokens.erase(unique(_tokens.begin(), _tokens.end()), _tokens.end());
+    for (const string & token : _tokens)
+        Append(_dictionary[token], documentId);
+    _indexed.Add();
+}
+
+void EpgTextIndex::Retire(uint32_t document)
+{
+    _documents[document].live = false;
+    ++_deadCount;
+}
+
+void EpgTextIndex::Compact()
+{
+    vector<uint32_t> renumbered(_documents.size(), NoDocument);
+    size_t live = 0;
+    for (size_t document = 0; document < _documents.size(); ++document)
+    {
+        if (!_documents[document].live)
+            continue;
+        renumbered[document] = static_cast<uint32_t>(live);
+        _documents[live++] = _documents[document];
+    }
+    _documents.resize(live);
+    _documents.shrink_to_fit();
+    for (auto & entry : _documentIds)
+        entry.second = renumbered[entry.second];
+
+    vector<uint32_t> documents;
+    for (auto entry = _dictionary.begin(); entry != _dictionary.end();)
+    {
+        Decode(entry->second, documents);
+        PostingList list { vector<uint8_t>(), 0, 0 };
+        for (uint32_t document : documents)
+        {
+            if (renumbered[document] != NoDocument)
+                Append(list, renumbered[document]);
+        }
+        if (list.count == 0)
+            entry = _dictionary.erase(entry);
+        else
+        {
+            list.data.shrink_to_fit();
+            entry->second = move(list);
+            ++entry;
+        }
+    }
+    _deadCount = 0;
+    _compactions.Add();
+}
+
+void EpgTextIndex::Append(PostingList & list, uint32_t document)
+{
+    uint32_t delta = (list.count == 0) ? document : document - list.last;
+    while (delta >= 0x80)
+    {
+        list.data.push_back(static_cast<uint8_t>(delta | 0x80));
+        delta >>= 7;
+    }
+    list.data.push_back(static_cast<uint8_t>(delta));
+    list.last = document;
+    ++list.count;
+}
+
+void EpgTextIndex::Decode(const PostingList & list, vector<uint32_t> & documents)
+{
+    documents.clear();
+    documents.reserve(list.count);
+    uint32_t document = 0;
+    size_t offset = 0;
+    while (offset < list.data.size())
+    {
+        uint32_t delta = 0;
+        unsigned shift = 0;
+        uint8_t byte = 0;
+        do
+        {
+            byte = list.data[offset++];
+            delta |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        document += delta;
+        documents.push_back(document);
+    }
+}
+
+void EpgTextIndex::Tokenize(const char * text, size_t length, vector<string> & tokens)
+{
+    const uint8_t * data = reinterpret_cast<const uint8_t *>(text);
+    string token;
+    size_t offset = 0;
+    while (offset < length)
+    {
+        uint32_t codePoint = NextCodePoint(data, length, offset);
+        if (IsJoiner(codePoint))
+            continue;
+        size_t size = token.size();
+        if (!AppendNormalized(token, codePoint))
+        {
+            if (!token.empty())
+                tokens.push_back(token);
+            token.clear();
+        }
+        else if (token.size() > MaxTokenLength)
+            token.resize(size);
+    }
+    if (!token.empty())
+        tokens.push_back(token);
+}
+
+bool EpgTextIndex::FindTerm(const string & word, bool prefix, Term & term) const
+{
+    term.lists.clear();
+    term.count = 0;
+    auto entry = _dictionary.lower_bound(word);
+    for (; entry != _dictionary.end(); ++entry)
+    {
+        bool matches = prefix ? (entry->first.compare(0, word.size(), word) == 0) : (entry->first == word);
+        if (!matches)
+            break;
+        term.lists.push_back(&entry->second);
+        term.count += entry->second.count;
+        if (!prefix)
+            break;
+    }
+    return !term.lists.empty();
+}
+
+bool EpgTextIndex::Search(const string & query, vector<Match> & result) const
+{
+    result.clear();
+    vector<Term> terms;
+    bool anyWord = false;
+    bool allFound = true;
+    size_t begin = 0;
+    while (begin < query.size())
+    {
+        if (IsSpace(query[begin]))
+        {
+            ++begin;
+            continue;
+        }
+        size_t end = begin;
+        while ((end < query.size()) && !IsSpace(query[end]))
+            ++end;
+        bool prefix = (query[end - 1] == '*');
+        vector<string> tokens;
+        Tokenize(query.data() + begin, end - begin - (prefix ? 1 : 0), tokens);
+        // Only the last part of a word like "o'neill-sm*" is a prefix
+        for (size_t index = 0; index < tokens.size(); ++index)
+        {
+            anyWord = true;
+            terms.push_back(Term());
+            if (!FindTerm(tokens[index], prefix && (index + 1 == tokens.size()), terms.back()))
+                allFound = false;
+        }
+        begin = end;
+    }
+    if (!anyWord)
+        return false;
+    if (!allFound)
+        return true;
+
+    // Intersect from the rarest term up, so the candidate list only shrinks
+    sort(terms.begin(), terms.end(), [](const Term & first, const Term & second) { return first.count < second.count; });
+    vector<uint32_t> candidates;
+    vector<uint32_t> documents;
+    vector<uint32_t> termDocuments;
+    vector<uint64_t> bits;
+    for (size_t index = 0; index < terms.size(); ++index)
+    {
+        const Term & term = terms[index];
+        if (term.lists.size() == 1)
+            Decode(*term.lists[0], termDocuments);
+        else
+        {
+            // The union of the tokens with the prefix, merged as a bitmap over the documents
+            bits.assign((_documents.size() + 63) / 64, 0);
+            for (const PostingList * list : term.lists)
+            {
+                Decode(*list, documents);
+                for (uint32_t document : documents)
+                    bits[document / 64] |= uint64_t(1) << (document % 64);
+            }
+            termDocuments.clear();
+            for (size_t word = 0; word < bits.size(); ++word)
+            {
+                for (uint64_t remaining = bits[word]; remaining != 0; remaining &= remaining - 1)
+                    termDocuments.push_back(static_cast<uint32_t>(word * 64 + __builtin_ctzll(remaining)));
+            }
+        }
+        if (index == 0)
+        {
+            candidates.clear();
+            for (uint32_t document : termDocuments)
+            {
+                if (_documents[document].live)
+                    candidates.push_back(document);
+            }
+        }
+        else
+        {
+            auto last = set_intersection(candidates.begin(), candidates.end(), termDocuments.begin(),
+                                         termDocuments.end(), candidates.begin());
+            candidates.erase(last, candidates.end());
+        }
+        if (candidates.empty())
+            return true;
+    }
+
+    // Sorted on start time and document number packed into one integer, which is much cheaper than comparing matches
+    vector<uint64_t> order;
+    order.reserve(candidates.size());
+    for (uint32_t document : candidates)
+        order.push_back((static_cast<uint64_t>(_documents[document].start) << 32) | document);
+    sort(order.begin(), order.end());
+    result.reserve(order.size());
+    for (uint64_t entry : order)
+    {
+        const Document & document = _documents[static_cast<uint32_t>(entry)];
+        result.push_back(Match { ServiceKey::Unpack(document.service), document.eventId, document.start });
+    }
+    return true;
+}
+
+size_t EpgTextIndex::MemoryUsage() const
+{
+    // Map and hash table nodes are counted at their payload plus two pointers
+    size_t usage = _documents.capacity() * sizeof(Document) +
+                   _documentIds.size() * (sizeof(pair<uint64_t, uint32_t>) + 2 * sizeof(void *)) +
+                   _documentIds.bucket_count() * sizeof(void *);
+    for (const auto & entry : _dictionary)
+    {
+        usage += sizeof(entry) + 4 * sizeof(void *) + entry.second.data.capacity();
+        if (entry.first.capacity() > 15)
+            usage += entry.first.capacity() + 1;
+    }
+    return usage;
+}
+
+void EpgTextIndex::Clear()
+{
+    _documents.clear();
+    _documentIds.clear();
+    _dictionary.clear();
+    _deadCount = 0;
+}
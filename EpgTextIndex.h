@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "EpgSnapshot.h"
+#include "EpgStore.h"
+#include "Metrics.h"
+
+// Full text search over the titles, short texts and extended texts (items and text) of the events, as an inverted
+// index. Text is split into tokens at everything but letters and digits, lower cased, and Latin letters lose their
+// diacritics ("Ärzte" is found as "arzte"), so a query matches however the broadcaster wrote the word.
+//
+// Set it as the store's change listener and it follows the store as events are decoded: only events added, or
+// modified with a different text, are tokenized. A new version of an event that is otherwise the same is no change
+// to the store, so it never reaches the index. Every indexed event gets the next document number, which keeps the
+// posting lists sorted so they can be held as variable length deltas, mostly a byte per event. A replaced or
+// removed event only marks its document dead; once there are more dead documents than live ones, the posting lists
+// are rewritten without them.
+class EpgTextIndex : public EpgChangeListener
+{
+public:
+    // Tokens are cut at this many bytes
+    static const size_t MaxTokenLength = 64;
+
+    struct Match
+    {
+        ServiceKey key;
+        uint16_t eventId;
+        uint32_t start;
+    };
+
+    EpgTextIndex();
+
+    // Indexes all events of the source, dropping what was indexed before
+    void Build(const EpgStore & store);
+    void Build(const EpgSnapshot & snapshot);
+
+    void OnEventChange(EpgChange change, const ServiceKey & key, const EpgEvent & event,
+                       const StringPool & strings) override;
+
+    // Events holding every word of the query, in start time order. A word ending in '*' matches every token it
+    // starts. result is cleared first. Returns false for a query without any word.
+    bool Search(const std::string & query, std::vector<Match> & result) const;
+
+    // Splits text into normalized tokens and appends them to tokens
+    static void Tokenize(const char * text, size_t length, std::vector<std::string> & tokens);
+
+    size_t EventCount() const { return _documentIds.size(); }
+    size_t TokenCount() const { return _dictionary.size(); }
+    // Events tokenized, and modified events whose text had not changed
+    uint64_t Indexed() const { return _indexed; }
+    uint64_t Unchanged() const { return _unchanged; }
+    uint64_t Compactions() const { return _compactions; }
+    size_t MemoryUsage() const;
+    void Clear();
+
+private:
+    struct Document
+    {
+        uint64_t service;       // Packed service key
+        uint64_t textHash;
+        uint32_t start;
+        uint16_t eventId;
+        bool live;
+    };
+
+    struct PostingList
+    {
+        std::vector<uint8_t> data;  // Deltas of the document numbers, 7 bits per byte, low bits first
+        uint32_t count;
+        uint32_t last;
+    };
+
+    struct Term
+    {
+        std::vector<const PostingList *> lists;
+        size_t count;
+    };
+
+    void Index(const ServiceKey & key, const EpgEvent & event, const StringTable & strings);
+    void Retire(uint32_t document);
+    // Rewrites the posting lists with only the live documents, renumbered in order
+    void Compact();
+    // Posting lists of a query word, false if it has none
+    bool FindTerm(const std::string & word, bool prefix, Term & term) const;
+    static void Decode(const PostingList & list, std::vector<uint32_t> & documents);
+    static void Append(PostingList & list, uint32_t document);
+
+    std::vector<Document> _documents;
+    // By packed service key and event_id, the live document of every event
+    std::unordered_map<uint64_t, uint32_t> _documentIds;
+    // Sorted, so a prefix is a range of tokens
+    std::map<std::string, PostingList> _dictionary;
+    size_t _deadCount;
+    std::vector<std::string> _tokens;
+    Counter _indexed;
+    Counter _unchanged;
+    Counter _compactions;
+};
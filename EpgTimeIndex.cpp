@@ -0,0 +1,139 @@
+#include "EpgTimeIndex.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+bool StartsBefore(const EpgEvent & event, uint32_t start)
+{
+    return event.start < start;
+}
+
+bool StartsAfter(uint32_t start, const EpgEvent & event)
+{
+    return start < event.start;
+}
+
+bool ScheduleKeyBefore(const EpgTimeIndex::Schedule & schedule, uint64_t key)
+{
+    return schedule.key.Packed() < key;
+}
+
+} // namespace
+
+EpgTimeIndex::EpgTimeIndex()
+    : _schedules()
+{
+}
+
+void EpgTimeIndex::Build(const EpgStore & store)
+{
+    _schedules.clear();
+    _schedules.reserve(store.ServiceCount());
+    for (size_t index = 0; index < store.ServiceCount(); ++index)
+    {
+        const ServiceSchedule & schedule = store.Service(index);
+        Add(schedule.key, schedule.events.data(), schedule.events.size());
+    }
+}
+
+void EpgTimeIndex::Build(const EpgSnapshot & snapshot)
+{
+    _schedules.clear();
+    _schedules.reserve(snapshot.ServiceCount());
+    for (size_t index = 0; index < snapshot.ServiceCount(); ++index)
+    {
+        const SnapshotService & service = snapshot.Service(index);
+        Add(service.Key(), snapshot.Events(service), service.eventCount);
+    }
+}
+
+void EpgTimeIndex::Add(const ServiceKey & key, const EpgEvent * events, size_t count)
+{
+    uint32_t maxDuration = 0;
+    for (size_t index = 0; index < count; ++index)
+        maxDuration = max(maxDuration, events[index].duration);
+    _schedules.push_back(Schedule { key, events, count, maxDuration });
+}
+
+int EpgTimeIndex::FindService(const ServiceKey & key) const
+{
+    uint64_t packed = key.Packed();
+    auto position = lower_bound(_schedules.begin(), _schedules.end(), packed, ScheduleKeyBefore);
+    if ((position == _schedules.end()) || (position->key.Packed() != packed))
+        return -1;
+    return static_cast<int>(position - _schedules.begin());
+}
+
+const EpgEvent * EpgTimeIndex::FirstCandidate(const Schedule & schedule, uint32_t time) const
+{
+    // No event starting before time - maxDuration can still be running at time
+    uint32_t earliest = (time > schedule.maxDuration) ? time - schedule.maxDuration : 0;
+    return lower_bound(schedule.events, schedule.events + schedule.count, earliest, StartsBefore);
+}
+
+const EpgEvent * EpgTimeIndex::At(size_t service, uint32_t time) const
+{
+    const Schedule & schedule = _schedules[service];
+    const EpgEvent * end = schedule.events + schedule.count;
+    // The last event that started at or before time is on air, unless it already ended. With overlapping events an
+    // earlier, longer one may still be on air.
+    const EpgEvent * position = upper_bound(schedule.events, end, time, StartsAfter);
+    const EpgEvent * first = FirstCandidate(schedule, time);
+    while (position != first)
+    {
+        --position;
+        if (position->End() > time)
+            return position;
+    }
+    return nullptr;
+}
+
+EpgTimeIndex::NowNext EpgTimeIndex::GetNowNext(size_t service, uint32_t time) const
+{
+    const Schedule & schedule = _schedules[service];
+    const EpgEvent * end = schedule.events + schedule.count;
+    const EpgEvent * next = upper_bound(schedule.events, end, time, StartsAfter);
+    return NowNext { static_cast<uint32_t>(service), At(service, time), (next != end) ? next : nullptr };
+}
+
+void EpgTimeIndex::GetNowNext(uint32_t time, vector<NowNext> & result) const
+{
+    result.clear();
+    result.reserve(_schedules.size());
+    for (size_t service = 0; service < _schedules.size(); ++service)
+        result.push_back(GetNowNext(service, time));
+}
+
+void EpgTimeIndex::AppendOverlapping(uint32_t service, uint32_t from, uint32_t to, vector<GridEntry> & result) const
+{
+    const Schedule & schedule = _schedules[service];
+    const EpgEvent * end = schedule.events + schedule.count;
+    for (const EpgEvent * event = FirstCandidate(schedule, from); (event != end) && (event->start < to); ++event)
+    {
+        if (event->End() > from)
+            result.push_back(GridEntry { service, event });
+    }
+}
+
+void EpgTimeIndex::Grid(size_t firstService, size_t serviceCount, uint32_t from, uint32_t to,
+                        vector<GridEntry> & result) const
+{
+    result.clear();
+    size_t last = min(firstService + serviceCount, _schedules.size());
+    for (size_t service = firstService; service < last; ++service)
+        AppendOverlapping(static_cast<uint32_t>(service), from, to, result);
+}
+
+void EpgTimeIndex::Grid(const vector<uint32_t> & services, uint32_t from, uint32_t to,
+                        vector<GridEntry> & result) const
+{
+    result.clear();
+    for (uint32_t service : services)
+    {
+        if (service < _schedules.size())
+            AppendOverlapping(service, from, to, result);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "EpgSnapshot.h"
+#include "EpgStore.h"
+
+// Time queries on the per-service event arrays of an EpgStore or EpgSnapshot: the event on air at a time,
+// now/next for every service, and grids of all events overlapping a time range.
+// Events are sorted by start time, so every lookup is a binary search. Overlapping events (which some broadcasters
+// do send) are found by starting the search the longest event duration of the service earlier.
+// The index points into the source's arrays; rebuild it after the store changes.
+class EpgTimeIndex
+{
+public:
+    struct Schedule
+    {
+        ServiceKey key;
+        const EpgEvent * events;
+        size_t count;
+        uint32_t maxDuration;
+    };
+
+    struct NowNext
+    {
+        uint32_t service;           // Index of the service in the time index
+        const EpgEvent * now;       // nullptr if nothing is on air
+        const EpgEvent * next;      // nullptr if nothing follows
+    };
+
+    struct GridEntry
+    {
+        uint32_t service;
+        const EpgEvent * event;
+    };
+
+    EpgTimeIndex();
+
+    void Build(const EpgStore & store);
+    void Build(const EpgSnapshot & snapshot);
+
+    // Services in key order, the same order as the source
+    size_t ServiceCount() const { return _schedules.size(); }
+    const Schedule & Service(size_t index) const { return _schedules[index]; }
+    // Index of the service, or -1
+    int FindService(const ServiceKey & key) const;
+
+    // The event on air at time, or nullptr
+    const EpgEvent * At(size_t service, uint32_t time) const;
+    // The event on air at time and the first one starting after it
+    NowNext GetNowNext(size_t service, uint32_t time) const;
+    // Now/next for all services. result is cleared first; reusing it avoids allocating per query.
+    void GetNowNext(uint32_t time, std::vector<NowNext> & result) const;
+    // Events overlapping [from, to) for the services [firstService, firstService + serviceCount), per service in
+    // start time order. result is cleared first.
+    void Grid(size_t firstService, size_t serviceCount, uint32_t from, uint32_t to,
+              std::vector<GridEntry> & result) const;
+    // Same for a list of service indexes
+    void Grid(const std::vector<uint32_t> & services, uint32_t from, uint32_t to,
+              std::vector<GridEntry> & result) const;
+
+private:
+    void Add(const ServiceKey & key, const EpgEvent * events, size_t count);
+    // First event that may still be running at time
+    const EpgEvent * FirstCandidate(const Schedule & schedule, uint32_t time) const;
+    void AppendOverlapping(uint32_t service, uint32_t from, uint32_t to, std::vector<GridEntry> & result) const;
+
+    std::vector<Schedule> _schedules;
+};
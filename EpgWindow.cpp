@@ -0,0 +1,62 @@
+#include "EpgWindow.h"
+
+#include <algorithm>
+#include "EpgStore.h"
+
+using namespace std;
+
+namespace {
+
+// Below this the pool is not worth compacting
+const size_t MinimumCompactBytes = 256 * 1024;
+
+} // namespace
+
+EpgWindow::EpgWindow(EpgStore & store, const EpgRetention & retention)
+    : _store(store)
+    , _retention(retention)
+    , _nextCheck(0)
+    , _compactedBytes(MinimumCompactBytes)
+    , _from(0)
+    , _until(0)
+    , _horizon(retention.future)
+    , _evicted()
+    , _compactions()
+    , _memoryUsage()
+{
+}
+
+void EpgWindow::Apply(uint32_t now)
+{
+    _nextCheck = now + CheckInterval;
+    uint32_t horizon = Horizon();
+    uint32_t from = (now > _retention.past) ? now - _retention.past : 0;
+    uint32_t until = static_cast<uint32_t>(min<uint64_t>(uint64_t(now) + horizon, UINT32_MAX));
+    _evicted.Add(_store.SetWindow(from, until));
+    size_t usage = _store.MemoryUsage();
+    bool overCap = (_retention.maxBytes != 0) && (usage > _retention.maxBytes);
+    if (overCap || (_store.Strings().Bytes() >= 2 * _compactedBytes))
+    {
+        Compact();
+        usage = _store.MemoryUsage();
+    }
+    while ((_retention.maxBytes != 0) && (usage > _retention.maxBytes) && (horizon > MinimumHorizon))
+    {
+        horizon = (horizon / 2 > MinimumHorizon) ? horizon / 2 : MinimumHorizon;
+        until = static_cast<uint32_t>(min<uint64_t>(uint64_t(now) + horizon, UINT32_MAX));
+        _evicted.Add(_store.SetWindow(from, until));
+        Compact();
+        usage = _store.MemoryUsage();
+    }
+    _from.store(from, memory_order_relaxed);
+    _until.store(until, memory_order_relaxed);
+    _horizon.store(horizon, memory_order_relaxed);
+    _memoryUsage.Set(usage);
+}
+
+void EpgWindow::Compact()
+{
+    _store.Compact();
+    _compactedBytes = max(_store.Strings().Bytes(), MinimumCompactBytes);
+    _compactions.Add();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Metrics.h"
+
+class EpgStore;
+
+struct EpgRetention
+{
+    uint32_t past;          // Seconds before the stream time that ended events are kept
+    uint32_t future;        // Seconds after the stream time that events may start
+    size_t maxBytes;        // Cap on EpgStore::MemoryUsage, 0 for none
+};
+
+// Keeps an EpgStore to a rolling window around the stream time, so it does not grow with the uptime on live input.
+// Every ten seconds of stream time the expired events and those beyond the horizon are dropped from the store, and
+// when the string pool has doubled since it was last compacted, it is rebuilt with only the strings still used:
+// the strings of the dropped events go in bulk, rather than being tracked one by one.
+// If the store still needs more than maxBytes after compacting, the horizon is halved until it fits, down to
+// MinimumHorizon. The horizon does not grow back, so the far end of the schedule is not fetched and dropped again at
+// every check.
+// Only on the thread that updates the store.
+class EpgWindow
+{
+public:
+    static const uint32_t CheckInterval = 10;
+    static const uint32_t MinimumHorizon = 3 * 3600;
+
+    EpgWindow(EpgStore & store, const EpgRetention & retention);
+
+    // Called with the stream time (0 if unknown) as the store is updated
+    void Update(uint32_t now)
+    {
+        if ((now != 0) && (now >= _nextCheck))
+            Apply(now);
+    }
+    void Apply(uint32_t now);
+
+    // Counters can be read from another thread
+    uint32_t From() const { return _from.load(std::memory_order_relaxed); }
+    uint32_t Until() const { return _until.load(std::memory_order_relaxed); }
+    uint32_t Horizon() const { return _horizon.load(std::memory_order_relaxed); }
+    uint64_t Evicted() const { return _evicted; }
+    uint64_t Compactions() const { return _compactions; }
+    // EpgStore::MemoryUsage after the last check
+    uint64_t MemoryUsage() const { return _memoryUsage; }
+
+private:
+    EpgWindow(const EpgWindow &) = delete;
+    EpgWindow & operator = (const EpgWindow &) = delete;
+
+    void Compact();
+
+    EpgStore & _store;
+    EpgRetention _retention;
+    uint32_t _nextCheck;
+    // String pool size after the last compaction
+    size_t _compactedBytes;
+    std::atomic<uint32_t> _from;
+    std::atomic<uint32_t> _until;
+    std::atomic<uint32_t> _horizon;
+    Counter _evicted;
+    Counter _compactions;
+    Counter _memoryUsage;
+};
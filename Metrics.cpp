@@ -0,0 +1,56 @@
+#include "Metrics.h"
+
+#include <csignal>
+#include "OutputBuffer.h"
+
+using namespace std;
+
+namespace {
+
+volatile sig_atomic_t s_metricsRequested = 0;
+
+void MetricsSignalHandler(int)
+{
+    s_metricsRequested = 1;
+}
+
+} // namespace
+
+void LatencyHistogram::AppendJson(OutputBuffer & output) const
+{
+    output.Append("{\"count\":");
+    output.AppendUnsigned(Count());
+    output.Append(",\"total_ns\":");
+    output.AppendUnsigned(TotalNanoseconds());
+    output.Append(",\"max_ns\":");
+    output.AppendUnsigned(MaxNanoseconds());
+    output.Append(",\"buckets\":[");
+    size_t used = BucketCount;
+    while ((used > 0) && (Bucket(used - 1) == 0))
+        --used;
+    for (size_t index = 0; index < used; ++index)
+    {
+        if (index > 0)
+            output.Append(',');
+        output.AppendUnsigned(Bucket(index));
+    }
+    output.Append("]}");
+}
+
+void InstallMetricsSignalHandler()
+{
+    struct sigaction action {};
+    action.sa_handler = MetricsSignalHandler;
+    sigemptyset(&action.sa_mask);
+    // Restart interrupted reads, the reader does not need to see the signal
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+}
+
+bool TakeMetricsRequest()
+{
+    if (!s_metricsRequested)
+        return false;
+    s_metricsRequested = 0;
+    return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+class OutputBuffer;
+
+// Counter written by a single thread and read by any thread. Updates are a relaxed load and store, so there is no
+// locked instruction on the hot path; readers see a recent value.
+class Counter
+{
+public:
+    Counter() : _value(0) {}
+
+    void Add(uint64_t count = 1)
+    {
+        _value.store(_value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+    void Set(uint64_t value) { _value.store(value, std::memory_order_relaxed); }
+    uint64_t Value() const { return _value.load(std::memory_order_relaxed); }
+    operator uint64_t () const { return Value(); }
+
+private:
+    Counter(const Counter &) = delete;
+    Counter & operator = (const Counter &) = delete;
+
+    std::atomic<uint64_t> _value;
+};
+
+// Histogram of durations with power of two buckets: bucket i counts durations in [2^i, 2^(i+1)) nanoseconds
+// (bucket 0 also counts 0). Single writer, like Counter.
+class LatencyHistogram
+{
+public:
+    static const size_t BucketCount = 40;
+
+    void Record(uint64_t nanoseconds)
+    {
+        size_t bucket = (nanoseconds == 0) ? 0 : 63 - __builtin_clzll(nanoseconds);
+        _buckets[bucket < BucketCount ? bucket : BucketCount - 1].Add();
+        _count.Add();
+        _total.Add(nanoseconds);
+        if (nanoseconds > _max.Value())
+            _max.Set(nanoseconds);
+    }
+
+    uint64_t Count() const { return _count; }
+    uint64_t TotalNanoseconds() const { return _total; }
+    uint64_t MaxNanoseconds() const { return _max; }
+    uint64_t Bucket(size_t index) const { return _buckets[index]; }
+
+    // {"count":..,"total_ns":..,"max_ns":..,"buckets":[..]}, buckets up to the last non-empty one
+    void AppendJson(OutputBuffer & output) const;
+
+private:
+    Counter _buckets[BucketCount];
+    Counter _count;
+    Counter _total;
+    Counter _max;
+};
+
+// Records the time until the end of the scope
+class ScopedLatency
+{
+public:
+    explicit ScopedLatency(LatencyHistogram & histogram)
+        : _histogram(histogram)
+        , _start(std::chrono::steady_clock::now())
+    {}
+    ~ScopedLatency()
+    {
+        _histogram.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - _start).count()));
+    }
+
+private:
+    LatencyHistogram & _histogram;
+    std::chrono::steady_clock::time_point _start;
+};
+
+// SIGUSR1 asks for a metrics dump. The handler only sets a flag; the processing loop polls it.
+void InstallMetricsSignalHandler();
+// Returns true (once) if a dump was asked for since the last call
+bool TakeMetricsRequest();
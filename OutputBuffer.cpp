@@ -0,0 +1,177 @@
+#include "OutputBuffer.h"
+
+#include <cerrno>
+#include <unistd.h>
+
+using namespace std;
+
+CivilTime CivilTime::FromUnixTime(int64_t time)
+{
+    // Days to civil date, after Howard Hinnant's days_from_civil inverse
+    int64_t days = time / 86400;
+    int64_t seconds = time % 86400;
+    if (seconds < 0)
+    {
+        seconds += 86400;
+        --days;
+    }
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t dayOfEra = days - era * 146097;
+    int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    CivilTime result;
+    result.day = static_cast<int>(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    result.month = static_cast<int>(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    result.year = static_cast<int>(yearOfEra + era * 400 + (result.month <= 2 ? 1 : 0));
+    result.hour = static_cast<int>(seconds / 3600);
+    result.minute = static_cast<int>(seconds / 60 % 60);
+    result.second = static_cast<int>(seconds % 60);
+    return result;
+}
+
+OutputBuffer::OutputBuffer(int fileHandle, size_t capacity)
+    : _fileHandle(fileHandle)
+    , _buffer(capacity > 64 ? capacity : 64)
+    , _used(0)
+    , _bytesWritten(0)
+    , _failed(false)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    Flush();
+}
+
+void OutputBuffer::AppendSlow(const char * data, size_t length)
+{
+    Flush();
+    if (length >= _buffer.size())
+    {
+        WriteAll(data, length);
+        return;
+    }
+    memcpy(_buffer.data(), data, length);
+    _used = length;
+}
+
+void OutputBuffer::AppendUnsigned(uint64_t value, int width, char fill)
+{
+    char digits[24];
+    int count = 0;
+    do
+    {
+        digits[sizeof(digits) - 1 - count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    while (value != 0);
+    while ((count < width) && (count < static_cast<int>(sizeof(digits))))
+        digits[sizeof(digits) - 1 - count++] = fill;
+    Append(digits + sizeof(digits) - count, static_cast<size_t>(count));
+}
+
+void OutputBuffer::AppendSigned(int64_t value)
+{
+    if (value < 0)
+    {
+        Append('-');
+        AppendUnsigned(static_cast<uint64_t>(-(value + 1)) + 1);
+    }
+    else
+        AppendUnsigned(static_cast<uint64_t>(value));
+}
+
+void OutputBuffer::AppendFixed(double value, int decimals)
+{
+    static const uint64_t Scales[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+    if (decimals < 0)
+        decimals = 0;
+    if (decimals > 9)
+        decimals = 9;
+    if (value < 0)
+    {
+        Append('-');
+        value = -value;
+    }
+    uint64_t scaled = static_cast<uint64_t>(value * Scales[decimals] + 0.5);
+    AppendUnsigned(scaled / Scales[decimals]);
+    if (decimals > 0)
+    {
+        Append('.');
+        AppendUnsigned(scaled % Scales[decimals], decimals, '0');
+    }
+}
+
+void OutputBuffer::AppendHex(uint64_t value, int digits)
+{
+    static const char HexDigits[] = "0123456789abcdef";
+    char text[16];
+    if (digits > 16)
+        digits = 16;
+    for (int i = digits - 1; i >= 0; --i)
+    {
+        text[i] = HexDigits[value & 0x0F];
+        value >>= 4;
+    }
+    Append(text, static_cast<size_t>(digits));
+}
+
+void OutputBuffer::AppendIsoTime(uint32_t time)
+{
+    CivilTime civil = CivilTime::FromUnixTime(time);
+    AppendUnsigned(civil.year, 4, '0');
+    Append('-');
+    AppendUnsigned(civil.month, 2, '0');
+    Append('-');
+    AppendUnsigned(civil.day, 2, '0');
+    Append('T');
+    AppendUnsigned(civil.hour, 2, '0');
+    Append(':');
+    AppendUnsigned(civil.minute, 2, '0');
+    Append(':');
+    AppendUnsigned(civil.second, 2, '0');
+    Append('Z');
+}
+
+void OutputBuffer::AppendXmltvTime(uint32_t time)
+{
+    CivilTime civil = CivilTime::FromUnixTime(time);
+    AppendUnsigned(civil.year, 4, '0');
+    AppendUnsigned(civil.month, 2, '0');
+    AppendUnsigned(civil.day, 2, '0');
+    AppendUnsigned(civil.hour, 2, '0');
+    AppendUnsigned(civil.minute, 2, '0');
+    AppendUnsigned(civil.second, 2, '0');
+    Append(" +0000", 6);
+}
+
+bool OutputBuffer::Flush()
+{
+    if (_used > 0)
+    {
+        WriteAll(_buffer.data(), _used);
+        _used = 0;
+    }
+    return !_failed;
+}
+
+bool OutputBuffer::WriteAll(const char * data, size_t length)
+{
+    while (!_failed && (length > 0))
+    {
+        ssize_t written = write(_fileHandle, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            _failed = true;
+            break;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        _bytesWritten += static_cast<uint64_t>(written);
+    }
+    return !_failed;
+}
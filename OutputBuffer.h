@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Large reusable output buffer in front of a file handle. Numbers and times are formatted by hand, so writing a
+// guide needs no iostreams, locale lookups or per-line flushes.
+class OutputBuffer
+{
+public:
+    static const size_t DefaultCapacity = 1024 * 1024;
+
+    explicit OutputBuffer(int fileHandle, size_t capacity = DefaultCapacity);
+    ~OutputBuffer();
+
+    void Append(const char * data, size_t length)
+    {
+        if (_used + length > _buffer.size())
+        {
+            AppendSlow(data, length);
+            return;
+        }
+        memcpy(_buffer.data() + _used, data, length);
+        _used += length;
+    }
+    void Append(const char * text) { Append(text, strlen(text)); }
+    void Append(char c)
+    {
+        if (_used == _buffer.size())
+            Flush();
+        _buffer[_used++] = c;
+    }
+    // Decimal, right aligned in width characters padded with fill
+    void AppendUnsigned(uint64_t value, int width = 0, char fill = ' ');
+    void AppendSigned(int64_t value);
+    // Fixed point with the given number of decimals (at most 9)
+    void AppendFixed(double value, int decimals);
+    // Lower case hexadecimal, zero padded to digits
+    void AppendHex(uint64_t value, int digits);
+    // Unix time as 2024-03-01T20:15:00Z
+    void AppendIsoTime(uint32_t time);
+    // Unix time as 20240301201500 +0000 (XMLTV)
+    void AppendXmltvTime(uint32_t time);
+
+    // Writes the buffered data. Returns false if a write failed (now or before).
+    bool Flush();
+    uint64_t BytesWritten() const { return _bytesWritten; }
+
+private:
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer & operator = (const OutputBuffer &) = delete;
+
+    void AppendSlow(const char * data, size_t length);
+    bool WriteAll(const char * data, size_t length);
+
+    int _fileHandle;
+    std::vector<char> _buffer;
+    size_t _used;
+    uint64_t _bytesWritten;
+    bool _failed;
+};
+
+// Calendar date and time of a Unix time (UTC)
+struct CivilTime
+{
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+
+    static CivilTime FromUnixTime(int64_t time);
+};
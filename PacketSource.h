@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class OutputBuffer;
+
+// Where the TransportStreamParser gets its 188 byte packets from: a file or pipe (TransportStreamReader) or the
+// network (UdpReceiver)
+class PacketSource
+{
+public:
+    virtual ~PacketSource() {}
+
+    // Returns the next packet, or nullptr at the end of the input. The pointer stays valid until the next call.
+    virtual const uint8_t * NextPacket() = 0;
+
+    virtual uint64_t PacketsRead() const = 0;
+    virtual uint64_t BytesConsumed() const = 0;
+    virtual double ElapsedSeconds() const = 0;
+    virtual double ThroughputMBps() const = 0;
+    // Source specific counters as ,"name":value pairs for the metrics
+    virtual void AppendMetrics(OutputBuffer & output) const = 0;
+};
@@ -0,0 +1,79 @@
+#include "PidDispatcher.h"
+
+using namespace std;
+
+PidDispatcher::PidDispatcher()
+    : _entries(PidCount, Entry { nullptr, 0, 0, 0, -1, false })
+{
+}
+
+void PidDispatcher::Subscribe(uint16_t pid, PacketSink * sink)
+{
+    Entry & entry = _entries[pid & (PidCount - 1)];
+    entry.sink = sink;
+    entry.enabled = (sink != nullptr);
+}
+
+void PidDispatcher::Unsubscribe(uint16_t pid)
+{
+    Entry & entry = _entries[pid & (PidCount - 1)];
+    entry.sink = nullptr;
+    entry.enabled = false;
+}
+
+void PidDispatcher::Enable(uint16_t pid, bool enabled)
+{
+    Entry & entry = _entries[pid & (PidCount - 1)];
+    // A PID without a sink can never be enabled, so Dispatch does not need to check for it
+    entry.enabled = enabled && (entry.sink != nullptr);
+}
+
+uint64_t PidDispatcher::TotalPackets() const
+{
+    uint64_t result = 0;
+    for (const Entry & entry : _entries)
+        result += entry.packets;
+    return result;
+}
+
+uint64_t PidDispatcher::ContinuityErrors() const
+{
+    uint64_t result = 0;
+    for (size_t pid = 0; pid < PidCount; ++pid)
+    {
+        // The null PID has no meaningful continuity counter
+        if (pid != NullPID)
+            result += _entries[pid].continuityErrors;
+    }
+    return result;
+}
+
+uint64_t PidDispatcher::TransportErrors() const
+{
+    uint64_t result = 0;
+    for (const Entry & entry : _entries)
+        result += entry.transportErrors;
+    return result;
+}
+
+uint64_t PidDispatcher::DispatchedPackets() const
+{
+    uint64_t result = 0;
+    for (const Entry & entry : _entries)
+    {
+        if (entry.sink)
+            result += entry.packets;
+    }
+    return result;
+}
+
+size_t PidDispatcher::ActivePIDs() const
+{
+    size_t result = 0;
+    for (const Entry & entry : _entries)
+    {
+        if (entry.packets)
+            ++result;
+    }
+    return result;
+}
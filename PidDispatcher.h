@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Receiver of transport stream packets for one or more PIDs
+class PacketSink
+{
+public:
+    static const size_t PacketSize = 188;
+
+    virtual ~PacketSink() {}
+
+    virtual void PushPacket(const uint8_t * packet) = 0;
+    // Hands over count contiguous packets. Sinks that need locking can override this to lock once per batch.
+    virtual void PushPackets(const uint8_t * packets, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            PushPacket(packets + i * PacketSize);
+    }
+};
+
+// Flat table with one entry per PID. Routing can be changed at runtime, so new table listeners (SDT, TDT, PMT)
+// only need to subscribe to their PID. Every packet of every PID is counted and gets its transport_error_indicator
+// and continuity counter checked, for the metrics; that reads the 4 byte header and, for a packet with an
+// adaptation field, its first two bytes, all in the cache line the PID came from. Packets for PIDs without an
+// enabled sink are dropped after that, so video and audio PIDs (the bulk of a mux) cost a table lookup and a few
+// compares each. Entries are only touched by the dispatching thread.
+class PidDispatcher
+{
+public:
+    static const size_t PidCount = 8192;
+    static const uint16_t NullPID = 0x1FFF;
+
+    struct Entry
+    {
+        PacketSink * sink;
+        uint64_t packets;
+        uint32_t continuityErrors;
+        uint32_t transportErrors;
+        int8_t lastContinuityCounter;   // -1 until the first packet with payload
+        bool enabled;
+    };
+
+    PidDispatcher();
+
+    void Subscribe(uint16_t pid, PacketSink * sink);
+    void Unsubscribe(uint16_t pid);
+    void Enable(uint16_t pid, bool enabled);
+    bool IsSubscribed(uint16_t pid) const { return _entries[pid & (PidCount - 1)].enabled; }
+    PacketSink * Sink(uint16_t pid) const { return _entries[pid & (PidCount - 1)].sink; }
+
+    void Dispatch(const uint8_t * packet)
+    {
+        Entry & entry = _entries[PacketPID(packet)];
+        ++entry.packets;
+        CheckContinuity(entry, packet);
+        if (entry.enabled)
+            entry.sink->PushPacket(packet);
+    }
+
+    static uint16_t PacketPID(const uint8_t * packet)
+    {
+        return static_cast<uint16_t>(((packet[1] & 0x1F) << 8) | packet[2]);
+    }
+
+    const Entry & operator[](uint16_t pid) const { return _entries[pid & (PidCount - 1)]; }
+    uint64_t TotalPackets() const;
+    uint64_t ContinuityErrors() const;
+    uint64_t TransportErrors() const;
+    uint64_t DispatchedPackets() const;
+    size_t ActivePIDs() const;
+
+private:
+    static void CheckContinuity(Entry & entry, const uint8_t * packet)
+    {
+        if (packet[1] & 0x80)
+        {
+            ++entry.transportErrors;
+            return;
+        }
+        // Only packets with payload advance the counter; a set discontinuity_indicator restarts it
+        uint8_t adaptationFieldControl = packet[3] & 0x30;
+        if (!(adaptationFieldControl & 0x10))
+            return;
+        int8_t continuityCounter = static_cast<int8_t>(packet[3] & 0x0F);
+        bool discontinuity = (adaptationFieldControl == 0x30) && (packet[4] > 0) && (packet[5] & 0x80);
+        if ((entry.lastContinuityCounter >= 0) && !discontinuity &&
+            (continuityCounter != entry.lastContinuityCounter) &&
+            (continuityCounter != ((entry.lastContinuityCounter + 1) & 0x0F)))
+            ++entry.continuityErrors;
+        entry.lastContinuityCounter = continuityCounter;
+    }
+
+    std::vector<Entry> _entries;
+};
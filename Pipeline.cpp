@@ -0,0 +1,241 @@
+#include "Pipeline.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <pthread.h>
+
+using namespace std;
+
+namespace {
+
+thread_local ostringstream * t_stageOutput = nullptr;
+
+// Spin briefly, then yield, then sleep, so idle stages on a low rate live input do not burn a core
+class Backoff
+{
+public:
+    Backoff()
+        : _count(0)
+    {}
+
+    void Pause()
+    {
+        if (_count < 64)
+            this_thread::yield();
+        else
+            this_thread::sleep_for(chrono::microseconds(_count < 256 ? 10 : 200));
+        ++_count;
+    }
+    void Reset() { _count = 0; }
+
+private:
+    unsigned _count;
+};
+
+} // namespace
+
+class PacketPipeline::Stage : public PacketSink
+{
+public:
+    Stage(const string & name, PacketSink * decoder)
+        : _name(name)
+        , _decoder(decoder)
+        , _batches()
+        , _free(BatchesPerStage)
+        , _full(BatchesPerStage)
+        , _outputQueue(OutputQueueSize)
+        , _current(nullptr)
+        , _thread()
+        , _stopping(false)
+        , _text()
+    {
+        for (size_t i = 0; i < BatchesPerStage; ++i)
+        {
+            _batches.emplace_back(new PacketBatch);
+            _batches.back()->count = 0;
+            _free.TryPush(_batches.back().get());
+        }
+    }
+
+    // Reader thread
+    void PushPacket(const uint8_t * packet) override
+    {
+        if (!_current)
+        {
+            Backoff backoff;
+            while (!_free.TryPop(_current))
+                backoff.Pause();
+        }
+        memcpy(_current->packets + _current->count * PacketSize, packet, PacketSize);
+        if (++_current->count == PacketBatch::Capacity)
+            Submit();
+    }
+    void Flush()
+    {
+        if (_current && (_current->count > 0))
+            Submit();
+    }
+    void Start()
+    {
+        _thread = thread(&Stage::Run, this);
+        // Linux limits thread names to 15 characters
+        pthread_setname_np(_thread.native_handle(), _name.substr(0, 15).c_str());
+    }
+    void Stop()
+    {
+        Flush();
+        _stopping.store(true, memory_order_release);
+        if (_thread.joinable())
+            _thread.join();
+    }
+
+    // Output thread
+    bool PopOutput(string & text)
+    {
+        return _outputQueue.TryPop(text);
+    }
+
+private:
+    void Submit()
+    {
+        Backoff backoff;
+        while (!_full.TryPush(_current))
+            backoff.Pause();
+        _current = nullptr;
+    }
+
+    // Stage thread
+    void Run()
+    {
+        t_stageOutput = &_text;
+        Backoff backoff;
+        for (;;)
+        {
+            PacketBatch * batch;
+            if (_full.TryPop(batch))
+            {
+                _decoder->PushPackets(batch->packets, batch->count);
+                batch->count = 0;
+                _free.TryPush(batch);
+                PublishOutput();
+                backoff.Reset();
+                continue;
+            }
+            // The reader sets _stopping after its last Submit, so an empty ring now means we are done
+            if (_stopping.load(memory_order_acquire) && _full.Empty())
+                break;
+            backoff.Pause();
+        }
+        PublishOutput();
+        t_stageOutput = nullptr;
+    }
+    void PublishOutput()
+    {
+        if (_text.tellp() <= 0)
+            return;
+        string text = _text.str();
+        _text.str(string());
+        Backoff backoff;
+        while (!_outputQueue.TryPush(move(text)))
+            backoff.Pause();
+    }
+
+    string _name;
+    PacketSink * _decoder;
+    vector<unique_ptr<PacketBatch>> _batches;
+    SpscRing<PacketBatch *> _free;
+    SpscRing<PacketBatch *> _full;
+    SpscRing<string> _outputQueue;
+    PacketBatch * _current;
+    thread _thread;
+    atomic<bool> _stopping;
+    ostringstream _text;
+};
+
+PacketPipeline::PacketPipeline(ostream & output)
+    : _output(output)
+    , _stages()
+    , _outputThread()
+    , _stagesStopped(false)
+    , _running(false)
+{
+}
+
+PacketPipeline::~PacketPipeline()
+{
+    Stop();
+}
+
+PacketSink * PacketPipeline::AddStage(const string & name, PacketSink * decoder)
+{
+    _stages.emplace_back(new Stage(name, decoder));
+    return _stages.back().get();
+}
+
+void PacketPipeline::Start()
+{
+    if (_running)
+        return;
+    _running = true;
+    _stagesStopped.store(false, memory_order_release);
+    for (auto & stage : _stages)
+        stage->Start();
+    _outputThread = thread(&PacketPipeline::RunOutput, this);
+    pthread_setname_np(_outputThread.native_handle(), "output");
+}
+
+void PacketPipeline::Flush()
+{
+    for (auto & stage : _stages)
+        stage->Flush();
+}
+
+void PacketPipeline::Stop()
+{
+    if (!_running)
+        return;
+    for (auto & stage : _stages)
+        stage->Stop();
+    _stagesStopped.store(true, memory_order_release);
+    if (_outputThread.joinable())
+        _outputThread.join();
+    _output.flush();
+    _running = false;
+}
+
+ostream & PacketPipeline::Output()
+{
+    return t_stageOutput ? *t_stageOutput : cout;
+}
+
+void PacketPipeline::SetThreadOutput(ostringstream * buffer)
+{
+    t_stageOutput = buffer;
+}
+
+void PacketPipeline::RunOutput()
+{
+    Backoff backoff;
+    for (;;)
+    {
+        // Read the flag before draining, so output published just before the stages stopped is not lost
+        bool stopped = _stagesStopped.load(memory_order_acquire);
+        bool wrote = false;
+        string text;
+        for (auto & stage : _stages)
+        {
+            while (stage->PopOutput(text))
+            {
+                _output.write(text.data(), static_cast<streamsize>(text.size()));
+                wrote = true;
+            }
+        }
+        if (wrote)
+            backoff.Reset();
+        else if (stopped)
+            break;
+        else
+            backoff.Pause();
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "PidDispatcher.h"
+#include "SpscRing.h"
+
+// Packets handed from the reader thread to a decoder thread in one go
+struct PacketBatch
+{
+    static const size_t Capacity = 256;
+
+    size_t count;
+    uint8_t packets[Capacity * PacketSink::PacketSize];
+};
+
+// Multi-threaded packet processing:
+// - the thread calling Process (the reader) dispatches packets to the front sinks returned by AddStage, which copy
+//   them into batches
+// - every stage (one per table family) runs its decoder on its own thread, fed by a bounded SPSC ring of batches
+// - text the decoders write to Output() is collected per stage and written by a separate output thread
+// Packets of one stage are decoded in arrival order, so per-PID order is kept.
+class PacketPipeline
+{
+public:
+    static const size_t BatchesPerStage = 16;
+    static const size_t OutputQueueSize = 256;
+
+    explicit PacketPipeline(std::ostream & output);
+    ~PacketPipeline();
+
+    // Adds a stage that runs decoder on its own thread. Returns the sink to subscribe in the PidDispatcher instead
+    // of the decoder. Stages must be added before Start.
+    PacketSink * AddStage(const std::string & name, PacketSink * decoder);
+
+    void Start();
+    // Hands over partially filled batches, so low rate (live) input does not sit in a batch for long
+    void Flush();
+    // Flushes, lets all stages drain and joins the threads
+    void Stop();
+
+    // Stream for decoder output. On stage threads this is a per-stage buffer that the output thread picks up and
+    // writes to the stream passed to the constructor, on any other thread it is cout.
+    static std::ostream & Output();
+    // Makes Output() write to buffer on the calling thread, for threads that decode without a pipeline of their
+    // own (one per input when several are processed at once). nullptr goes back to cout.
+    static void SetThreadOutput(std::ostringstream * buffer);
+
+private:
+    class Stage;
+
+    PacketPipeline(const PacketPipeline &) = delete;
+    PacketPipeline & operator = (const PacketPipeline &) = delete;
+
+    void RunOutput();
+
+    std::ostream & _output;
+    std::vector<std::unique_ptr<Stage>> _stages;
+    std::thread _outputThread;
+    std::atomic<bool> _stagesStopped;
+    bool _running;
+};
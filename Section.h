@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Fields of the long (syntax indicator 1) PSI/SI section header, ISO/IEC 13818-1 2.4.4
+struct SectionHeader
+{
+    static const size_t ShortHeaderSize = 3;
+    static const size_t LongHeaderSize = 8;
+    static const size_t CRCSize = 4;
+    static const size_t MaxSectionSize = 4096;
+
+    uint8_t tableId;
+    bool syntaxIndicator;
+    uint16_t sectionLength;     // Bytes following the section_length field
+    uint16_t extension;         // transport_stream_id (PAT), network_id (NIT), service_id (EIT), ...
+    uint8_t version;
+    bool currentNext;
+    uint8_t sectionNumber;
+    uint8_t lastSectionNumber;
+
+    size_t TotalSize() const { return ShortHeaderSize + sectionLength; }
+
+    static uint16_t SectionLength(const uint8_t * data)
+    {
+        return static_cast<uint16_t>(((data[1] & 0x0F) << 8) | data[2]);
+    }
+
+    // Parses the header of a complete section. Returns false if the data is too short or the section has no long
+    // header (only the short header fields are filled in then).
+    static bool Parse(const uint8_t * data, size_t size, SectionHeader & header)
+    {
+        if (size < ShortHeaderSize)
+            return false;
+        header.tableId = data[0];
+        header.syntaxIndicator = (data[1] & 0x80) != 0;
+        header.sectionLength = SectionLength(data);
+        header.extension = 0;
+        header.version = 0;
+        header.currentNext = true;
+        header.sectionNumber = 0;
+        header.lastSectionNumber = 0;
+        if (!header.syntaxIndicator || (size < LongHeaderSize + CRCSize) || (size < header.TotalSize()))
+            return false;
+        header.extension = static_cast<uint16_t>((data[3] << 8) | data[4]);
+        header.version = (data[5] >> 1) & 0x1F;
+        header.currentNext = (data[5] & 0x01) != 0;
+        header.sectionNumber = data[6];
+        header.lastSectionNumber = data[7];
+        return true;
+    }
+
+    // CRC_32 as transmitted in the last four bytes of a long section
+    static uint32_t StoredCRC(const uint8_t * data, size_t size)
+    {
+        const uint8_t * crc = data + size - CRCSize;
+        return (uint32_t(crc[0]) << 24) | (uint32_t(crc[1]) << 16) | (uint32_t(crc[2]) << 8) | crc[3];
+    }
+};
+
+// Table ids of EIT sections (present/following and schedule, actual and other TS)
+inline bool IsEITTableId(uint8_t tableId)
+{
+    return (tableId >= 0x4E) && (tableId <= 0x6F);
+}
+
+// EIT of the transport stream it is sent in, rather than of another one
+inline bool IsActualEITTableId(uint8_t tableId)
+{
+    return (tableId == 0x4E) || ((tableId >= 0x50) && (tableId <= 0x5F));
+}
+
+inline bool IsPresentFollowingTableId(uint8_t tableId)
+{
+    return (tableId == 0x4E) || (tableId == 0x4F);
+}
+
+// version_number is 5 bits and wraps. A version is taken as newer when it is at most 15 steps ahead.
+inline bool IsNewerVersion(uint8_t version, uint8_t than)
+{
+    return static_cast<uint8_t>(((version - than) & 0x1F) - 1) < 15;
+}
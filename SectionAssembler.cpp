@@ -0,0 +1,143 @@
+#include "SectionAssembler.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+SectionAssembler::SectionAssembler(SectionHandler & handler)
+    : _handler(handler)
+    , _buffer()
+    , _size(0)
+    , _expected(0)
+    , _assembling(false)
+    , _lastContinuityCounter(-1)
+    , _discontinuities()
+    , _transportErrors()
+{
+}
+
+void SectionAssembler::Reset()
+{
+    _size = 0;
+    _expected = 0;
+    _assembling = false;
+    _lastContinuityCounter = -1;
+}
+
+void SectionAssembler::Drop()
+{
+    if (!_assembling)
+        return;
+    _assembling = false;
+    _size = 0;
+    _expected = 0;
+    _handler.OnDiscontinuity();
+}
+
+void SectionAssembler::PushPacket(const uint8_t * packet)
+{
+    if (packet[1] & 0x80)
+    {
+        _transportErrors.Add();
+        Drop();
+        return;
+    }
+    uint8_t adaptationFieldControl = (packet[3] >> 4) & 0x03;
+    if (!(adaptationFieldControl & 0x01))
+        return;     // No payload, and the continuity counter does not advance
+
+    int continuityCounter = packet[3] & 0x0F;
+    if (_lastContinuityCounter >= 0)
+    {
+        if (continuityCounter == _lastContinuityCounter)
+            return;     // Duplicate packet
+        if (continuityCounter != ((_lastContinuityCounter + 1) & 0x0F))
+        {
+            _discontinuities.Add();
+            Drop();
+        }
+    }
+    _lastContinuityCounter = continuityCounter;
+
+    size_t offset = 4;
+    if (adaptationFieldControl == 0x03)
+        offset += 1 + packet[4];
+    if (offset >= PacketSize)
+        return;
+    const uint8_t * payload = packet + offset;
+    size_t size = PacketSize - offset;
+    if (_assembling)
+        _handler.OnSectionContinued();
+
+    if (packet[1] & 0x40)
+    {
+        size_t pointer = payload[0];
+        if (1 + pointer > size)
+        {
+            Drop();
+            return;
+        }
+        if (_assembling)
+        {
+            Append(payload + 1, pointer);
+            // The previous section should have ended where the new one starts
+            Drop();
+        }
+        StartSections(payload + 1 + pointer, size - 1 - pointer);
+    }
+    else if (_assembling)
+    {
+        Append(payload, size);
+    }
+}
+
+size_t SectionAssembler::Append(const uint8_t * data, size_t size)
+{
+    size_t consumed = 0;
+    if (_size < SectionHeader::ShortHeaderSize)
+    {
+        size_t count = min(size, SectionHeader::ShortHeaderSize - _size);
+        memcpy(_buffer + _size, data, count);
+        _size += count;
+        consumed += count;
+        if (_size < SectionHeader::ShortHeaderSize)
+            return consumed;
+        _expected = SectionHeader::ShortHeaderSize + SectionHeader::SectionLength(_buffer);
+        if (_expected > sizeof(_buffer))
+        {
+            // Corrupt length, nothing after this in the data can be trusted
+            Drop();
+            return size;
+        }
+    }
+    size_t count = min(size - consumed, _expected - _size);
+    memcpy(_buffer + _size, data + consumed, count);
+    _size += count;
+    consumed += count;
+    if (_size == _expected)
+    {
+        _assembling = false;
+        _handler.OnSection(_buffer, _size);
+        _size = 0;
+        _expected = 0;
+    }
+    return consumed;
+}
+
+void SectionAssembler::StartSections(const uint8_t * data, size_t size)
+{
+    // A table_id of 0xFF marks stuffing up to the end of the packet
+    while ((size > 0) && (data[0] != 0xFF))
+    {
+        _assembling = true;
+        _size = 0;
+        _expected = 0;
+        _handler.OnSectionStart();
+        size_t consumed = Append(data, size);
+        if (_assembling || (consumed == 0))
+            break;
+        data += consumed;
+        size -= consumed;
+    }
+}
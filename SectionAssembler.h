@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Metrics.h"
+#include "Section.h"
+
+// Receiver of complete sections from a SectionAssembler
+class SectionHandler
+{
+public:
+    virtual ~SectionHandler() {}
+
+    // A new section starts in the packet being processed
+    virtual void OnSectionStart() {}
+    // The packet being processed continues the section being assembled
+    virtual void OnSectionContinued() {}
+    // A section is complete. The data is only valid during the call. The CRC is not checked.
+    virtual void OnSection(const uint8_t * section, size_t size) = 0;
+    // The section being assembled was dropped, because of a continuity error or a transport error
+    virtual void OnDiscontinuity() {}
+};
+
+// Reassembles PSI/SI sections from the packets of one PID, handling pointer fields, several sections in one
+// packet, stuffing, duplicate packets and continuity counter gaps.
+class SectionAssembler
+{
+public:
+    static const size_t PacketSize = 188;
+
+    explicit SectionAssembler(SectionHandler & handler);
+
+    void PushPacket(const uint8_t * packet);
+    void Reset();
+
+    bool Assembling() const { return _assembling; }
+    uint64_t Discontinuities() const { return _discontinuities; }
+    uint64_t TransportErrors() const { return _transportErrors; }
+
+private:
+    size_t Append(const uint8_t * data, size_t size);
+    void StartSections(const uint8_t * data, size_t size);
+    void Drop();
+
+    SectionHandler & _handler;
+    uint8_t _buffer[SectionHeader::MaxSectionSize];
+    size_t _size;
+    size_t _expected;
+    bool _assembling;
+    int _lastContinuityCounter;
+    Counter _discontinuities;
+    Counter _transportErrors;
+};
@@ -0,0 +1,101 @@
+#include "SectionCache.h"
+
+#include "Crc32.h"
+
+using namespace std;
+
+SectionCache::SectionCache()
+    : _entries(4096, Entry { 0, 0, 0, false })
+    , _count(0)
+    , _hits()
+    , _misses()
+    , _hitsPerTable()
+    , _missesPerTable()
+{
+}
+
+uint64_t SectionCache::Key(const uint8_t * section, const SectionHeader & header)
+{
+    uint64_t key = (uint64_t(header.tableId) << 56) | (uint64_t(header.extension) << 40) |
+                   (uint64_t(header.sectionNumber) << 32);
+    if (IsEITTableId(header.tableId))
+    {
+        // transport_stream_id and original_network_id follow the long header
+        key |= (uint64_t(section[8]) << 24) | (uint64_t(section[9]) << 16) |
+               (uint64_t(section[10]) << 8) | section[11];
+    }
+    return key;
+}
+
+size_t SectionCache::Hash(uint64_t key)
+{
+    // Finalizer of MurmurHash3, spreads the packed fields over all bits
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ull;
+    key ^= key >> 33;
+    return static_cast<size_t>(key);
+}
+
+SectionCache::Entry & SectionCache::FindSlot(uint64_t key)
+{
+    size_t mask = _entries.size() - 1;
+    size_t slot = Hash(key) & mask;
+    while (_entries[slot].used && (_entries[slot].key != key))
+        slot = (slot + 1) & mask;
+    return _entries[slot];
+}
+
+bool SectionCache::IsRepeat(const uint8_t * section, size_t size)
+{
+    SectionHeader header;
+    if (!SectionHeader::Parse(section, size, header) ||
+        (IsEITTableId(header.tableId) && (size < SectionHeader::LongHeaderSize + 6 + SectionHeader::CRCSize)))
+        return false;
+
+    uint64_t key = Key(section, header);
+    uint32_t crc = SectionHeader::StoredCRC(section, header.TotalSize());
+    Entry & entry = FindSlot(key);
+    if (entry.used && (entry.version == header.version) && (entry.crc == crc))
+    {
+        _hits.Add();
+        _hitsPerTable[header.tableId].Add();
+        return true;
+    }
+
+    _misses.Add();
+    _missesPerTable[header.tableId].Add();
+    // A corrupted section is not remembered, or its correct repeats would be dropped until the next version
+    if (!Crc32::Check(section, header.TotalSize()))
+        return false;
+    if (!entry.used)
+    {
+        entry.used = true;
+        entry.key = key;
+        ++_count;
+    }
+    entry.version = header.version;
+    entry.crc = crc;
+    if (_count * 2 > _entries.size())
+        Grow();
+    return false;
+}
+
+void SectionCache::Grow()
+{
+    vector<Entry> entries(_entries.size() * 2, Entry { 0, 0, 0, false });
+    entries.swap(_entries);
+    for (const Entry & entry : entries)
+    {
+        if (entry.used)
+            FindSlot(entry.key) = entry;
+    }
+}
+
+void SectionCache::Clear()
+{
+    for (Entry & entry : _entries)
+        entry.used = false;
+    _count = 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Metrics.h"
+#include "Section.h"
+
+// Remembers the version and CRC_32 of every section seen, so carousel repeats can be dropped before they reach
+// a decoder. Sections are identified by table_id, table_id_extension and section_number; for EIT sections the
+// transport_stream_id and original_network_id are included too, as service ids are only unique per TS.
+// A section with the same identity, version and CRC as a cached one is a repeat. Only sections with a correct CRC
+// are recorded, which costs a CRC computation for every section that is not a repeat.
+class SectionCache
+{
+public:
+    SectionCache();
+
+    // Returns true if the section is a repeat. Otherwise the section is recorded (replacing an older version)
+    // and false is returned. Sections without a long header are never cached.
+    bool IsRepeat(const uint8_t * section, size_t size);
+
+    // Counters can be read from another thread than the one filtering
+    uint64_t Hits() const { return _hits; }
+    uint64_t Misses() const { return _misses; }
+    uint64_t Hits(uint8_t tableId) const { return _hitsPerTable[tableId]; }
+    uint64_t Misses(uint8_t tableId) const { return _missesPerTable[tableId]; }
+    size_t Size() const { return _count; }
+    void Clear();
+
+    static uint64_t Key(const uint8_t * section, const SectionHeader & header);
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t crc;
+        uint8_t version;
+        bool used;
+    };
+
+    static size_t Hash(uint64_t key);
+
+    Entry & FindSlot(uint64_t key);
+    void Grow();
+
+    std::vector<Entry> _entries;
+    size_t _count;
+    Counter _hits;
+    Counter _misses;
+    Counter _hitsPerTable[256];
+    Counter _missesPerTable[256];
+};
@@ -0,0 +1,146 @@
+#include "SectionFilter.h"
+
+#include <cstring>
+#include "Crc32.h"
+
+using namespace std;
+
+SectionFilter::SectionFilter(PacketSink & downstream)
+    : _downstream(&downstream)
+    , _sectionDownstream(nullptr)
+    , _assembler(*this)
+    , _cache()
+    , _registry(nullptr)
+    , _owner(0)
+    , _completeness(nullptr)
+    , _pending()
+    , _pendingCount(0)
+    , _packet(nullptr)
+    , _packetPending(false)
+    , _packetForwarded(false)
+    , _sectionForwarded(false)
+    , _signalDiscontinuity(false)
+    , _continuityCounter(0)
+    , _packetsForwarded()
+    , _packetsDropped()
+{
+    // Enough for the largest section
+    _pending.reserve((SectionHeader::MaxSectionSize / 184 + 2) * PacketSize);
+}
+
+SectionFilter::SectionFilter(SectionHandler & downstream)
+    : _downstream(nullptr)
+    , _sectionDownstream(&downstream)
+    , _assembler(*this)
+    , _cache()
+    , _registry(nullptr)
+    , _owner(0)
+    , _completeness(nullptr)
+    , _pending()
+    , _pendingCount(0)
+    , _packet(nullptr)
+    , _packetPending(false)
+    , _packetForwarded(false)
+    , _sectionForwarded(false)
+    , _signalDiscontinuity(false)
+    , _continuityCounter(0)
+    , _packetsForwarded()
+    , _packetsDropped()
+{
+}
+
+void SectionFilter::PushPacket(const uint8_t * packet)
+{
+    _packet = packet;
+    _packetPending = false;
+    _packetForwarded = false;
+    _assembler.PushPacket(packet);
+    _packet = nullptr;
+}
+
+void SectionFilter::OnSectionStart()
+{
+    // Once the first packet of a section has been forwarded (because it also ended a section that had to be
+    // forwarded), the rest of the section must follow, or the decoder would be left with half a section.
+    _sectionForwarded = _packetForwarded;
+    if (_sectionDownstream)
+        return;
+    if (!_packetForwarded && !_packetPending)
+        AddPending();
+}
+
+void SectionFilter::OnSectionContinued()
+{
+    // A packet continuing a section belongs to it, whatever else happens in the packet
+    if (!_sectionDownstream)
+        AddPending();
+}
+
+void SectionFilter::OnSection(const uint8_t * section, size_t size)
+{
+    if (_completeness)
+        _completeness->AddSection(section, size);
+    bool repeat = _cache.IsRepeat(section, size);
+    // A corrupted copy must not claim the section, or the registry would turn away the good copies other inputs see
+    SectionHeader header;
+    if (!repeat && _registry && SectionHeader::Parse(section, size, header) &&
+        Crc32::Check(section, header.TotalSize()))
+        repeat = !_registry->Claim(section, size, _owner);
+    if (_sectionDownstream)
+    {
+        if (!repeat)
+            _sectionDownstream->OnSection(section, size);
+        return;
+    }
+    if (_sectionForwarded || !repeat)
+        ForwardPending();
+    else
+        DropPending();
+    _sectionForwarded = false;
+}
+
+void SectionFilter::OnDiscontinuity()
+{
+    DropPending();
+    _sectionForwarded = false;
+    _signalDiscontinuity = true;
+}
+
+void SectionFilter::AddPending()
+{
+    _pending.resize((_pendingCount + 1) * PacketSize);
+    memcpy(_pending.data() + _pendingCount * PacketSize, _packet, PacketSize);
+    ++_pendingCount;
+    _packetPending = true;
+}
+
+void SectionFilter::ForwardPending()
+{
+    if (_pendingCount == 0)
+        return;
+    if (_signalDiscontinuity)
+    {
+        // Skip a counter value, so the decoder drops whatever it was assembling as well
+        _continuityCounter = (_continuityCounter + 1) & 0x0F;
+        _signalDiscontinuity = false;
+    }
+    for (size_t i = 0; i < _pendingCount; ++i)
+    {
+        uint8_t * packet = _pending.data() + i * PacketSize;
+        packet[3] = static_cast<uint8_t>((packet[3] & 0xF0) | _continuityCounter);
+        _continuityCounter = (_continuityCounter + 1) & 0x0F;
+    }
+    _downstream->PushPackets(_pending.data(), _pendingCount);
+    _packetsForwarded.Add(_pendingCount);
+    if (_packetPending)
+        _packetForwarded = true;
+    _pendingCount = 0;
+    _packetPending = false;
+}
+
+void SectionFilter::DropPending()
+{
+    _packetsDropped.Add(_pendingCount);
+    _pendingCount = 0;
+    _packetPending = false;
+}
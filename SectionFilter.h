@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "EitCompleteness.h"
+#include "PidDispatcher.h"
+#include "SectionAssembler.h"
+#include "SectionCache.h"
+#include "TableVersionRegistry.h"
+
+// Sits between the PID dispatcher and a packet based decoder (libdvbpsi) for one PID.
+// Packets are held back until the section they carry is complete. If the SectionCache knows the section
+// (same identity, version and CRC), its packets are dropped, so carousel repeats never reach the decoder.
+// Otherwise the packets are forwarded, with continuity counters renumbered so the decoder does not see the
+// gaps left by dropped sections. A real discontinuity in the input is passed on as a gap.
+// With a TableVersionRegistry, sections of tables that another input's parser decodes are dropped as well.
+// An EitCompleteness tracker is shown every section, repeats included.
+// A section based decoder (EitDecoder) is handed the new sections themselves, so no packets are copied.
+class SectionFilter : public PacketSink, private SectionHandler
+{
+public:
+    explicit SectionFilter(PacketSink & downstream);
+    explicit SectionFilter(SectionHandler & downstream);
+
+    void PushPacket(const uint8_t * packet) override;
+
+    // Shares table versions with the filters of other inputs; owner identifies this input. Not owned.
+    void SetRegistry(TableVersionRegistry * registry, uint32_t owner) { _registry = registry; _owner = owner; }
+    // Not owned
+    void SetCompleteness(EitCompleteness * completeness) { _completeness = completeness; }
+
+    const SectionCache & Cache() const { return _cache; }
+    const SectionAssembler & Assembler() const { return _assembler; }
+    uint64_t PacketsForwarded() const { return _packetsForwarded; }
+    uint64_t PacketsDropped() const { return _packetsDropped; }
+
+private:
+    void OnSectionStart() override;
+    void OnSectionContinued() override;
+    void OnSection(const uint8_t * section, size_t size) override;
+    void OnDiscontinuity() override;
+
+    void AddPending();
+    void ForwardPending();
+    void DropPending();
+
+    // One of the two is set
+    PacketSink * _downstream;
+    SectionHandler * _sectionDownstream;
+    SectionAssembler _assembler;
+    SectionCache _cache;
+    TableVersionRegistry * _registry;
+    uint32_t _owner;
+    EitCompleteness * _completeness;
+    // Copies of the packets of the section being assembled, contiguous so they can be forwarded in one go
+    std::vector<uint8_t> _pending;
+    size_t _pendingCount;
+    const uint8_t * _packet;
+    bool _packetPending;
+    bool _packetForwarded;
+    bool _sectionForwarded;
+    bool _signalDiscontinuity;
+    uint8_t _continuityCounter;
+    Counter _packetsForwarded;
+    Counter _packetsDropped;
+};
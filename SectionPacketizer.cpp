@@ -0,0 +1,37 @@
+#include "SectionPacketizer.h"
+
+#include <cstring>
+
+using namespace std;
+
+SectionPacketizer::SectionPacketizer(uint16_t pid)
+    : _pid(pid & 0x1FFF)
+    , _continuityCounter(0)
+{
+}
+
+void SectionPacketizer::Packetize(const uint8_t * section, size_t size, vector<uint8_t> & packets)
+{
+    size_t offset = 0;
+    bool first = true;
+    while (first || (offset < size))
+    {
+        size_t packetStart = packets.size();
+        packets.resize(packetStart + PacketSize, 0xFF);
+        uint8_t * packet = packets.data() + packetStart;
+        packet[0] = 0x47;
+        packet[1] = static_cast<uint8_t>((first ? 0x40 : 0x00) | (_pid >> 8));
+        packet[2] = static_cast<uint8_t>(_pid);
+        packet[3] = static_cast<uint8_t>(0x10 | _continuityCounter);
+        _continuityCounter = (_continuityCounter + 1) & 0x0F;
+        size_t payloadOffset = 4;
+        if (first)
+            packet[payloadOffset++] = 0;   // pointer_field
+        size_t chunk = PacketSize - payloadOffset;
+        if (chunk > size - offset)
+            chunk = size - offset;
+        memcpy(packet + payloadOffset, section + offset, chunk);
+        offset += chunk;
+        first = false;
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Splits PSI/SI sections into 188 byte transport stream packets for one PID, the reverse of SectionAssembler.
+// Every section starts in a new packet (pointer_field 0) and the last packet is filled up with 0xFF stuffing.
+// Continuity counters run on over all sections of the PID.
+class SectionPacketizer
+{
+public:
+    static const size_t PacketSize = 188;
+
+    explicit SectionPacketizer(uint16_t pid);
+
+    // Appends the packets of the section to packets
+    void Packetize(const uint8_t * section, size_t size, std::vector<uint8_t> & packets);
+
+    uint16_t PID() const { return _pid; }
+    uint8_t ContinuityCounter() const { return _continuityCounter; }
+
+private:
+    uint16_t _pid;
+    uint8_t _continuityCounter;
+};
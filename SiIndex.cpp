@@ -0,0 +1,261 @@
+#include "SiIndex.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "OutputBuffer.h"
+#include "TransportStreamReader.h"
+
+using namespace std;
+
+const char SiIndexHeader::Magic[8] = { 'D', 'V', 'B', 'E', 'P', 'G', 'S', 'I' };
+const char * const SiIndexSuffix = ".siidx";
+
+namespace {
+
+const size_t PidCount = 8192;
+// PAT, NIT, SDT/BAT, EIT and TDT/TOT
+const uint16_t SiPIDs[] = { 0x0000, 0x0010, 0x0011, 0x0012, 0x0014 };
+const size_t PatEntrySize = 4;
+
+bool FileIdentity(int fileHandle, uint64_t & size, int64_t & modified)
+{
+    struct stat status;
+    if ((fstat(fileHandle, &status) != 0) || !S_ISREG(status.st_mode))
+        return false;
+    size = static_cast<uint64_t>(status.st_size);
+    modified = int64_t(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+    return true;
+}
+
+bool ReadAll(int fileHandle, void * data, size_t length)
+{
+    uint8_t * position = static_cast<uint8_t *>(data);
+    while (length > 0)
+    {
+        ssize_t bytesRead = read(fileHandle, position, length);
+        if (bytesRead < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        if (bytesRead == 0)
+            return false;
+        position += bytesRead;
+        length -= static_cast<size_t>(bytesRead);
+    }
+    return true;
+}
+
+bool WriteAll(int fileHandle, const void * data, size_t length)
+{
+    const uint8_t * position = static_cast<const uint8_t *>(data);
+    while (length > 0)
+    {
+        ssize_t bytesWritten = write(fileHandle, position, length);
+        if (bytesWritten < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        position += bytesWritten;
+        length -= static_cast<size_t>(bytesWritten);
+    }
+    return true;
+}
+
+} // namespace
+
+SiIndexWriter::SiIndexWriter(const TransportStreamReader & reader)
+    : _reader(reader)
+    , _indexed(PidCount, false)
+    , _offsets()
+    , _patAssembler(*this)
+{
+    for (uint16_t pid : SiPIDs)
+        _indexed[pid] = true;
+}
+
+uint64_t SiIndexWriter::PacketOffset() const
+{
+    return _reader.PacketOffset();
+}
+
+void SiIndexWriter::OnSection(const uint8_t * section, size_t size)
+{
+    SectionHeader header;
+    if (!SectionHeader::Parse(section, size, header) || (header.tableId != 0x00))
+        return;
+    // Program 0 gives the network PID, the others their PMT PID. PIDs are only ever added, so packets of a
+    // PMT that moved are still in the index.
+    const uint8_t * end = section + header.TotalSize() - SectionHeader::CRCSize;
+    for (const uint8_t * entry = section + SectionHeader::LongHeaderSize; entry + PatEntrySize <= end;
+         entry += PatEntrySize)
+        _indexed[((entry[2] & 0x1F) << 8) | entry[3]] = true;
+}
+
+bool SiIndexWriter::Write(const string & path, int fileHandle) const
+{
+    SiIndexHeader header {};
+    memcpy(header.magic, SiIndexHeader::Magic, sizeof(header.magic));
+    header.version = SiIndexHeader::CurrentVersion;
+    header.packetSize = TransportStreamReader::PacketSize;
+    header.packetCount = _offsets.size();
+    if (!FileIdentity(fileHandle, header.fileSize, header.fileModified))
+    {
+        cerr << "Cannot index " << path << ", the input is not a regular file" << endl;
+        return false;
+    }
+
+    // Written under another name and renamed, so a reader never sees half an index
+    string temporaryPath = path + ".tmp";
+    int indexHandle = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (indexHandle < 0)
+    {
+        cerr << "Cannot create " << temporaryPath << ": " << strerror(errno) << endl;
+        return false;
+    }
+    bool written = WriteAll(indexHandle, &header, sizeof(header)) &&
+                   WriteAll(indexHandle, _offsets.data(), _offsets.size() * sizeof(uint64_t));
+    written = (close(indexHandle) == 0) && written;
+    if (!written || (rename(temporaryPath.c_str(), path.c_str()) != 0))
+    {
+        cerr << "Cannot write " << path << ": " << strerror(errno) << endl;
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+SiIndexReader::SiIndexReader(int fileHandle)
+    : _fileHandle(fileHandle)
+    , _fileSize(0)
+    , _offsets()
+    , _nextOffset(0)
+    , _buffer(BatchPackets * (PacketSize + MaxGap))
+    , _packets()
+    , _nextPacket(0)
+    , _packetsRead(0)
+    , _bytesRead(0)
+    , _reads(0)
+    , _startTime(chrono::steady_clock::now())
+    , _endTime()
+{
+    _packets.reserve(BatchPackets);
+}
+
+bool SiIndexReader::Open(const string & path)
+{
+    int indexHandle = open(path.c_str(), O_RDONLY);
+    if (indexHandle < 0)
+        return false;
+    SiIndexHeader header;
+    int64_t fileModified = 0;
+    bool valid = ReadAll(indexHandle, &header, sizeof(header)) &&
+                 (memcmp(header.magic, SiIndexHeader::Magic, sizeof(header.magic)) == 0) &&
+                 (header.version == SiIndexHeader::CurrentVersion) && (header.packetSize == PacketSize) &&
+                 FileIdentity(_fileHandle, _fileSize, fileModified) &&
+                 (header.fileSize == _fileSize) && (header.fileModified == fileModified) &&
+                 (header.packetCount <= _fileSize / PacketSize);
+    if (valid)
+    {
+        _offsets.resize(header.packetCount);
+        valid = ReadAll(indexHandle, _offsets.data(), _offsets.size() * sizeof(uint64_t));
+    }
+    close(indexHandle);
+    if (!valid)
+    {
+        _offsets.clear();
+        return false;
+    }
+    // The packets are fetched out of order as far as the kernel can tell, read ahead would only waste I/O
+    posix_fadvise(_fileHandle, 0, 0, POSIX_FADV_RANDOM);
+    _startTime = chrono::steady_clock::now();
+    return true;
+}
+
+bool SiIndexReader::ReadBatch()
+{
+    _packets.clear();
+    _nextPacket = 0;
+    size_t used = 0;
+    while ((_nextOffset < _offsets.size()) && (_packets.size() < BatchPackets))
+    {
+        // Extend the run while the next packet is close enough and fits in the batch
+        size_t first = _nextOffset;
+        size_t last = first;
+        uint64_t start = _offsets[first];
+        while ((last + 1 < _offsets.size()) && (_packets.size() + last + 1 - first < BatchPackets) &&
+               (_offsets[last + 1] >= _offsets[last] + PacketSize) &&
+               (_offsets[last + 1] - _offsets[last] - PacketSize <= MaxGap))
+            ++last;
+        size_t length = static_cast<size_t>(_offsets[last] + PacketSize - start);
+        if (used + length > _buffer.size())
+            break;
+
+        size_t done = 0;
+        while (done < length)
+        {
+            ssize_t bytesRead = pread(_fileHandle, _buffer.data() + used + done, length - done,
+                                      static_cast<off_t>(start + done));
+            if (bytesRead < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                cerr << "Read failed: " << strerror(errno) << endl;
+                _nextOffset = _offsets.size();
+                return !_packets.empty();
+            }
+            if (bytesRead == 0)
+                break;
+            done += static_cast<size_t>(bytesRead);
+            ++_reads;
+        }
+        _bytesRead += done;
+        // A file cut short after indexing only loses the packets beyond its end
+        for (size_t index = first; (index <= last) && (_offsets[index] + PacketSize <= start + done); ++index)
+            _packets.push_back(used + static_cast<size_t>(_offsets[index] - start));
+        used += length;
+        _nextOffset = last + 1;
+    }
+    return !_packets.empty();
+}
+
+const uint8_t * SiIndexReader::NextPacket()
+{
+    if ((_nextPacket == _packets.size()) && !ReadBatch())
+    {
+        if (_endTime <= _startTime)
+            _endTime = chrono::steady_clock::now();
+        return nullptr;
+    }
+    ++_packetsRead;
+    return _buffer.data() + _packets[_nextPacket++];
+}
+
+double SiIndexReader::ElapsedSeconds() const
+{
+    chrono::steady_clock::time_point end = (_endTime > _startTime) ? _endTime : chrono::steady_clock::now();
+    return chrono::duration<double>(end - _startTime).count();
+}
+
+double SiIndexReader::ThroughputMBps() const
+{
+    double elapsed = ElapsedSeconds();
+    if (elapsed <= 0)
+        return 0;
+    return static_cast<double>(_bytesRead) / (1000.0 * 1000.0) / elapsed;
+}
+
+void SiIndexReader::AppendMetrics(OutputBuffer & output) const
+{
+    output.Append(",\"indexed_packets\":");
+    output.AppendUnsigned(_offsets.size());
+    output.Append(",\"reads\":");
+    output.AppendUnsigned(_reads);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "PacketSource.h"
+#include "SectionAssembler.h"
+
+class TransportStreamReader;
+
+// Sidecar index of the SI packets in a capture file: the file offset of every packet on PID 0x00 (PAT),
+// 0x10 (NIT), 0x11 (SDT/BAT), 0x12 (EIT), 0x14 (TDT/TOT) and the PMT and network PIDs the PAT lists.
+// SI is well under 1% of a mux, so a scan through the index reads a small fraction of the file.
+// Layout: SiIndexHeader followed by packetCount 64 bit offsets in file order, in host byte order.
+struct SiIndexHeader
+{
+    static const char Magic[8];
+    static const uint32_t CurrentVersion = 1;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t packetSize;        // Bytes read at every offset
+    // The capture the index was made for; a file of another size or modification time needs a new index
+    uint64_t fileSize;
+    int64_t fileModified;       // Nanoseconds since the epoch
+    uint64_t packetCount;
+};
+
+// Suffix of the default index path, next to the capture
+extern const char * const SiIndexSuffix;
+
+// Collects the offsets of the SI packets during a full scan of a file, and writes the index afterwards
+class SiIndexWriter : private SectionHandler
+{
+public:
+    explicit SiIndexWriter(const TransportStreamReader & reader);
+
+    // Called with every packet the reader returns, before it reads the next one
+    void AddPacket(const uint8_t * packet)
+    {
+        uint16_t pid = static_cast<uint16_t>(((packet[1] & 0x1F) << 8) | packet[2]);
+        if (!_indexed[pid])
+            return;
+        _offsets.push_back(PacketOffset());
+        if (pid == PatPID)
+            _patAssembler.PushPacket(packet);
+    }
+
+    // Writes the index for the capture open as fileHandle. Only meaningful after the whole file was scanned.
+    bool Write(const std::string & path, int fileHandle) const;
+
+    size_t PacketCount() const { return _offsets.size(); }
+
+private:
+    static const uint16_t PatPID = 0x0000;
+
+    uint64_t PacketOffset() const;
+    // Indexes the PMT PIDs of the PAT
+    void OnSection(const uint8_t * section, size_t size) override;
+
+    const TransportStreamReader & _reader;
+    std::vector<bool> _indexed;
+    std::vector<uint64_t> _offsets;
+    SectionAssembler _patAssembler;
+};
+
+// Reads just the packets of an index from the capture, with one pread per run of nearby packets.
+// Packets less than MaxGap bytes apart are fetched together, reading the bytes in between.
+class SiIndexReader : public PacketSource
+{
+public:
+    static const size_t PacketSize = 188;
+    static const size_t BatchPackets = 1024;
+    static const size_t MaxGap = 1024;
+
+    explicit SiIndexReader(int fileHandle);
+
+    // Loads the index. Fails if it cannot be read or was made for another version of the capture.
+    bool Open(const std::string & path);
+
+    const uint8_t * NextPacket() override;
+    uint64_t PacketsRead() const override { return _packetsRead; }
+    uint64_t BytesConsumed() const override { return _bytesRead; }
+    double ElapsedSeconds() const override;
+    double ThroughputMBps() const override;
+    void AppendMetrics(OutputBuffer & output) const override;
+
+    uint64_t IndexedPackets() const { return _offsets.size(); }
+    uint64_t Reads() const { return _reads; }
+    uint64_t FileSize() const { return _fileSize; }
+
+private:
+    SiIndexReader(const SiIndexReader &) = delete;
+    SiIndexReader & operator = (const SiIndexReader &) = delete;
+
+    bool ReadBatch();
+
+    int _fileHandle;
+    uint64_t _fileSize;
+    std::vector<uint64_t> _offsets;
+    size_t _nextOffset;
+    std::vector<uint8_t> _buffer;
+    // Positions of the packets of the current batch in _buffer
+    std::vector<size_t> _packets;
+    size_t _nextPacket;
+    uint64_t _packetsRead;
+    uint64_t _bytesRead;
+    uint64_t _reads;
+    std::chrono::steady_clock::time_point _startTime;
+    std::chrono::steady_clock::time_point _endTime;
+};
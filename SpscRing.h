@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free ring buffer for exactly one producer thread and one consumer thread.
+// Each side keeps a cached copy of the other side's index, so the shared cache lines are only touched when the
+// ring looks full (producer) or empty (consumer).
+template <typename T>
+class SpscRing
+{
+public:
+    explicit SpscRing(size_t capacity)
+        : _slots(RoundUp(capacity))
+        , _mask(_slots.size() - 1)
+        , _head(0)
+        , _cachedTail(0)
+        , _tail(0)
+        , _cachedHead(0)
+    {}
+
+    size_t Capacity() const { return _slots.size(); }
+
+    bool TryPush(T && value)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if ((tail - _cachedHead) == _slots.size())
+        {
+            _cachedHead = _head.load(std::memory_order_acquire);
+            if ((tail - _cachedHead) == _slots.size())
+                return false;
+        }
+        _slots[tail & _mask] = std::move(value);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    bool TryPush(const T & value)
+    {
+        T copy(value);
+        return TryPush(std::move(copy));
+    }
+
+    bool TryPop(T & value)
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _cachedTail)
+        {
+            _cachedTail = _tail.load(std::memory_order_acquire);
+            if (head == _cachedTail)
+                return false;
+        }
+        value = std::move(_slots[head & _mask]);
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Only a hint when called from a thread that is neither producer nor consumer
+    bool Empty() const
+    {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+private:
+    static const size_t CacheLineSize = 64;
+
+    static size_t RoundUp(size_t capacity)
+    {
+        size_t result = 2;
+        while (result < capacity)
+            result <<= 1;
+        return result;
+    }
+
+    std::vector<T> _slots;
+    size_t _mask;
+    char _padding0[CacheLineSize];
+    // Consumer side
+    std::atomic<size_t> _head;
+    size_t _cachedTail;
+    char _padding1[CacheLineSize];
+    // Producer side
+    std::atomic<size_t> _tail;
+    size_t _cachedHead;
+    char _padding2[CacheLineSize];
+};
@@ -0,0 +1,42 @@
+#include "StreamClock.h"
+
+#include "Crc32.h"
+#include "EitDecoder.h"
+#include "Section.h"
+
+using namespace std;
+
+namespace {
+
+// UTC_time follows the short header in both tables
+const size_t UTCTimeSize = 5;
+
+} // namespace
+
+StreamClock::StreamClock()
+    : _now(0)
+    , _sections()
+    , _crcErrors()
+{
+}
+
+void StreamClock::OnSection(const uint8_t * section, size_t size)
+{
+    if (size < SectionHeader::ShortHeaderSize + UTCTimeSize)
+        return;
+    uint8_t tableId = section[0];
+    size_t length = SectionHeader::ShortHeaderSize + SectionHeader::SectionLength(section);
+    if ((tableId != TimeDateTableId) && (tableId != TimeOffsetTableId))
+        return;
+    // Only the TOT carries a CRC_32
+    if ((tableId == TimeOffsetTableId) && ((length > size) || !Crc32::Check(section, length)))
+    {
+        _crcErrors.Add();
+        return;
+    }
+    uint32_t now = DecodeDvbTime(section + SectionHeader::ShortHeaderSize);
+    if (now == 0)
+        return;
+    _now.store(now, memory_order_relaxed);
+    _sections.Add();
+}
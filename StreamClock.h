@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Metrics.h"
+#include "SectionAssembler.h"
+
+// Stream time from the TDT and TOT on PID 0x0014, which a multiplex sends every few seconds. Gives the time the
+// EPG is measured against on live input, rather than the clock of the machine it runs on.
+class StreamClock : public SectionHandler
+{
+public:
+    static const uint16_t PID = 0x0014;
+    static const uint8_t TimeDateTableId = 0x70;
+    static const uint8_t TimeOffsetTableId = 0x73;
+
+    StreamClock();
+
+    void OnSection(const uint8_t * section, size_t size) override;
+
+    // Unix time (UTC) of the last TDT or TOT, 0 until one came in. Can be read from any thread.
+    uint32_t Now() const { return _now.load(std::memory_order_relaxed); }
+    uint64_t Sections() const { return _sections; }
+    uint64_t CRCErrors() const { return _crcErrors; }
+
+private:
+    std::atomic<uint32_t> _now;
+    Counter _sections;
+    Counter _crcErrors;
+};
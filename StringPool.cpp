@@ -0,0 +1,77 @@
+#include "StringPool.h"
+
+#include <cstring>
+
+using namespace std;
+
+StringPool::StringPool()
+    : _data()
+    , _slots(1024, 0)
+    , _count(0)
+{
+    // Entry for the empty string at offset 0, it never goes into the hash table
+    _data.resize(sizeof(uint16_t) + 1, 0);
+}
+
+uint32_t StringPool::Hash(const char * data, size_t length)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool StringPool::Matches(uint32_t id, const char * data, size_t length) const
+{
+    return (Length(id) == length) && (memcmp(Data(id), data, length) == 0);
+}
+
+uint32_t StringPool::Intern(const char * data, size_t length)
+{
+    if (length == 0)
+        return Empty;
+    if (length > MaxLength)
+        length = MaxLength;
+
+    size_t mask = _slots.size() - 1;
+    size_t slot = Hash(data, length) & mask;
+    while (_slots[slot] != 0)
+    {
+        if (Matches(_slots[slot], data, length))
+            return _slots[slot];
+        slot = (slot + 1) & mask;
+    }
+
+    uint32_t id = static_cast<uint32_t>(_data.size());
+    _data.push_back(static_cast<char>(length & 0xFF));
+    _data.push_back(static_cast<char>(length >> 8));
+    _data.insert(_data.end(), data, data + length);
+    _data.push_back('\0');
+    _slots[slot] = id;
+    ++_count;
+
+    // Keep the load factor below one half
+    if (_count * 2 > _slots.size())
+        Rehash(_slots.size() * 2);
+    return id;
+}
+
+void StringPool::Rehash(size_t slotCount)
+{
+    vector<uint32_t> slots(slotCount, 0);
+    size_t mask = slotCount - 1;
+    for (uint32_t id : _slots)
+    {
+        if (id == 0)
+            continue;
+        size_t slot = Hash(Data(id), Length(id)) & mask;
+        while (slots[slot] != 0)
+            slot = (slot + 1) & mask;
+        slots[slot] = id;
+    }
+    _slots.swap(slots);
+}
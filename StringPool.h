@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read-only view on StringPool entries, either in a pool or in a mapped EPG snapshot.
+// Ids outside the table (from a damaged snapshot) give the empty string.
+struct StringTable
+{
+    const char * data;
+    size_t size;
+
+    size_t Length(uint32_t id) const
+    {
+        if (uint64_t(id) + sizeof(uint16_t) > size)
+            return 0;
+        size_t length = static_cast<uint8_t>(data[id]) | (static_cast<size_t>(static_cast<uint8_t>(data[id + 1])) << 8);
+        return (id + sizeof(uint16_t) + length <= size) ? length : 0;
+    }
+    const char * Data(uint32_t id) const
+    {
+        return (uint64_t(id) + sizeof(uint16_t) <= size) ? data + id + sizeof(uint16_t) : "";
+    }
+    std::string Get(uint32_t id) const { return std::string(Data(id), Length(id)); }
+};
+
+// Append-only arena of interned strings. Every distinct string is stored once and referred to by a 32 bit id
+// (its offset in the arena), so repeated titles across a 7 day schedule cost 4 bytes per event.
+// Entries are laid out as a 16 bit length, the bytes and a terminating zero. Id 0 is the empty string.
+class StringPool
+{
+public:
+    static const uint32_t Empty = 0;
+    static const size_t MaxLength = 0xFFFF;
+
+    StringPool();
+
+    // Returns the id of the string, adding it if it is not in the pool yet. Longer strings are cut at MaxLength.
+    uint32_t Intern(const char * data, size_t length);
+    uint32_t Intern(const std::string & text) { return Intern(text.data(), text.size()); }
+
+    const char * Data(uint32_t id) const { return _data.data() + id + sizeof(uint16_t); }
+    size_t Length(uint32_t id) const
+    {
+        return static_cast<uint8_t>(_data[id]) | (static_cast<size_t>(static_cast<uint8_t>(_data[id + 1])) << 8);
+    }
+    std::string Get(uint32_t id) const { return std::string(Data(id), Length(id)); }
+
+    // The entries as one block, as written to an EPG snapshot; ids are offsets into it
+    const char * RawData() const { return _data.data(); }
+    // Only valid until the next Intern
+    StringTable Table() const { return StringTable { _data.data(), _data.size() }; }
+
+    size_t Count() const { return _count; }
+    size_t Bytes() const { return _data.size(); }
+    size_t MemoryUsage() const { return _data.capacity() + _slots.capacity() * sizeof(uint32_t); }
+
+private:
+    static uint32_t Hash(const char * data, size_t length);
+
+    bool Matches(uint32_t id, const char * data, size_t length) const;
+    void Rehash(size_t slotCount);
+
+    std::vector<char> _data;
+    // Open addressing table of ids, 0 marks an unused slot
+    std::vector<uint32_t> _slots;
+    size_t _count;
+};
@@ -0,0 +1,311 @@
+#include "SubscriptionManager.h"
+
+#include "Crc32.h"
+#include "Descriptors.h"
+#include "DvbText.h"
+#include "PidDispatcher.h"
+#include "Section.h"
+#include "SectionFilter.h"
+
+using namespace std;
+
+namespace {
+
+const uint8_t ProgramMapTableId = 0x02;
+const uint8_t ServiceDescriptionActual = 0x42;
+const uint8_t ServiceDescriptionOther = 0x46;
+// PCR_PID and program_info_length after the long header
+const size_t PMTHeaderSize = SectionHeader::LongHeaderSize + 4;
+// stream_type, elementary_PID and ES_info_length
+const size_t StreamHeaderSize = 5;
+// original_network_id and a reserved byte after the long header
+const size_t SDTHeaderSize = SectionHeader::LongHeaderSize + 3;
+// service_id, EIT flags, running_status, free_CA_mode and descriptors_loop_length
+const size_t ServiceHeaderSize = 5;
+const size_t DescriptorHeaderSize = 2;
+
+uint16_t Read12(const uint8_t * data)
+{
+    return static_cast<uint16_t>(((data[0] & 0x0F) << 8) | data[1]);
+}
+
+uint16_t Read13(const uint8_t * data)
+{
+    return static_cast<uint16_t>(((data[0] & 0x1F) << 8) | data[1]);
+}
+
+} // namespace
+
+SubscriptionManager::SubscriptionManager(PidDispatcher & dispatcher, ProgramListener & listener)
+    : _dispatcher(dispatcher)
+    , _listener(listener)
+    , _hasPAT(false)
+    , _transportStreamId(0)
+    , _patVersion(0)
+    , _programs()
+    , _pendingLock()
+    , _pending()
+    , _pmtPIDs()
+    , _pmts()
+    , _sdtFilter()
+    , _services()
+    , _sdtTables()
+    , _networkId(-1)
+    , _patVersions()
+    , _programsAdded()
+    , _programsRemoved()
+    , _pmtUpdates()
+    , _sdtUpdates()
+    , _crcErrors()
+{
+}
+
+SubscriptionManager::~SubscriptionManager()
+{
+}
+
+void SubscriptionManager::Start()
+{
+    _sdtFilter.reset(new SectionFilter(static_cast<SectionHandler &>(*this)));
+    _dispatcher.Subscribe(SdtPID, _sdtFilter.get());
+}
+
+bool SubscriptionManager::UpdatePAT(uint16_t transportStreamId, uint8_t version,
+                                    const vector<ProgramEntry> & programs)
+{
+    if (_hasPAT && (transportStreamId == _transportStreamId) && (version == _patVersion))
+        return false;
+    _hasPAT = true;
+    _transportStreamId = transportStreamId;
+    _patVersion = version;
+    _patVersions.Add();
+
+    // Program 0 points at the NIT, not at a PMT
+    map<uint16_t, uint16_t> current;
+    for (const ProgramEntry & program : programs)
+    {
+        if (program.number != 0)
+            current[program.number] = program.pmtPID;
+    }
+    vector<PendingChange> changes;
+    for (const auto & program : _programs)
+    {
+        auto position = current.find(program.first);
+        if ((position != current.end()) && (position->second == program.second))
+            continue;
+        changes.push_back(PendingChange { program.second, program.first, false });
+        if (position == current.end())
+        {
+            _listener.OnProgramRemoved(program.first);
+            _programsRemoved.Add();
+        }
+    }
+    for (const auto & program : current)
+    {
+        auto position = _programs.find(program.first);
+        if ((position != _programs.end()) && (position->second == program.second))
+            continue;
+        changes.push_back(PendingChange { program.second, program.first, true });
+        if (position == _programs.end())
+        {
+            _listener.OnProgramAdded(program.first);
+            _programsAdded.Add();
+        }
+    }
+    _programs.swap(current);
+
+    lock_guard<mutex> guard(_pendingLock);
+    _pending.insert(_pending.end(), changes.begin(), changes.end());
+    return true;
+}
+
+void SubscriptionManager::SetNetworkId(uint16_t networkId)
+{
+    _networkId.store(networkId, memory_order_relaxed);
+}
+
+void SubscriptionManager::ApplyPending()
+{
+    vector<PendingChange> changes;
+    {
+        lock_guard<mutex> guard(_pendingLock);
+        if (_pending.empty())
+            return;
+        changes.swap(_pending);
+    }
+    for (const PendingChange & change : changes)
+    {
+        auto position = _pmtPIDs.find(change.pid);
+        if (change.subscribe)
+        {
+            _pmts[change.programNumber] = PmtInfo { false, 0, 0, 0 };
+            if (position != _pmtPIDs.end())
+            {
+                ++position->second.programs;
+                continue;
+            }
+            // A PID that is already decoded as something else is left alone
+            PmtPID & pmtPID = _pmtPIDs[change.pid];
+            pmtPID.programs = 1;
+            if (!_dispatcher.IsSubscribed(change.pid))
+            {
+                pmtPID.filter.reset(new SectionFilter(static_cast<SectionHandler &>(*this)));
+                _dispatcher.Subscribe(change.pid, pmtPID.filter.get());
+            }
+            continue;
+        }
+        _pmts.erase(change.programNumber);
+        if ((position == _pmtPIDs.end()) || (--position->second.programs > 0))
+            continue;
+        if (position->second.filter)
+            _dispatcher.Unsubscribe(change.pid);
+        _pmtPIDs.erase(position);
+    }
+}
+
+void SubscriptionManager::Stop()
+{
+    for (const auto & program : _programs)
+        _listener.OnProgramRemoved(program.first);
+    _programs.clear();
+    _pending.clear();
+    for (const auto & pmtPID : _pmtPIDs)
+    {
+        if (pmtPID.second.filter)
+            _dispatcher.Unsubscribe(pmtPID.first);
+    }
+    _pmtPIDs.clear();
+    _pmts.clear();
+    if (_sdtFilter)
+    {
+        _dispatcher.Unsubscribe(SdtPID);
+        _sdtFilter.reset();
+    }
+    _hasPAT = false;
+}
+
+size_t SubscriptionManager::PMTCount() const
+{
+    size_t count = 0;
+    for (const auto & pmt : _pmts)
+    {
+        if (pmt.second.received)
+            ++count;
+    }
+    return count;
+}
+
+const ServiceInfo * SubscriptionManager::FindService(const ServiceKey & key) const
+{
+    auto position = _services.find(key.Packed());
+    return (position == _services.end()) ? nullptr : &position->second;
+}
+
+void SubscriptionManager::OnSection(const uint8_t * section, size_t size)
+{
+    SectionHeader header;
+    if (!SectionHeader::Parse(section, size, header) || !header.currentNext)
+        return;
+    if (!Crc32::Check(section, header.TotalSize()))
+    {
+        _crcErrors.Add();
+        return;
+    }
+    if (header.tableId == ProgramMapTableId)
+        OnPMT(header, section);
+    else if ((header.tableId == ServiceDescriptionActual) || (header.tableId == ServiceDescriptionOther))
+        OnSDT(header, section);
+}
+
+void SubscriptionManager::OnPMT(const SectionHeader & header, const uint8_t * section)
+{
+    size_t size = header.TotalSize();
+    if (size < PMTHeaderSize + SectionHeader::CRCSize)
+        return;
+    uint16_t programNumber = header.extension;
+    // Only programs of the applied PATs; a PMT PID can carry the PMTs of several
+    auto position = _pmts.find(programNumber);
+    if (position == _pmts.end())
+        return;
+    PmtInfo info { true, header.version, Read13(section + 8), 0 };
+    const uint8_t * end = section + size - SectionHeader::CRCSize;
+    const uint8_t * stream = section + PMTHeaderSize + Read12(section + 10);
+    while (stream + StreamHeaderSize <= end)
+    {
+        ++info.streams;
+        stream += StreamHeaderSize + Read12(stream + 3);
+    }
+    position->second = info;
+    _pmtUpdates.Add();
+}
+
+void SubscriptionManager::OnSDT(const SectionHeader & header, const uint8_t * section)
+{
+    size_t size = header.TotalSize();
+    if (size < SDTHeaderSize + SectionHeader::CRCSize)
+        return;
+    uint16_t originalNetworkId = static_cast<uint16_t>((section[8] << 8) | section[9]);
+    const uint8_t * end = section + size - SectionHeader::CRCSize;
+    const uint8_t * service = section + SDTHeaderSize;
+    while (service + ServiceHeaderSize <= end)
+    {
+        uint16_t serviceId = static_cast<uint16_t>((service[0] << 8) | service[1]);
+        const uint8_t * descriptor = service + ServiceHeaderSize;
+        const uint8_t * descriptorsEnd = descriptor + Read12(service + 3);
+        if (descriptorsEnd > end)
+            break;
+        ServiceKey key { originalNetworkId, header.extension, serviceId };
+        ServiceInfo & info = _services[key.Packed()];
+        info.version = header.version;
+        while (descriptor + DescriptorHeaderSize <= descriptorsEnd)
+        {
+            size_t length = descriptor[1];
+            if (descriptor + DescriptorHeaderSize + length > descriptorsEnd)
+                break;
+            ServiceDescriptor serviceDescriptor;
+            if ((DescriptorTag(descriptor[0]) == DescriptorTag::ServiceDescriptor) &&
+                ServiceDescriptor::Parse(descriptor + DescriptorHeaderSize, length, serviceDescriptor))
+            {
+                info.serviceType = serviceDescriptor.serviceType;
+                info.providerName = DvbTextToUtf8(serviceDescriptor.providerName);
+                info.serviceName = DvbTextToUtf8(serviceDescriptor.serviceName);
+            }
+            descriptor += DescriptorHeaderSize + length;
+        }
+        service = descriptorsEnd;
+    }
+    _sdtUpdates.Add();
+
+    // Once every section of a new version is in, the services it no longer lists are gone
+    uint32_t tableKey = (static_cast<uint32_t>(originalNetworkId) << 16) | header.extension;
+    auto inserted = _sdtTables.insert(make_pair(tableKey, SdtTable()));
+    SdtTable & table = inserted.first->second;
+    if (inserted.second || (table.version != header.version))
+    {
+        table.version = header.version;
+        table.sections.reset();
+    }
+    table.lastSection = header.lastSectionNumber;
+    table.sections.set(header.sectionNumber);
+    if (!table.Complete())
+        return;
+    uint64_t first = ServiceKey { originalNetworkId, header.extension, 0 }.Packed();
+    auto position = _services.lower_bound(first);
+    while ((position != _services.end()) && (position->first <= first + 0xFFFF))
+    {
+        if (position->second.version != table.version)
+            position = _services.erase(position);
+        else
+            ++position;
+    }
+}
+
+bool SubscriptionManager::SdtTable::Complete() const
+{
+    for (size_t section = 0; section <= lastSection; ++section)
+    {
+        if (!sections.test(section))
+            return false;
+    }
+    return true;
+}
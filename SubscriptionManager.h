@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "EpgStore.h"
+#include "Metrics.h"
+#include "Section.h"
+#include "SectionAssembler.h"
+
+class PidDispatcher;
+class SectionFilter;
+
+struct ProgramEntry
+{
+    uint16_t number;
+    uint16_t pmtPID;
+};
+
+// Told which programs came and went when a new PAT version was applied, to attach or detach per program decoders
+class ProgramListener
+{
+public:
+    virtual ~ProgramListener() {}
+
+    virtual void OnProgramAdded(uint16_t programNumber) = 0;
+    virtual void OnProgramRemoved(uint16_t programNumber) = 0;
+};
+
+// From the SDT
+struct ServiceInfo
+{
+    uint8_t version;
+    uint8_t serviceType;
+    std::string providerName;
+    std::string serviceName;
+};
+
+// Keeps the subscriptions that follow from the PAT in line with it, so they do not pile up on a long running input.
+// Only a new PAT version (or transport stream) is looked at, and only the programs that came or went are passed on
+// to the ProgramListener. Every PMT PID is subscribed on the dispatcher while a program refers to it, and the PMT
+// and SDT versions are followed through section filters, which drop the repeats. The network_id comes from the NIT
+// actual, as seen in the stream.
+// UpdatePAT may be called from a decoder thread; the dispatcher is only changed on the dispatching thread, in
+// ApplyPending.
+class SubscriptionManager : private SectionHandler
+{
+public:
+    static const uint16_t SdtPID = 0x0011;
+
+    SubscriptionManager(PidDispatcher & dispatcher, ProgramListener & listener);
+    ~SubscriptionManager() override;
+
+    // Subscribes the SDT. Called from Setup.
+    void Start();
+    // Called with every PAT that libdvbpsi decodes. Returns false if the PAT brought nothing new.
+    bool UpdatePAT(uint16_t transportStreamId, uint8_t version, const std::vector<ProgramEntry> & programs);
+    // Called with the network_id of every NIT actual sub_table that turns up
+    void SetNetworkId(uint16_t networkId);
+    // Subscribes and unsubscribes the PMT PIDs of the PAT versions applied since the last call. Only on the
+    // dispatching thread.
+    void ApplyPending();
+    // Removes all programs and subscriptions. Only on the dispatching thread, once it is done.
+    void Stop();
+
+    // Read on the dispatching thread, or once it is done
+    bool HasNetworkId() const { return _networkId.load(std::memory_order_relaxed) >= 0; }
+    uint16_t NetworkId() const { return static_cast<uint16_t>(_networkId.load(std::memory_order_relaxed)); }
+    size_t ProgramCount() const { return _pmts.size(); }
+    size_t PmtPIDCount() const { return _pmtPIDs.size(); }
+    // Programs of which a PMT came in
+    size_t PMTCount() const;
+    const std::map<uint64_t, ServiceInfo> & Services() const { return _services; }
+    const ServiceInfo * FindService(const ServiceKey & key) const;
+    uint64_t PATVersions() const { return _patVersions; }
+    uint64_t ProgramsAdded() const { return _programsAdded; }
+    uint64_t ProgramsRemoved() const { return _programsRemoved; }
+    // PMT and SDT sections that brought something new
+    uint64_t PMTUpdates() const { return _pmtUpdates; }
+    uint64_t SDTUpdates() const { return _sdtUpdates; }
+    uint64_t CRCErrors() const { return _crcErrors; }
+
+private:
+    struct PmtPID
+    {
+        std::unique_ptr<SectionFilter> filter;
+        uint32_t programs;
+    };
+    struct PmtInfo
+    {
+        bool received;
+        uint8_t version;
+        uint16_t pcrPID;
+        uint16_t streams;
+    };
+    struct PendingChange
+    {
+        uint16_t pid;
+        uint16_t programNumber;
+        bool subscribe;
+    };
+    // The sections seen of the current version of an SDT sub_table
+    struct SdtTable
+    {
+        uint8_t version;
+        uint8_t lastSection;
+        std::bitset<256> sections;
+
+        bool Complete() const;
+    };
+
+    SubscriptionManager(const SubscriptionManager &) = delete;
+    SubscriptionManager & operator = (const SubscriptionManager &) = delete;
+
+    // PMT and SDT sections from the filters
+    void OnSection(const uint8_t * section, size_t size) override;
+    void OnPMT(const SectionHeader & header, const uint8_t * section);
+    void OnSDT(const SectionHeader & header, const uint8_t * section);
+
+    PidDispatcher & _dispatcher;
+    ProgramListener & _listener;
+    // Written by the thread that decodes the PAT
+    bool _hasPAT;
+    uint16_t _transportStreamId;
+    uint8_t _patVersion;
+    std::map<uint16_t, uint16_t> _programs;     // program_number to PMT PID
+    std::mutex _pendingLock;
+    std::vector<PendingChange> _pending;
+    // Written by the dispatching thread
+    std::unordered_map<uint16_t, PmtPID> _pmtPIDs;
+    std::unordered_map<uint16_t, PmtInfo> _pmts;    // By program_number, for the programs of the applied PATs
+    std::unique_ptr<SectionFilter> _sdtFilter;
+    std::map<uint64_t, ServiceInfo> _services;      // By ServiceKey::Packed
+    std::map<uint32_t, SdtTable> _sdtTables;        // By original_network_id and transport_stream_id
+    // Written by the thread that decodes the NIT, negative until a NIT actual was seen
+    std::atomic<int32_t> _networkId;
+    Counter _patVersions;
+    Counter _programsAdded;
+    Counter _programsRemoved;
+    Counter _pmtUpdates;
+    Counter _sdtUpdates;
+    Counter _crcErrors;
+};
@@ -0,0 +1,247 @@
+#include "SyncScanner.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DVBEPG_X86_SIMD 1
+#endif
+
+using namespace std;
+
+const char * PacketFormatName(PacketFormat format)
+{
+    switch (format)
+    {
+    case PacketFormat::TS188:   return "188";
+    case PacketFormat::M2TS192: return "192 (M2TS)";
+    case PacketFormat::RS204:   return "204 (RS)";
+    default:                    break;
+    }
+    return "unknown";
+}
+
+size_t PacketStride(PacketFormat format)
+{
+    switch (format)
+    {
+    case PacketFormat::M2TS192: return 192;
+    case PacketFormat::RS204:   return 204;
+    default:                    break;
+    }
+    return 188;
+}
+
+bool ParsePacketFormat(const char * text, PacketFormat & format)
+{
+    if (strcmp(text, "auto") == 0)
+        format = PacketFormat::Unknown;
+    else if (strcmp(text, "188") == 0)
+        format = PacketFormat::TS188;
+    else if (strcmp(text, "192") == 0)
+        format = PacketFormat::M2TS192;
+    else if (strcmp(text, "204") == 0)
+        format = PacketFormat::RS204;
+    else
+        return false;
+    return true;
+}
+
+namespace {
+
+// A scan kernel checks all candidate positions in [0, limit) and returns the first one where count packets of the
+// given stride start with a sync byte, or limit if there is none.
+// The caller guarantees that data[limit - 1 + (count - 1) * stride] is readable.
+typedef size_t (* ScanKernel)(const uint8_t * data, size_t limit, size_t stride, size_t count);
+
+bool IsConfirmed(const uint8_t * data, size_t stride, size_t count)
+{
+    for (size_t i = 1; i < count; ++i)
+    {
+        if (data[i * stride] != SyncScanner::SyncByte)
+            return false;
+    }
+    return true;
+}
+
+size_t ScanScalar(const uint8_t * data, size_t limit, size_t stride, size_t count)
+{
+    size_t position = 0;
+    while (position < limit)
+    {
+        const void * next = memchr(data + position, SyncScanner::SyncByte, limit - position);
+        if (!next)
+            break;
+        position = static_cast<size_t>(static_cast<const uint8_t *>(next) - data);
+        if (IsConfirmed(data + position, stride, count))
+            return position;
+        ++position;
+    }
+    return limit;
+}
+
+#ifdef DVBEPG_X86_SIMD
+
+size_t ScanSSE2(const uint8_t * data, size_t limit, size_t stride, size_t count)
+{
+    const __m128i sync = _mm_set1_epi8(static_cast<char>(SyncScanner::SyncByte));
+    size_t position = 0;
+    while (position + 16 <= limit)
+    {
+        // Bit i is set if position + i is a sync byte in all count packets
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + position)), sync)));
+        for (size_t i = 1; (mask != 0) && (i < count); ++i)
+        {
+            mask &= static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + position + i * stride)), sync)));
+        }
+        if (mask != 0)
+            return position + static_cast<size_t>(__builtin_ctz(mask));
+        position += 16;
+    }
+    return position + ScanScalar(data + position, limit - position, stride, count);
+}
+
+__attribute__((target("avx2")))
+size_t ScanAVX2(const uint8_t * data, size_t limit, size_t stride, size_t count)
+{
+    const __m256i sync = _mm256_set1_epi8(static_cast<char>(SyncScanner::SyncByte));
+    size_t position = 0;
+    while (position + 32 <= limit)
+    {
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + position)), sync)));
+        for (size_t i = 1; (mask != 0) && (i < count); ++i)
+        {
+            mask &= static_cast<unsigned>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + position + i * stride)), sync)));
+        }
+        if (mask != 0)
+            return position + static_cast<size_t>(__builtin_ctz(mask));
+        position += 32;
+    }
+    return position + ScanSSE2(data + position, limit - position, stride, count);
+}
+
+#endif
+
+struct Kernel
+{
+    ScanKernel scan;
+    const char * name;
+};
+
+Kernel SelectKernel()
+{
+#ifdef DVBEPG_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Kernel { ScanAVX2, "avx2" };
+    if (__builtin_cpu_supports("sse2"))
+        return Kernel { ScanSSE2, "sse2" };
+#endif
+    return Kernel { ScanScalar, "scalar" };
+}
+
+const Kernel & ActiveKernel()
+{
+    static const Kernel kernel = SelectKernel();
+    return kernel;
+}
+
+} // namespace
+
+const uint8_t * SyncScanner::FindSyncByte(const uint8_t * begin, const uint8_t * end)
+{
+    // A confirm count of one reduces the kernel to a plain vectorized byte search
+    size_t size = static_cast<size_t>(end - begin);
+    return begin + ActiveKernel().scan(begin, size, 0, 1);
+}
+
+bool SyncScanner::FindConfirmedSync(const uint8_t * data, size_t size, size_t stride, size_t confirmCount,
+                                    bool endOfData, size_t & offset)
+{
+    if (confirmCount == 0)
+        confirmCount = 1;
+    size_t span = (confirmCount - 1) * stride;
+    size_t limit = (size > span) ? size - span : 0;
+    if (limit > 0)
+    {
+        size_t position = ActiveKernel().scan(data, limit, stride, confirmCount);
+        if (position < limit)
+        {
+            offset = position;
+            return true;
+        }
+    }
+
+    // The remaining candidates do not have enough data behind them for a full confirmation
+    const uint8_t * candidate = FindSyncByte(data + limit, data + size);
+    if (!endOfData)
+    {
+        offset = static_cast<size_t>(candidate - data);
+        return false;
+    }
+    while (candidate < data + size)
+    {
+        size_t position = static_cast<size_t>(candidate - data);
+        size_t available = (size - position - 1) / stride + 1;
+        if (IsConfirmed(candidate, stride, available))
+        {
+            offset = position;
+            return true;
+        }
+        candidate = FindSyncByte(candidate + 1, data + size);
+    }
+    offset = size;
+    return false;
+}
+
+PacketFormat SyncScanner::DetectFormat(const uint8_t * data, size_t size, bool endOfData, size_t & offset)
+{
+    static const PacketFormat Formats[] = { PacketFormat::TS188, PacketFormat::M2TS192, PacketFormat::RS204 };
+
+    // Pick the framing that locks on earliest. A plain 188 byte stream only confirms on a 192 or 204 stride by
+    // accident, so ties are resolved in favour of the first (most common) format.
+    PacketFormat result = PacketFormat::Unknown;
+    size_t bestOffset = size;
+    for (PacketFormat format : Formats)
+    {
+        size_t found;
+        if (FindConfirmedSync(data, size, PacketStride(format), DefaultConfirmCount, false, found) &&
+            (found < bestOffset))
+        {
+            result = format;
+            bestOffset = found;
+        }
+    }
+    if ((result == PacketFormat::Unknown) && endOfData)
+    {
+        // Too little data for a full confirmation, settle for what fits
+        for (PacketFormat format : Formats)
+        {
+            size_t found;
+            if (FindConfirmedSync(data, size, PacketStride(format), DefaultConfirmCount, true, found) &&
+                (found < bestOffset))
+            {
+                result = format;
+                bestOffset = found;
+            }
+        }
+    }
+    if (result == PacketFormat::Unknown)
+    {
+        // Every position that had room for a confirmation on the widest stride has been rejected
+        size_t span = (DefaultConfirmCount - 1) * PacketStride(PacketFormat::RS204);
+        bestOffset = (size > span) ? size - span : 0;
+        bestOffset = static_cast<size_t>(FindSyncByte(data + bestOffset, data + size) - data);
+    }
+    offset = bestOffset;
+    return result;
+}
+
+const char * SyncScanner::KernelName()
+{
+    return ActiveKernel().name;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Packet framings seen on capture boxes. The 188 byte TS packet is always contiguous,
+// only the distance between sync bytes differs:
+// - 188: plain transport stream
+// - 192: M2TS / BDAV, a 4 byte TP_extra_header (arrival timestamp) precedes every packet
+// - 204: 188 byte packet followed by 16 bytes of Reed-Solomon parity
+enum class PacketFormat : uint8_t
+{
+    Unknown = 0,
+    TS188,
+    M2TS192,
+    RS204,
+};
+
+const char * PacketFormatName(PacketFormat format);
+size_t PacketStride(PacketFormat format);
+bool ParsePacketFormat(const char * text, PacketFormat & format);
+
+class SyncScanner
+{
+public:
+    static const uint8_t SyncByte = 0x47;
+    // Number of consecutive packet boundaries that must carry a sync byte before we lock on
+    static const size_t DefaultConfirmCount = 5;
+    // Bytes needed to detect the framing and confirm it
+    static const size_t DetectionWindow = (DefaultConfirmCount + 1) * 204;
+
+    // Returns a pointer to the first sync byte in [begin, end), or end if there is none.
+    static const uint8_t * FindSyncByte(const uint8_t * begin, const uint8_t * end);
+
+    // Finds the first offset in data at which confirmCount consecutive packets of the given stride all start with
+    // a sync byte. Returns true and sets offset if found. If not found, offset is set to the first position that
+    // could still turn out to be a confirmed sync once more data is available; everything before it can be dropped.
+    // If endOfData is set, candidates near the end are accepted when all boundaries that fit in the data match.
+    static bool FindConfirmedSync(const uint8_t * data, size_t size, size_t stride, size_t confirmCount,
+                                  bool endOfData, size_t & offset);
+
+    // Detects whether data holds 188, 192 or 204 byte packets. Returns PacketFormat::Unknown if no framing
+    // could be confirmed in the given data, otherwise sets offset to the first confirmed packet.
+    static PacketFormat DetectFormat(const uint8_t * data, size_t size, bool endOfData, size_t & offset);
+
+    // Name of the scan kernel selected for this CPU (avx2, sse2 or scalar)
+    static const char * KernelName();
+};
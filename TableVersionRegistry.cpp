@@ -0,0 +1,68 @@
+#include "TableVersionRegistry.h"
+
+#include "Section.h"
+
+using namespace std;
+
+TableVersionRegistry::TableVersionRegistry(Granularity granularity)
+    : _granularity(granularity)
+    , _shards()
+{
+    for (Shard & shard : _shards)
+    {
+        shard.claimed = 0;
+        shard.rejected = 0;
+    }
+}
+
+bool TableVersionRegistry::Claim(const uint8_t * section, size_t size, uint32_t owner)
+{
+    SectionHeader header;
+    if (!SectionHeader::Parse(section, size, header) || !IsEITTableId(header.tableId) ||
+        (size < SectionHeader::LongHeaderSize + 4))
+        return true;
+
+    // table_id, service_id, transport_stream_id and original_network_id identify the sub_table, section_number
+    // the section in it
+    uint64_t key = (uint64_t(header.tableId) << 48) | (uint64_t(header.extension) << 32) |
+                   (uint64_t(section[8]) << 24) | (uint64_t(section[9]) << 16) |
+                   (uint64_t(section[10]) << 8) | section[11];
+    if (_granularity == Granularity::Section)
+        key |= uint64_t(header.sectionNumber) << 56;
+    Shard & shard = _shards[(key ^ (key >> 17) ^ (key >> 35)) % ShardCount];
+    lock_guard<mutex> guard(shard.lock);
+    auto position = shard.claims.find(key);
+    if (position == shard.claims.end())
+    {
+        shard.claims.emplace(key, Entry { owner, header.version });
+        ++shard.claimed;
+        return true;
+    }
+    Entry & entry = position->second;
+    if (IsNewerVersion(header.version, entry.version))
+    {
+        entry = Entry { owner, header.version };
+        ++shard.claimed;
+        return true;
+    }
+    if ((entry.version == header.version) && (entry.owner == owner))
+        return true;
+    ++shard.rejected;
+    return false;
+}
+
+uint64_t TableVersionRegistry::Claimed() const
+{
+    uint64_t result = 0;
+    for (const Shard & shard : _shards)
+        result += shard.claimed;
+    return result;
+}
+
+uint64_t TableVersionRegistry::Rejected() const
+{
+    uint64_t result = 0;
+    for (const Shard & shard : _shards)
+        result += shard.rejected;
+    return result;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// Shared by the parsers of several inputs (muxes of one network), so an EIT sub_table that is broadcast on many
+// of them, as EIT other usually is, is decoded by one parser only.
+// The first parser to see a version of a sub_table claims it; other parsers drop their copies of that version
+// and of older versions. A newer version can be claimed by any parser. Claims are per sub_table when libdvbpsi
+// decodes the EIT, as it only delivers a table once it has all its sections. The native decoder takes sections one
+// by one, so they can be claimed per section, and a parser that only sees part of the carousel (a chunk of a file)
+// does not keep the other sections of a sub_table from being decoded elsewhere.
+class TableVersionRegistry
+{
+public:
+    enum class Granularity
+    {
+        SubTable,
+        Section,
+    };
+
+    explicit TableVersionRegistry(Granularity granularity = Granularity::SubTable);
+
+    // Returns true if the parser identified by owner should decode the EIT section, false if another parser
+    // decodes this version or a newer one. Sections that are not EIT are always decoded.
+    bool Claim(const uint8_t * section, size_t size, uint32_t owner);
+
+    // Only to be read once the parsers are done
+    uint64_t Claimed() const;
+    uint64_t Rejected() const;
+
+private:
+    static const size_t ShardCount = 64;
+
+    struct Entry
+    {
+        uint32_t owner;
+        uint8_t version;
+    };
+    struct Shard
+    {
+        std::mutex lock;
+        std::unordered_map<uint64_t, Entry> claims;
+        uint64_t claimed;
+        uint64_t rejected;
+    };
+
+    TableVersionRegistry(const TableVersionRegistry &) = delete;
+    TableVersionRegistry & operator = (const TableVersionRegistry &) = delete;
+
+    Granularity _granularity;
+    // Sharded by key, so parsers working on different services rarely wait for each other
+    Shard _shards[ShardCount];
+};
@@ -0,0 +1,267 @@
+#include "TransportStreamReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "OutputBuffer.h"
+
+using namespace std;
+
+const char * ReadModeName(ReadMode mode)
+{
+    switch (mode)
+    {
+    case ReadMode::Auto:     return "auto";
+    case ReadMode::Mmap:     return "mmap";
+    case ReadMode::Buffered: return "buffered";
+    }
+    return "unknown";
+}
+
+bool ParseReadMode(const char * text, ReadMode & mode)
+{
+    if (strcmp(text, "auto") == 0)
+        mode = ReadMode::Auto;
+    else if (strcmp(text, "mmap") == 0)
+        mode = ReadMode::Mmap;
+    else if (strcmp(text, "buffered") == 0)
+        mode = ReadMode::Buffered;
+    else
+        return false;
+    return true;
+}
+
+TransportStreamReader::TransportStreamReader(int fileHandle, ReadMode mode, size_t blockSize, PacketFormat format)
+    : _fileHandle(fileHandle)
+    , _mode(mode)
+    , _format(format)
+    , _stride(PacketStride(format))
+    , _data(nullptr)
+    , _size(0)
+    , _offset(0)
+    , _baseOffset(0)
+    , _startOffset(0)
+    , _limit(UINT64_MAX)
+    , _packetOffset(0)
+    , _endOfInput(false)
+    , _atEnd(false)
+    , _mapping(MAP_FAILED)
+    , _mappingSize(0)
+    , _buffer()
+    , _packetsRead(0)
+    , _bytesSkipped(0)
+    , _syncLosses(0)
+    , _startTime(chrono::steady_clock::now())
+    , _endTime()
+{
+    if ((_mode == ReadMode::Auto) || (_mode == ReadMode::Mmap))
+    {
+        if (SetupMapping())
+        {
+            _mode = ReadMode::Mmap;
+            return;
+        }
+        if (_mode == ReadMode::Mmap)
+            cerr << "Cannot map input, falling back to buffered reads" << endl;
+        _mode = ReadMode::Buffered;
+    }
+    // The buffer must hold enough packets to confirm sync, and is kept a whole number of packets for aligned reads
+    if (blockSize < MinimumBlockSize)
+        blockSize = MinimumBlockSize;
+    // Offsets are file offsets, also when reading starts further into the file (pipes cannot tell)
+    off_t position = lseek(_fileHandle, 0, SEEK_CUR);
+    if (position > 0)
+        _baseOffset = _startOffset = static_cast<uint64_t>(position);
+    _buffer.resize(blockSize - (blockSize % PacketSize));
+    _data = _buffer.data();
+}
+
+TransportStreamReader::~TransportStreamReader()
+{
+    if (_mapping != MAP_FAILED)
+        munmap(_mapping, _mappingSize);
+}
+
+bool TransportStreamReader::SetupMapping()
+{
+    struct stat status;
+    if ((fstat(_fileHandle, &status) != 0) || !S_ISREG(status.st_mode) || (status.st_size <= 0))
+        return false;
+    // Map from the current file position, so a caller that already consumed a header still gets the right data
+    off_t position = lseek(_fileHandle, 0, SEEK_CUR);
+    if ((position < 0) || (position >= status.st_size))
+        return false;
+    _mappingSize = static_cast<size_t>(status.st_size);
+    _mapping = mmap(nullptr, _mappingSize, PROT_READ, MAP_PRIVATE, _fileHandle, 0);
+    if (_mapping == MAP_FAILED)
+        return false;
+    madvise(_mapping, _mappingSize, MADV_SEQUENTIAL);
+    _data = static_cast<const uint8_t *>(_mapping);
+    _size = _mappingSize;
+    _offset = static_cast<size_t>(position);
+    _startOffset = static_cast<uint64_t>(position);
+    _endOfInput = true;
+    return true;
+}
+
+bool TransportStreamReader::Fill(size_t bytesNeeded)
+{
+    size_t available = _size - _offset;
+    if (available >= bytesNeeded)
+        return true;
+    if (_endOfInput)
+        return false;
+
+    // Move the unconsumed tail to the front of the buffer, then read until we have what we need.
+    // We do not insist on filling the whole block, so a slow pipe does not stall the parser.
+    if (_offset > 0)
+    {
+        memmove(_buffer.data(), _buffer.data() + _offset, available);
+        _baseOffset += _offset;
+        _offset = 0;
+        _size = available;
+    }
+    while (_size < bytesNeeded)
+    {
+        ssize_t bytesRead = read(_fileHandle, _buffer.data() + _size, _buffer.size() - _size);
+        if (bytesRead < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            cerr << "Read failed: " << strerror(errno) << endl;
+            _endOfInput = true;
+            break;
+        }
+        if (bytesRead == 0)
+        {
+            _endOfInput = true;
+            break;
+        }
+        _size += static_cast<size_t>(bytesRead);
+    }
+    return (_size - _offset) >= bytesNeeded;
+}
+
+void TransportStreamReader::Skip(size_t bytes)
+{
+    _offset += bytes;
+    _bytesSkipped += bytes;
+}
+
+bool TransportStreamReader::DetectFormat()
+{
+    // Only the start of the data is looked at: a mapped file is available whole, and every stride that is not the
+    // real one would otherwise be tried over all of it. The window is widened while nothing locks, which is only
+    // the case with garbage at the start.
+    size_t window = SyncScanner::DetectionWindow;
+    for (;;)
+    {
+        Fill(window);
+        size_t available = _size - _offset;
+        bool lastWindow = _endOfInput && (available <= window);
+        size_t found;
+        _format = SyncScanner::DetectFormat(_data + _offset, min(available, window), lastWindow, found);
+        Skip(found);
+        if (_format != PacketFormat::Unknown)
+        {
+            _stride = PacketStride(_format);
+            return true;
+        }
+        window = min(window * 2, MinimumBlockSize / 2);
+        if (lastWindow)
+        {
+            _format = PacketFormat::TS188;
+            _stride = PacketStride(_format);
+            Skip(_size - _offset);
+            return false;
+        }
+    }
+}
+
+bool TransportStreamReader::Resync()
+{
+    // A single 0x47 is not enough, payloads are full of them. Only lock on when the following packets agree.
+    ++_syncLosses;
+    size_t window = SyncScanner::DefaultConfirmCount * _stride;
+    for (;;)
+    {
+        Fill(window);
+        size_t available = _size - _offset;
+        size_t found;
+        bool locked = SyncScanner::FindConfirmedSync(_data + _offset, available, _stride,
+                                                     SyncScanner::DefaultConfirmCount, _endOfInput, found);
+        Skip(found);
+        if (locked)
+            return true;
+        if (_endOfInput)
+            return false;
+    }
+}
+
+const uint8_t * TransportStreamReader::NextPacket()
+{
+    if ((_format == PacketFormat::Unknown) && !DetectFormat())
+    {
+        _endTime = chrono::steady_clock::now();
+        _atEnd = true;
+        return nullptr;
+    }
+    while (Fill(PacketSize))
+    {
+        // A packet that starts in sync is delivered even if the next boundary is off; the resync starts from
+        // there, on the next call, so the packet before a corrupted stretch is not lost
+        if ((_data[_offset] != PacketHeaderByte) && !Resync())
+            break;
+        // Make sure the whole packet is there after a resync moved us forward
+        if (!Fill(PacketSize))
+            break;
+        // For 192 and 204 byte framing the extra bytes are skipped, the last packet may be cut short in a capture.
+        // Fill may move the buffer contents, so only take the packet pointer afterwards.
+        size_t advance = Fill(_stride) ? _stride : PacketSize;
+        const uint8_t * packet = _data + _offset;
+        _packetOffset = _baseOffset + _offset;
+        if (_packetOffset >= _limit)
+            break;
+        _offset += advance;
+        ++_packetsRead;
+        return packet;
+    }
+    _endTime = chrono::steady_clock::now();
+    _atEnd = true;
+    return nullptr;
+}
+
+bool TransportStreamReader::ReadPacket(uint8_t * buffer)
+{
+    const uint8_t * packet = NextPacket();
+    if (!packet)
+        return false;
+    memcpy(buffer, packet, PacketSize);
+    return true;
+}
+
+double TransportStreamReader::ElapsedSeconds() const
+{
+    chrono::steady_clock::time_point end = (_endTime > _startTime) ? _endTime : chrono::steady_clock::now();
+    return chrono::duration<double>(end - _startTime).count();
+}
+
+double TransportStreamReader::ThroughputMBps() const
+{
+    double elapsed = ElapsedSeconds();
+    if (elapsed <= 0)
+        return 0;
+    return static_cast<double>(BytesConsumed()) / (1000.0 * 1000.0) / elapsed;
+}
+
+void TransportStreamReader::AppendMetrics(OutputBuffer & output) const
+{
+    output.Append(",\"bytes_skipped\":");
+    output.AppendUnsigned(_bytesSkipped);
+    output.Append(",\"sync_losses\":");
+    output.AppendUnsigned(_syncLosses);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "PacketSource.h"
+#include "SyncScanner.h"
+
+enum class ReadMode
+{
+    Auto,       // mmap regular files, fall back to buffered reads for pipes / stdin
+    Mmap,       // map the whole file, warn and fall back to buffered reads if that is not possible
+    Buffered,   // large block reads into a reusable buffer
+};
+
+const char * ReadModeName(ReadMode mode);
+bool ParseReadMode(const char * text, ReadMode & mode);
+
+class TransportStreamReader : public PacketSource
+{
+public:
+    static const size_t PacketSize = 188;
+    static const uint8_t PacketHeaderByte = 0x47;
+    static const size_t DefaultBlockSize = 4 * 1024 * 1024;
+    static const size_t MinimumBlockSize = 64 * 1024;
+
+    // With PacketFormat::Unknown the framing (188, 192 or 204 byte packets) is detected from the data
+    TransportStreamReader(int fileHandle, ReadMode mode = ReadMode::Auto, size_t blockSize = DefaultBlockSize,
+                          PacketFormat format = PacketFormat::Unknown);
+    ~TransportStreamReader() override;
+
+    // Returns a pointer to the next 188 byte packet inside the reader's buffer (or the mapped file), or nullptr at end of input.
+    // The pointer stays valid until the next call. No data is copied.
+    const uint8_t * NextPacket() override;
+    // Copying variant, kept for callers that need their own copy of the packet.
+    bool ReadPacket(uint8_t * buffer);
+    // Ends the input at the first packet that starts at or after this input offset, for scanning a file in chunks.
+    // The input starts at the file position the handle has when the reader is created.
+    void SetLimit(uint64_t limit) { _limit = limit; }
+
+    ReadMode Mode() const { return _mode; }
+    PacketFormat Format() const { return _format; }
+    uint64_t PacketsRead() const override { return _packetsRead; }
+    uint64_t BytesConsumed() const override { return _baseOffset + _offset - _startOffset; }
+    // File offset of the packet NextPacket returned last
+    uint64_t PacketOffset() const { return _packetOffset; }
+    // NextPacket has reached the end of the input
+    bool AtEnd() const { return _atEnd; }
+    uint64_t BytesSkipped() const { return _bytesSkipped; }
+    uint64_t SyncLosses() const { return _syncLosses; }
+    double ElapsedSeconds() const override;
+    double ThroughputMBps() const override;
+    void AppendMetrics(OutputBuffer & output) const override;
+
+private:
+    TransportStreamReader(const TransportStreamReader &) = delete;
+    TransportStreamReader & operator = (const TransportStreamReader &) = delete;
+
+    bool SetupMapping();
+    bool Fill(size_t bytesNeeded);
+    bool DetectFormat();
+    bool Resync();
+    void Skip(size_t bytes);
+
+    int _fileHandle;
+    ReadMode _mode;
+    PacketFormat _format;
+    size_t _stride;
+    const uint8_t * _data;
+    size_t _size;
+    size_t _offset;
+    uint64_t _baseOffset;
+    uint64_t _startOffset;
+    uint64_t _limit;
+    uint64_t _packetOffset;
+    bool _endOfInput;
+    bool _atEnd;
+    void * _mapping;
+    size_t _mappingSize;
+    std::vector<uint8_t> _buffer;
+    uint64_t _packetsRead;
+    uint64_t _bytesSkipped;
+    uint64_t _syncLosses;
+    std::chrono::steady_clock::time_point _startTime;
+    std::chrono::steady_clock::time_point _endTime;
+};
@@ -0,0 +1,294 @@
+#include "UdpReceiver.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "OutputBuffer.h"
+
+using namespace std;
+
+namespace {
+
+const uint8_t PacketHeaderByte = 0x47;
+const size_t RtpHeaderSize = 12;
+const uint8_t RtpVersion2 = 0x80;
+
+// The receive timeout, so Stop and the idle timeout are noticed while no data comes in
+const int PollMilliseconds = 200;
+
+bool IsMulticast(const in_addr & address)
+{
+    return IN_MULTICAST(ntohl(address.s_addr));
+}
+
+} // namespace
+
+bool NetworkAddress::IsNetworkUrl(const char * text)
+{
+    return (strncmp(text, "udp://", 6) == 0) || (strncmp(text, "rtp://", 6) == 0);
+}
+
+bool NetworkAddress::Parse(const char * text, NetworkAddress & address)
+{
+    if (!IsNetworkUrl(text))
+        return false;
+    address.rtp = (strncmp(text, "rtp://", 6) == 0);
+    string rest = text + 6;
+    // VLC style udp://@group:port means the same as udp://group:port
+    if (!rest.empty() && (rest[0] == '@'))
+        rest.erase(0, 1);
+    size_t colon = rest.rfind(':');
+    if (colon == string::npos)
+        return false;
+    address.host = rest.substr(0, colon);
+    char * end = nullptr;
+    unsigned long port = strtoul(rest.c_str() + colon + 1, &end, 10);
+    if ((*end != '\0') || (port == 0) || (port > 65535))
+        return false;
+    address.port = static_cast<uint16_t>(port);
+    in_addr parsed;
+    return address.host.empty() || (inet_pton(AF_INET, address.host.c_str(), &parsed) == 1);
+}
+
+UdpReceiver::UdpReceiver()
+    : _socket(-1)
+    , _rtp(false)
+    , _idleTimeout(0)
+    , _stopped(false)
+    , _buffer(BatchSize * DatagramCapacity)
+    , _messages(BatchSize)
+    , _vectors(BatchSize)
+    , _datagramCount(0)
+    , _currentDatagram(0)
+    , _packet(nullptr)
+    , _packetsEnd(nullptr)
+    , _lastSequenceNumber(-1)
+    , _socketBufferSize(0)
+    , _packetsRead(0)
+    , _datagrams(0)
+    , _rtpDatagrams(0)
+    , _lostDatagrams(0)
+    , _reorderedDatagrams(0)
+    , _malformedDatagrams(0)
+    , _startTime(chrono::steady_clock::now())
+    , _lastReceiveTime(_startTime)
+    , _endTime()
+{
+    for (size_t index = 0; index < BatchSize; ++index)
+    {
+        _vectors[index].iov_base = _buffer.data() + index * DatagramCapacity;
+        _vectors[index].iov_len = DatagramCapacity;
+        memset(&_messages[index], 0, sizeof(mmsghdr));
+        _messages[index].msg_hdr.msg_iov = &_vectors[index];
+        _messages[index].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+UdpReceiver::~UdpReceiver()
+{
+    if (_socket >= 0)
+        close(_socket);
+}
+
+bool UdpReceiver::Open(const NetworkAddress & address, const string & interfaceAddress, int socketBufferSize)
+{
+    _rtp = address.rtp;
+    _socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_socket < 0)
+    {
+        cerr << "Cannot create socket: " << strerror(errno) << endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // At 80 Mbit/s a 16 MiB buffer holds 1.6 s of stream, enough to ride out a scheduling hiccup. Forcing the size
+    // beyond net.core.rmem_max needs CAP_NET_ADMIN, otherwise the kernel caps it.
+    if (setsockopt(_socket, SOL_SOCKET, SO_RCVBUFFORCE, &socketBufferSize, sizeof(socketBufferSize)) != 0)
+        setsockopt(_socket, SOL_SOCKET, SO_RCVBUF, &socketBufferSize, sizeof(socketBufferSize));
+    socklen_t optionLength = sizeof(_socketBufferSize);
+    getsockopt(_socket, SOL_SOCKET, SO_RCVBUF, &_socketBufferSize, &optionLength);
+    if (_socketBufferSize < socketBufferSize)
+        cerr << "Socket receive buffer is " << _socketBufferSize << " bytes instead of " << socketBufferSize
+             << ", raise net.core.rmem_max to avoid losing datagrams" << endl;
+
+    timeval timeout { 0, PollMilliseconds * 1000 };
+    setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    sockaddr_in local {};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(address.port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (!address.host.empty())
+        inet_pton(AF_INET, address.host.c_str(), &local.sin_addr);
+    // Binding to the group address keeps datagrams for other groups on the same port out
+    if (bind(_socket, reinterpret_cast<const sockaddr *>(&local), sizeof(local)) != 0)
+    {
+        cerr << "Cannot bind to " << address.host << ":" << address.port << ": " << strerror(errno) << endl;
+        return false;
+    }
+    if (IsMulticast(local.sin_addr))
+    {
+        ip_mreq request {};
+        request.imr_multiaddr = local.sin_addr;
+        request.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (!interfaceAddress.empty() && (inet_pton(AF_INET, interfaceAddress.c_str(), &request.imr_interface) != 1))
+        {
+            cerr << "Invalid interface address " << interfaceAddress << endl;
+            return false;
+        }
+        if (setsockopt(_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) != 0)
+        {
+            cerr << "Cannot join " << address.host << ": " << strerror(errno) << endl;
+            return false;
+        }
+    }
+    _startTime = chrono::steady_clock::now();
+    _lastReceiveTime = _startTime;
+    return true;
+}
+
+const uint8_t * UdpReceiver::NextPacket()
+{
+    for (;;)
+    {
+        if (_packet < _packetsEnd)
+        {
+            const uint8_t * packet = _packet;
+            _packet += PacketSize;
+            ++_packetsRead;
+            return packet;
+        }
+        if (_currentDatagram + 1 < _datagramCount)
+        {
+            PrepareDatagram(++_currentDatagram);
+            continue;
+        }
+        if (!Receive())
+        {
+            _endTime = chrono::steady_clock::now();
+            return nullptr;
+        }
+    }
+}
+
+bool UdpReceiver::Receive()
+{
+    _datagramCount = 0;
+    while (!_stopped.load(memory_order_relaxed) && (_socket >= 0))
+    {
+        // Wait for the first datagram, then take whatever else is queued up to the batch size
+        int count = recvmmsg(_socket, _messages.data(), BatchSize, MSG_WAITFORONE, nullptr);
+        if (count > 0)
+        {
+            _lastReceiveTime = chrono::steady_clock::now();
+            _datagramCount = static_cast<size_t>(count);
+            _datagrams += _datagramCount;
+            _currentDatagram = 0;
+            PrepareDatagram(0);
+            return true;
+        }
+        if ((count < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+        {
+            cerr << "Receive failed: " << strerror(errno) << endl;
+            return false;
+        }
+        if ((_idleTimeout > 0) &&
+            (chrono::duration<double>(chrono::steady_clock::now() - _lastReceiveTime).count() >= _idleTimeout))
+            return false;
+    }
+    return false;
+}
+
+size_t UdpReceiver::StripRtpHeader(const uint8_t * data, size_t size)
+{
+    if ((size < RtpHeaderSize) || ((data[0] & 0xC0) != RtpVersion2))
+        return 0;
+    size_t headerSize = RtpHeaderSize + 4 * (data[0] & 0x0F);
+    if ((data[0] & 0x10) && (size >= headerSize + 4))
+        headerSize += 4 + 4 * ((data[headerSize + 2] << 8) | data[headerSize + 3]);
+    if (headerSize > size)
+        return 0;
+
+    int sequenceNumber = (data[2] << 8) | data[3];
+    if (_lastSequenceNumber >= 0)
+    {
+        int gap = (sequenceNumber - _lastSequenceNumber - 1) & 0xFFFF;
+        if (gap >= 0x8000)
+        {
+            // Older than the last one: late or duplicate
+            ++_reorderedDatagrams;
+            return headerSize;
+        }
+        _lostDatagrams += static_cast<uint64_t>(gap);
+    }
+    _lastSequenceNumber = sequenceNumber;
+    ++_rtpDatagrams;
+    return headerSize;
+}
+
+void UdpReceiver::PrepareDatagram(size_t index)
+{
+    _packet = _packetsEnd = nullptr;
+    const mmsghdr & message = _messages[index];
+    const uint8_t * data = _buffer.data() + index * DatagramCapacity;
+    size_t size = message.msg_len;
+    if (message.msg_hdr.msg_flags & MSG_TRUNC)
+    {
+        ++_malformedDatagrams;
+        return;
+    }
+    // Plain UDP starts with a sync byte. Anything else that looks like RTP is treated as RTP, also on udp://.
+    size_t offset = 0;
+    if (_rtp || ((size > 0) && (data[0] != PacketHeaderByte)))
+    {
+        offset = StripRtpHeader(data, size);
+        if ((offset > 0) && (data[0] & 0x20))
+        {
+            // Padding, the last byte holds its length
+            size_t padding = data[size - 1];
+            size = (padding <= size - offset) ? size - padding : offset;
+        }
+    }
+    size_t payload = size - offset;
+    if ((payload < PacketSize) || (data[offset] != PacketHeaderByte) || (payload % PacketSize != 0))
+    {
+        ++_malformedDatagrams;
+        payload -= payload % PacketSize;
+        if ((payload == 0) || (data[offset] != PacketHeaderByte))
+            return;
+    }
+    _packet = data + offset;
+    _packetsEnd = _packet + payload;
+}
+
+double UdpReceiver::ElapsedSeconds() const
+{
+    chrono::steady_clock::time_point end = (_endTime > _startTime) ? _endTime : chrono::steady_clock::now();
+    return chrono::duration<double>(end - _startTime).count();
+}
+
+double UdpReceiver::ThroughputMBps() const
+{
+    double elapsed = ElapsedSeconds();
+    if (elapsed <= 0)
+        return 0;
+    return static_cast<double>(BytesConsumed()) / (1000.0 * 1000.0) / elapsed;
+}
+
+void UdpReceiver::AppendMetrics(OutputBuffer & output) const
+{
+    output.Append(",\"datagrams\":");
+    output.AppendUnsigned(_datagrams);
+    output.Append(",\"rtp_datagrams\":");
+    output.AppendUnsigned(_rtpDatagrams);
+    output.Append(",\"lost_datagrams\":");
+    output.AppendUnsigned(_lostDatagrams);
+    output.Append(",\"reordered_datagrams\":");
+    output.AppendUnsigned(_reorderedDatagrams);
+    output.Append(",\"malformed_datagrams\":");
+    output.AppendUnsigned(_malformedDatagrams);
+}
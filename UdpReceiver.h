@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "PacketSource.h"
+
+// Address of a network input: udp://[@]<address>:<port> or rtp://[@]<address>:<port> (IPv4).
+// A multicast address is joined, any other address is bound to; udp://:<port> listens on all addresses.
+struct NetworkAddress
+{
+    bool rtp;
+    std::string host;
+    uint16_t port;
+
+    static bool IsNetworkUrl(const char * text);
+    static bool Parse(const char * text, NetworkAddress & address);
+};
+
+// Live input from UDP or RTP datagrams, typically 7 packets each from an IP headend.
+// Datagrams are received in batches with recvmmsg into one buffer, and NextPacket returns pointers into that
+// buffer, so packets are never copied. RTP headers (also detected on udp:// inputs) are stripped and their
+// sequence numbers checked for lost and reordered datagrams.
+class UdpReceiver : public PacketSource
+{
+public:
+    static const size_t BatchSize = 64;
+    static const size_t DatagramCapacity = 2048;
+    static const size_t PacketSize = 188;
+    static const int DefaultSocketBufferSize = 16 * 1024 * 1024;
+
+    UdpReceiver();
+    ~UdpReceiver() override;
+
+    // interfaceAddress selects the interface to join a multicast group on (default: chosen by the routing table)
+    bool Open(const NetworkAddress & address, const std::string & interfaceAddress = "",
+              int socketBufferSize = DefaultSocketBufferSize);
+    // Without data for this long, the input is considered ended. 0 waits forever.
+    void SetIdleTimeout(double seconds) { _idleTimeout = seconds; }
+    // Makes NextPacket return nullptr. Safe to call from a signal handler.
+    void Stop() { _stopped.store(true, std::memory_order_relaxed); }
+
+    const uint8_t * NextPacket() override;
+    uint64_t PacketsRead() const override { return _packetsRead; }
+    uint64_t BytesConsumed() const override { return _packetsRead * PacketSize; }
+    double ElapsedSeconds() const override;
+    double ThroughputMBps() const override;
+    void AppendMetrics(OutputBuffer & output) const override;
+
+    uint64_t Datagrams() const { return _datagrams; }
+    uint64_t RtpDatagrams() const { return _rtpDatagrams; }
+    // Datagrams missing according to the RTP sequence numbers
+    uint64_t LostDatagrams() const { return _lostDatagrams; }
+    uint64_t ReorderedDatagrams() const { return _reorderedDatagrams; }
+    // Datagrams that did not hold whole transport stream packets, or were too big for the buffer
+    uint64_t MalformedDatagrams() const { return _malformedDatagrams; }
+    int SocketBufferSize() const { return _socketBufferSize; }
+
+private:
+    UdpReceiver(const UdpReceiver &) = delete;
+    UdpReceiver & operator = (const UdpReceiver &) = delete;
+
+    bool Receive();
+    void PrepareDatagram(size_t index);
+    size_t StripRtpHeader(const uint8_t * data, size_t size);
+
+    int _socket;
+    bool _rtp;
+    double _idleTimeout;
+    std::atomic<bool> _stopped;
+    std::vector<uint8_t> _buffer;
+    std::vector<mmsghdr> _messages;
+    std::vector<iovec> _vectors;
+    size_t _datagramCount;
+    size_t _currentDatagram;
+    const uint8_t * _packet;
+    const uint8_t * _packetsEnd;
+    int _lastSequenceNumber;
+    int _socketBufferSize;
+    uint64_t _packetsRead;
+    uint64_t _datagrams;
+    uint64_t _rtpDatagrams;
+    uint64_t _lostDatagrams;
+    uint64_t _reorderedDatagrams;
+    uint64_t _malformedDatagrams;
+    std::chrono::steady_clock::time_point _startTime;
+    std::chrono::steady_clock::time_point _lastReceiveTime;
+    std::chrono::steady_clock::time_point _endTime;
+};
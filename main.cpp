@@ -1,14 +1,50 @@
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <csignal>
 #include <fcntl.h>
-#include <zconf.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <dvbpsi/dvbpsi.h>
 #include <dvbpsi/descriptor.h>
 #include <dvbpsi/demux.h>
 #include <dvbpsi/eit.h>
 #include <dvbpsi/nit.h>
 #include <dvbpsi/pat.h>
+#include "PidDispatcher.h"
+#include "Descriptors.h"
+#include "ChunkEdges.h"
+#include "DvbText.h"
+#include "EitDecoder.h"
+#include "EitCompleteness.h"
+#include "EpgChangeFeed.h"
+#include "EpgGenreIndex.h"
+#include "EpgSharedMemory.h"
+#include "EpgSink.h"
+#include "EpgSnapshot.h"
+#include "EpgStore.h"
+#include "EpgTextIndex.h"
+#include "EpgTimeIndex.h"
+#include "EpgWindow.h"
+#include "Metrics.h"
+#include "Pipeline.h"
+#include "SectionFilter.h"
+#include "SiIndex.h"
+#include "StreamClock.h"
+#include "SubscriptionManager.h"
+#include "TableVersionRegistry.h"
+#include "TransportStreamReader.h"
+#include "UdpReceiver.h"
 
 using namespace std;
 
@@ -54,77 +90,7 @@ enum class SubTable : uint8_t
     EventInformationOtherTSNext = 0x51,
 };
 
-enum class DescriptorTag : uint8_t
-{
-    ShortEventDescriptor = 0x4D,
-    ExtendedEventDescriptor = 0x4E,
-    TimeShiftDescriptor = 0x4F,
-    ComponentDescriptor = 0x50,
-};
-
-enum class StreamContentType : uint8_t
-{
-    Reserved = 0x0,
-    MPEG2Video = 0x1,
-    MPEGAudio = 0x2,
-    DVBSubtitles = 0x3,
-    AC3Audio = 0x4,
-    H264Video = 0x5,
-    HE_AACAudio = 0x6,
-    DTSAudio = 0x7,
-    DVB_SRMData = 0x8,
-    HEVCVideo = 0x9,
-    Reserved2 = 0xA,
-    Reserved3 = 0xB,
-    UserDefined1 = 0xC,
-    UserDefined2 = 0xD,
-    UserDefined3 = 0xE,
-    UserDefined4 = 0xF,
-};
-
-class TransportStreamReader
-{
-public:
-    static const size_t PacketSize = 188;
-    static const uint8_t PacketHeaderByte = 0x47;
-
-    TransportStreamReader(int fileHandle);
-    ~TransportStreamReader() {}
-
-    bool ReadPacket(uint8_t * buffer);
-
-private:
-    int _fileHandle;
-};
-
-TransportStreamReader::TransportStreamReader(int fileHandle)
-    : _fileHandle(fileHandle)
-{
-}
-
-bool TransportStreamReader::ReadPacket(uint8_t * buffer)
-{
-    ssize_t bytesRead = 1;
-    size_t bytesToRead = PacketSize - bytesRead;
-
-    buffer[0] = 0;
-
-    while ((buffer[0] != PacketHeaderByte) && (bytesRead > 0))
-    {
-        bytesRead = read(_fileHandle, buffer, 1);
-    }
-
-    while ((bytesToRead != 0) && (bytesRead > 0))
-    {
-        bytesRead = read(_fileHandle, buffer + 188 - bytesToRead, bytesToRead);
-        if (bytesRead >= 0)
-            bytesToRead -= bytesRead;
-    }
-
-    return (bytesToRead == 0);
-}
-
-class PATListener
+class PATListener : public PacketSink
 {
 public:
     PATListener()
@@ -138,18 +104,18 @@ public:
         _handle = dvbpsi_new(messageCallback, level);
         if (!_handle)
         {
-            cerr << "Cannot initialize DVBPSI for PAT" << endl;
+            cerr << "Cannot initialize DVBPSI for PAT" << '\n';
             return false;
         }
         else
-            cout << "DVBPSI for PAT initialized" << endl;
+            cout << "DVBPSI for PAT initialized" << '\n';
         if (!dvbpsi_pat_attach(_handle, patCallback, this))
         {
-            cerr << "Failed to attach PAT handler" << endl;
+            cerr << "Failed to attach PAT handler" << '\n';
             return false;
         }
         else
-            cout << "Attached PAT handler" << endl;
+            cout << "Attached PAT handler" << '\n';
         return true;
     }
     void Cleanup()
@@ -157,21 +123,29 @@ public:
         if (_handle)
         {
             dvbpsi_pat_detach(_handle);
-            cout << "Detached PAT handler" << endl;
+            cout << "Detached PAT handler" << '\n';
             dvbpsi_delete(_handle);
-            cout << "DVBPSI for PAT deinitialized" << endl;
+            cout << "DVBPSI for PAT deinitialized" << '\n';
         }
     }
-    void PushData(uint8_t * data)
+    void PushPacket(const uint8_t * data) override
     {
-        dvbpsi_packet_push(_handle, data);
+        // libdvbpsi only reads the packet, so handing it the reader's (possibly read-only mapped) buffer is safe
+        dvbpsi_packet_push(_handle, const_cast<uint8_t *>(data));
+    }
+    // Used by the pipeline. Attaching handlers can happen from another decoder thread, so lock the handle.
+    void PushPackets(const uint8_t * data, size_t count) override
+    {
+        lock_guard<mutex> lock(_lock);
+        PacketSink::PushPackets(data, count);
     }
 
 private:
     dvbpsi_t * _handle;
+    mutex _lock;
 };
 
-class NITListener
+class NITListener : public PacketSink
 {
 public:
     NITListener()
@@ -182,50 +156,65 @@ public:
     {
         if (_handle)
             dvbpsi_delete(_handle);
-        _handle = dvbpsi_new(messageCallback, DVBPSI_MSG_DEBUG);
+        _handle = dvbpsi_new(messageCallback, level);
         if (!_handle)
         {
-            cerr << "Cannot initialize DVBPSI for NIT" << endl;
+            cerr << "Cannot initialize DVBPSI for NIT" << '\n';
             return false;
         }
         else
-            cout << "DVBPSI for NIT initialized" << endl;
+            cout << "DVBPSI for NIT initialized" << '\n';
         if (!dvbpsi_AttachDemux(_handle, demuxCallback, this))
         {
-            cerr << "Failed to attach Demux handler" << endl;
+            cerr << "Failed to attach Demux handler" << '\n';
             return false;
         }
         else
-            cout << "Attached Demux handler" << endl;
+            cout << "Attached Demux handler" << '\n';
         return true;
     }
-    bool AttachNITHandler(uint8_t table, uint8_t program, dvbpsi_nit_callback callback, void * callbackData)
+    // Called from the demux callback, for a NIT sub_table that has no handler yet. That runs inside
+    // dvbpsi_packet_push, on the thread decoding the NIT, which already holds the handle.
+    bool AttachNITHandler(uint8_t table, uint16_t networkId, dvbpsi_nit_callback callback, void * callbackData)
     {
-        return dvbpsi_nit_attach(_handle, table, program, callback, callbackData);
+        if (!dvbpsi_nit_attach(_handle, table, networkId, callback, callbackData))
+            return false;
+        _attached.push_back(make_pair(table, networkId));
+        return true;
     }
     void Cleanup()
     {
         if (_handle)
         {
-            // We need to detach all attached handlers
-//            dvbpsi_nit_detach(_handle, uint8_t(SubTable::EventInformationOtherTS), 0);
-//            cout << "Detached NIT handler (other TS)" << endl;
+            for (const auto & subTable : _attached)
+                dvbpsi_nit_detach(_handle, subTable.first, subTable.second);
+            _attached.clear();
             dvbpsi_DetachDemux(_handle);
-            cout << "Detached Demux handler" << endl;
+            cout << "Detached Demux handler" << '\n';
             dvbpsi_delete(_handle);
-            cout << "DVBPSI for NIT deinitialized" << endl;
+            cout << "DVBPSI for NIT deinitialized" << '\n';
         }
     }
-    void PushData(uint8_t * data)
+    void PushPacket(const uint8_t * data) override
+    {
+        // libdvbpsi only reads the packet, so handing it the reader's (possibly read-only mapped) buffer is safe
+        dvbpsi_packet_push(_handle, const_cast<uint8_t *>(data));
+    }
+    // Used by the pipeline. Attaching handlers can happen from another decoder thread, so lock the handle.
+    void PushPackets(const uint8_t * data, size_t count) override
     {
-        dvbpsi_packet_push(_handle, data);
+        lock_guard<mutex> lock(_lock);
+        PacketSink::PushPackets(data, count);
     }
 
 private:
     dvbpsi_t * _handle;
+    mutex _lock;
+    // table_id and network_id of the attached handlers
+    vector<pair<uint8_t, uint16_t>> _attached;
 };
 
-class EITListener
+class EITListener : public PacketSink
 {
 public:
     EITListener()
@@ -236,68 +225,203 @@ public:
     {
         if (_handle)
             dvbpsi_delete(_handle);
-        _handle = dvbpsi_new(messageCallback, DVBPSI_MSG_DEBUG);
+        _handle = dvbpsi_new(messageCallback, level);
         if (!_handle)
         {
-            cerr << "Cannot initialize DVBPSI for EIT" << endl;
+            cerr << "Cannot initialize DVBPSI for EIT" << '\n';
             return false;
         }
         else
-            cout << "DVBPSI for EIT initialized" << endl;
+            cout << "DVBPSI for EIT initialized" << '\n';
         if (!dvbpsi_AttachDemux(_handle, demuxCallback, this))
         {
-            cerr << "Failed to attach Demux handler" << endl;
+            cerr << "Failed to attach Demux handler" << '\n';
             return false;
         }
         else
-            cout << "Attached Demux handler" << endl;
+            cout << "Attached Demux handler" << '\n';
+        return true;
+    }
+    // Attaching and detaching happen on the thread decoding the PAT, so lock the handle
+    bool AttachEITHandler(uint8_t table, uint16_t program, dvbpsi_eit_callback callback, void * callbackData)
+    {
+        lock_guard<mutex> lock(_lock);
+        if (!dvbpsi_eit_attach(_handle, table, program, callback, callbackData))
+            return false;
+        _attached.push_back(make_pair(table, program));
         return true;
     }
-    bool AttachEITHandler(uint8_t table, uint8_t program, dvbpsi_eit_callback callback, void * callbackData)
+    void DetachEITHandler(uint8_t table, uint16_t program)
     {
-        return dvbpsi_eit_attach(_handle, table, program, callback, callbackData);
+        lock_guard<mutex> lock(_lock);
+        for (auto subTable = _attached.begin(); subTable != _attached.end(); ++subTable)
+        {
+            if ((subTable->first == table) && (subTable->second == program))
+            {
+                dvbpsi_eit_detach(_handle, table, program);
+                _attached.erase(subTable);
+                return;
+            }
+        }
     }
     void Cleanup()
     {
         if (_handle)
         {
-            // We need to detach all attached handlers
-//            dvbpsi_eit_detach(_handle, uint8_t(SubTable::EventInformationOtherTS), 0);
-//            cout << "Detached EIT handler (other TS)" << endl;
+            for (const auto & subTable : _attached)
+                dvbpsi_eit_detach(_handle, subTable.first, subTable.second);
+            _attached.clear();
             dvbpsi_DetachDemux(_handle);
-            cout << "Detached Demux handler" << endl;
+            cout << "Detached Demux handler" << '\n';
             dvbpsi_delete(_handle);
-            cout << "DVBPSI for EIT deinitialized" << endl;
+            cout << "DVBPSI for EIT deinitialized" << '\n';
         }
     }
-    void PushData(uint8_t * data)
+    void PushPacket(const uint8_t * data) override
     {
-        dvbpsi_packet_push(_handle, data);
+        // libdvbpsi only reads the packet, so handing it the reader's (possibly read-only mapped) buffer is safe
+        dvbpsi_packet_push(_handle, const_cast<uint8_t *>(data));
+    }
+    // Used by the pipeline. Attaching handlers can happen from another decoder thread, so lock the handle.
+    void PushPackets(const uint8_t * data, size_t count) override
+    {
+        lock_guard<mutex> lock(_lock);
+        PacketSink::PushPackets(data, count);
     }
 
 private:
     dvbpsi_t * _handle;
+    mutex _lock;
+    // table_id and service_id of the attached handlers
+    vector<pair<uint8_t, uint16_t>> _attached;
 };
 
-class TransportStreamParser
+class TransportStreamParser : private EitSectionHandler, private ProgramListener
 {
 public:
-    TransportStreamParser(int fileHandle)
+    explicit TransportStreamParser(PacketSource & source, bool pipelined = false)
         : _listenerPAT()
         , _listenerNIT()
         , _listenerEIT()
-        , _reader(fileHandle)
+        , _eitDecoder(*this)
+        , _filterPAT(_listenerPAT)
+        , _filterNIT(_listenerNIT)
+        , _filterEIT(_listenerEIT)
+        , _filterEITSections(static_cast<SectionHandler &>(_eitDecoder))
+        , _clock()
+        , _filterTime(static_cast<SectionHandler &>(_clock))
+        , _window()
+        , _nativeEIT(true)
+        , _eventText()
+        , _useSectionCache(true)
+        , _dispatcher()
+        , _subscriptions(_dispatcher, *this)
+        , _source(source)
+        , _pipeline(pipelined ? new PacketPipeline(cout) : nullptr)
+        , _store()
+        , _changeFeed(nullptr)
+        , _publisher(nullptr)
+        , _eventTracker()
+        , _indexWriter(nullptr)
+        , _chunkEdges(nullptr)
+        , _dumpEIT(false)
+        , _logLevel(DVBPSI_MSG_WARN)
+        , _metricsCallback()
+        , _completeness()
+        , _stopWhenComplete(false)
+        , _timeout(0)
+        , _completeAfter(-1)
+        , _patLatency()
+        , _nitLatency()
+        , _eitLatency()
     {}
     ~TransportStreamParser() {}
 
     void DumpPAT(dvbpsi_pat_t * pat);
     void DumpNIT(dvbpsi_nit_t * nit);
     void DumpEIT(dvbpsi_eit_t * eit);
+    void DumpEIT(const EitSection & section);
+    void StoreEIT(dvbpsi_eit_t * eit);
+
+    // Also dump every decoded EIT table as it comes in, next to storing it
+    void SetDumpEIT(bool dumpEIT) { _dumpEIT = dumpEIT; }
+    // Decode EIT with the in-tree EitDecoder (the default) rather than libdvbpsi. The native decoder handles every EIT
+    // table, present/following and schedule of the actual and other transport streams, section by section.
+    // Must be set before Setup.
+    void SetNativeEIT(bool nativeEIT) { _nativeEIT = nativeEIT; }
+    // Drop repeated sections before they reach the decoders (on by default). Must be set before Setup.
+    void SetUseSectionCache(bool useSectionCache) { _useSectionCache = useSectionCache; }
+    // Level of libdvbpsi messages to report (default warnings). Must be set before Setup.
+    void SetLogLevel(dvbpsi_msg_level_t level) { _logLevel = level; }
+    // Leave EIT tables that the parser of another input decodes to that parser (only with the section cache).
+    // owner identifies this parser's input. Must be set before Setup.
+    void SetTableVersionRegistry(TableVersionRegistry * registry, uint32_t owner)
+    {
+        _filterEIT.SetRegistry(registry, owner);
+        _filterEITSections.SetRegistry(registry, owner);
+    }
+    // Report changes to the EPG through the feed as sections are decoded, removing the events that are no longer
+    // announced. Must be set before Setup.
+    void SetChangeFeed(EpgChangeFeed * feed)
+    {
+        _changeFeed = feed;
+        _store.SetChangeListener(feed);
+        _eventTracker.reset(feed ? new EitEventTracker : nullptr);
+    }
+    // Keep the text index up to date as events are decoded. It takes the store's change listener, so it cannot be
+    // combined with a change feed. Must be set before Setup.
+    void SetTextIndex(EpgTextIndex * index) { _store.SetChangeListener(index); }
+    // Publish the EPG to shared memory as it changes, and once more at the end. Must be set before Setup.
+    void SetPublisher(SharedEpgWriter * publisher) { _publisher = publisher; }
+    // Keep the EPG to a rolling window around the stream time from the TDT/TOT. Must be set before Setup.
+    void SetRetention(const EpgRetention & retention) { _window.reset(new EpgWindow(_store, retention)); }
+    // Pass every packet read to the index writer, to index the SI packets of the input. Must be set before Process.
+    void SetIndexWriter(SiIndexWriter * writer) { _indexWriter = writer; }
+    // Keep the packets at the edges of the input, which is a chunk of a file. Must be set before Process.
+    void SetChunkEdges(ChunkEdges * edges) { _chunkEdges = edges; }
+    // Called from the processing loop when SIGUSR1 asked for metrics
+    void SetMetricsCallback(const function<void()> & callback) { _metricsCallback = callback; }
+    // Track when the selected EIT tables (EitCompleteness::Tables) are complete, and report it once. Needs the
+    // section cache. Must be set before Setup.
+    void TrackCompleteness(unsigned tables)
+    {
+        _completeness.reset(new EitCompleteness(tables));
+        _filterEIT.SetCompleteness(_completeness.get());
+        _filterEITSections.SetCompleteness(_completeness.get());
+    }
+    // Stop reading as soon as the tracked tables are complete
+    void SetStopWhenComplete(bool stopWhenComplete) { _stopWhenComplete = stopWhenComplete; }
+    // Stop reading after this many seconds, 0 for no limit
+    void SetTimeout(double seconds) { _timeout = seconds; }
+    uint64_t SectionCacheHits() const;
+    uint64_t SectionCacheMisses() const;
 
     bool Setup();
     void Process();
     void Cleanup();
 
+    const PacketSource & Source() const { return _source; }
+    PidDispatcher & Dispatcher() { return _dispatcher; }
+    const PidDispatcher & Dispatcher() const { return _dispatcher; }
+    const SubscriptionManager & Subscriptions() const { return _subscriptions; }
+    const StreamClock & Clock() const { return _clock; }
+    const EpgWindow * Window() const { return _window.get(); }
+    EpgStore & Store() { return _store; }
+    const EpgStore & Store() const { return _store; }
+    const SectionFilter & FilterPAT() const { return _filterPAT; }
+    const SectionFilter & FilterNIT() const { return _filterNIT; }
+    const SectionFilter & FilterEIT() const { return _nativeEIT ? _filterEITSections : _filterEIT; }
+    bool UsesNativeEIT() const { return _nativeEIT; }
+    const EitDecoder & NativeEITDecoder() const { return _eitDecoder; }
+    bool UsesSectionCache() const { return _useSectionCache; }
+    const EpgChangeFeed * ChangeFeed() const { return _changeFeed; }
+    const EitCompleteness * Completeness() const { return _completeness.get(); }
+    // Seconds into the input at which the tracked tables were complete, negative if they never were
+    double CompleteAfter() const { return _completeAfter; }
+    const LatencyHistogram & PATLatency() const { return _patLatency; }
+    const LatencyHistogram & NITLatency() const { return _nitLatency; }
+    const LatencyHistogram & EITLatency() const { return _eitLatency; }
+
 private:
 
     static void MessageCallback(dvbpsi_t * handle, const dvbpsi_msg_level_t level, const char * msg);
@@ -308,13 +432,57 @@ private:
                               uint8_t  i_table_id, /*!< table id to attach */
                               uint16_t i_extension,/*!< table extention to attach */
                               void *  callbackData); /*!< pointer to callback data */
+    static void NITDemuxCallback(dvbpsi_t * p_dvbpsi, uint8_t i_table_id, uint16_t i_extension, void * callbackData);
+    void OnEitSection(const EitSection & section) override;
+    // Programs of a new PAT version, from the subscription manager
+    void OnProgramAdded(uint16_t programNumber) override;
+    void OnProgramRemoved(uint16_t programNumber) override;
 
     PATListener _listenerPAT;
     NITListener _listenerNIT;
     EITListener _listenerEIT;
-    TransportStreamReader _reader;
+    EitDecoder _eitDecoder;
+    SectionFilter _filterPAT;
+    SectionFilter _filterNIT;
+    SectionFilter _filterEIT;
+    // Hands new EIT sections to the native decoder
+    SectionFilter _filterEITSections;
+    StreamClock _clock;
+    SectionFilter _filterTime;
+    // Applied on the thread that stores the EIT
+    unique_ptr<EpgWindow> _window;
+    bool _nativeEIT;
+    EventText _eventText;
+    bool _useSectionCache;
+    PidDispatcher _dispatcher;
+    SubscriptionManager _subscriptions;
+    PacketSource & _source;
+    unique_ptr<PacketPipeline> _pipeline;
+    EpgStore _store;
+    EpgChangeFeed * _changeFeed;
+    SharedEpgWriter * _publisher;
+    unique_ptr<EitEventTracker> _eventTracker;
+    SiIndexWriter * _indexWriter;
+    ChunkEdges * _chunkEdges;
+    bool _dumpEIT;
+    dvbpsi_msg_level_t _logLevel;
+    function<void()> _metricsCallback;
+    unique_ptr<EitCompleteness> _completeness;
+    bool _stopWhenComplete;
+    double _timeout;
+    double _completeAfter;
+    // Time spent in the table callbacks, each written by the thread decoding that table
+    LatencyHistogram _patLatency;
+    LatencyHistogram _nitLatency;
+    LatencyHistogram _eitLatency;
 };
 
+// Decoder output goes to a per-thread buffer when running pipelined
+static ostream & Out()
+{
+    return PacketPipeline::Output();
+}
+
 string PrintValue(uint8_t value)
 {
     ostringstream stream;
@@ -334,90 +502,63 @@ string PrintValue(void * value)
     return stream.str();
 }
 
-string GetString(char * data, size_t length, size_t & offset)
+// DVB text converted to UTF-8
+string PrintText(const ByteView & text)
 {
-    string result = string(data + offset, length);
-    offset += length;
-    return result;
+    return DvbTextToUtf8(text);
 }
 
-string GetStringWithCharSet(char * data, size_t length, size_t & offset)
+string PrintLanguage(const uint8_t * language)
 {
-    uint8_t charSet = static_cast<uint8_t>(data[offset]);
-    offset++;
-    string result = GetString(data, length - 1, offset);
-    ostringstream stream;
-    stream << result << " (" << int(charSet) << ")";
-    return stream.str();
+    return string(reinterpret_cast<const char *>(language), 3);
 }
 
-string GetStringWithCharSetAndLength(char * data, size_t & offset)
-{
-    size_t length = static_cast<uint8_t>(data[offset]);
-    offset++;
-    return GetStringWithCharSet(data, length, offset);
-}
-
-string PrintDescriptor(dvbpsi_descriptor_t *descriptor)
+string PrintDescriptor(uint8_t tag, uint8_t length, const uint8_t * data, void * decoded)
 {
     ostringstream stream;
-    stream << "Descriptor" << endl
-           << "  Tag                 " << PrintValue(descriptor->i_tag) << endl
-           << "  Length              " << PrintValue(descriptor->i_length) << endl
-           << "  Data                " << PrintValue(descriptor->p_data) << endl
-           << "  Decoded             " << PrintValue(descriptor->p_decoded) << endl;
-    switch (DescriptorTag(descriptor->i_tag))
+    stream << "Descriptor" << '\n'
+           << "  Tag                 " << PrintValue(tag) << '\n'
+           << "  Length              " << PrintValue(length) << '\n'
+           << "  Data                " << PrintValue(const_cast<uint8_t *>(data)) << '\n'
+           << "  Decoded             " << PrintValue(decoded) << '\n';
+    switch (DescriptorTag(tag))
     {
+    case DescriptorTag::NetworkNameDescriptor:
+        {
+            NetworkNameDescriptor networkName;
+            if (NetworkNameDescriptor::Parse(data, length, networkName))
+                stream << "Network " << PrintText(networkName.name);
+        }
+        break;
     case DescriptorTag::ShortEventDescriptor:
         {
-            char * data = reinterpret_cast<char *>(descriptor->p_data);
-            size_t offset = 0;
-            string languageCodeISO639 = GetString(data, 3, offset);
-            string eventName = GetStringWithCharSetAndLength(data, offset);
-            string text = GetStringWithCharSetAndLength(data, offset);
-            stream << languageCodeISO639 << " " << eventName << ": " << text;
+            ShortEventDescriptor shortEvent;
+            if (ShortEventDescriptor::Parse(data, length, shortEvent))
+                stream << PrintLanguage(shortEvent.language) << " " << PrintText(shortEvent.name) << ": "
+                       << PrintText(shortEvent.text);
         }
         break;
     case DescriptorTag::ExtendedEventDescriptor:
         {
-            char *data = reinterpret_cast<char *>(descriptor->p_data);
+            ExtendedEventDescriptor extendedEvent;
+            if (!ExtendedEventDescriptor::Parse(data, length, extendedEvent))
+                break;
+            stream << PrintValue(extendedEvent.number) << "-" << PrintValue(extendedEvent.lastNumber) << " "
+                   << PrintLanguage(extendedEvent.language) << " ";
             size_t offset = 0;
-            uint8_t descriptorInfo = static_cast<uint8_t>(data[offset]);
-            offset++;
-            uint8_t descriptorNumber = descriptorInfo >> 4;
-            uint8_t descriptorLast = static_cast<uint8_t>(descriptorInfo & 0x0F);
-            string languageCodeISO639 = GetString(data, 3, offset);
-            size_t itemLength = static_cast<size_t >(data[offset]);
-            offset++;
-            stream << PrintValue(descriptorNumber) << "-" << PrintValue(descriptorLast) << " " << languageCodeISO639 << " ";
-            size_t itemsBaseOffset = offset;
-            while (offset < itemsBaseOffset + itemLength)
-            {
-                string itemDescription = GetStringWithCharSetAndLength(data, offset);
-                string item = GetStringWithCharSetAndLength(data, offset);
-                stream << itemDescription << ":" << item << endl;
-            }
-            string text = GetStringWithCharSetAndLength(data, offset);
-            stream << ": " << text;
+            ExtendedEventItem item;
+            while (extendedEvent.NextItem(offset, item))
+                stream << PrintText(item.description) << ":" << PrintText(item.item) << '\n';
+            stream << ": " << PrintText(extendedEvent.text);
         }
         break;
     case DescriptorTag::ComponentDescriptor:
         {
-            char *data = reinterpret_cast<char *>(descriptor->p_data);
-            size_t offset = 0;
-            uint8_t streamContentInfo = static_cast<uint8_t>(data[offset]);
-            offset++;
-            uint8_t componentType =  static_cast<uint8_t>(data[offset]);
-            offset++;
-            uint8_t componentTag =  static_cast<uint8_t>(data[offset]);
-            offset++;
-            uint8_t streamContentExt = streamContentInfo >> 4;
-            uint8_t streamContent = static_cast<uint8_t>(streamContentInfo & 0x0F);
-            string languageCodeISO639 = GetString(data, 3, offset);
-            string text = GetStringWithCharSet(data, descriptor->i_length - offset, offset);
-
+            ComponentDescriptor component;
+            if (!ComponentDescriptor::Parse(data, length, component))
+                break;
             stream << "Content: ";
-            switch (static_cast<StreamContentType>(streamContent))
+            switch (static_cast<StreamContentType>(component.streamContent))
             {
             case StreamContentType ::MPEG2Video:
                 stream << "MPEG2 Video";
@@ -428,9 +569,29 @@ string PrintDescriptor(dvbpsi_descriptor_t *descriptor)
             default:
                 break;
             }
-            stream << " [" << PrintValue(streamContent) << ":" << PrintValue(streamContentExt) << "] "
-                   << "Component " << PrintValue(componentType) << ":" << PrintValue(componentTag) << " "
-                   << languageCodeISO639 << ": " << text;
+            stream << " [" << PrintValue(component.streamContent) << ":" << PrintValue(component.streamContentExt) << "] "
+                   << "Component " << PrintValue(component.componentType) << ":" << PrintValue(component.componentTag) << " "
+                   << PrintLanguage(component.language) << ": " << PrintText(component.text);
+        }
+        break;
+    case DescriptorTag::ContentDescriptor:
+        {
+            ContentDescriptor content;
+            if (!ContentDescriptor::Parse(data, length, content))
+                break;
+            stream << "Genre";
+            for (size_t i = 0; i < content.Count(); ++i)
+                stream << " " << PrintValue(content.Level1(i)) << ":" << PrintValue(content.Level2(i));
+        }
+        break;
+    case DescriptorTag::ParentalRatingDescriptor:
+        {
+            ParentalRatingDescriptor parentalRating;
+            if (!ParentalRatingDescriptor::Parse(data, length, parentalRating))
+                break;
+            stream << "Parental rating";
+            for (size_t i = 0; i < parentalRating.Count(); ++i)
+                stream << " " << PrintLanguage(parentalRating.Country(i)) << ":" << PrintValue(parentalRating.Rating(i));
         }
         break;
     default:
@@ -439,51 +600,56 @@ string PrintDescriptor(dvbpsi_descriptor_t *descriptor)
     return stream.str();
 }
 
+string PrintDescriptor(dvbpsi_descriptor_t * descriptor)
+{
+    return PrintDescriptor(descriptor->i_tag, descriptor->i_length, descriptor->p_data, descriptor->p_decoded);
+}
+
 void TransportStreamParser::DumpPAT(dvbpsi_pat_t * pat)
 {
-    cout << endl << "New PAT" << endl
-         << "  Transport Stream ID : " << PrintValue(pat->i_ts_id) << endl
-         << "  Version number      : " << PrintValue(pat->i_version) << endl
-         << "    | program_number @ [NIT|PMT]_PID" << endl;
+    Out() << '\n' << "New PAT" << '\n'
+         << "  Transport Stream ID : " << PrintValue(pat->i_ts_id) << '\n'
+         << "  Version number      : " << PrintValue(pat->i_version) << '\n'
+         << "    | program_number @ [NIT|PMT]_PID" << '\n';
 
     dvbpsi_pat_program_t * program = pat->p_first_program;
     while (program)
     {
-        cout << "    | " << dec << setw(14) << program->i_number
-             << " @ " << PrintValue(program->i_pid) << endl;
+        Out() << "    | " << dec << setw(14) << program->i_number
+             << " @ " << PrintValue(program->i_pid) << '\n';
         program = program->p_next;
     }
-    cout << "  active              : " << pat->b_current_next << endl;
+    Out() << "  active              : " << pat->b_current_next << '\n';
 }
 
 void TransportStreamParser::DumpNIT(dvbpsi_nit_t * nit)
 {
-    cout << endl << "New NIT" << endl
-         << "  Network ID          : " << PrintValue(nit->i_network_id) << endl
-         << "  Version number      : " << PrintValue(nit->i_version) << endl
-         << "  Table ID            : " << PrintValue(nit->i_table_id) << endl
-         << "  Sub table ID        : " << PrintValue(nit->i_extension) << endl
-         << "    | program_number @ [NIT|PMT]_PID" << endl;
+    Out() << '\n' << "New NIT" << '\n'
+         << "  Network ID          : " << PrintValue(nit->i_network_id) << '\n'
+         << "  Version number      : " << PrintValue(nit->i_version) << '\n'
+         << "  Table ID            : " << PrintValue(nit->i_table_id) << '\n'
+         << "  Sub table ID        : " << PrintValue(nit->i_extension) << '\n'
+         << "    | program_number @ [NIT|PMT]_PID" << '\n';
     dvbpsi_descriptor_t * descriptor = nit->p_first_descriptor;
     while (descriptor)
     {
-        cout << PrintDescriptor(descriptor) << endl;
+        Out() << PrintDescriptor(descriptor) << '\n';
         descriptor = descriptor->p_next;
     }
     dvbpsi_nit_ts_t * ts = nit->p_first_ts;
     while (ts)
     {
-        cout << "Transport stream ID " << PrintValue(ts->i_ts_id)
+        Out() << "Transport stream ID " << PrintValue(ts->i_ts_id)
              << "Orig Network ID     " << PrintValue(ts->i_orig_network_id);
         dvbpsi_descriptor_t * descriptor = ts->p_first_descriptor;
         while (descriptor)
         {
-            cout << PrintDescriptor(descriptor) << endl;
+            Out() << PrintDescriptor(descriptor) << '\n';
             descriptor = descriptor->p_next;
         }
         ts = ts->p_next;
     }
-    cout << "  active              : " << nit->b_current_next << endl;
+    Out() << "  active              : " << nit->b_current_next << '\n';
 }
 
 // si_time - convert DVB-SI time to seconds since 00:00
@@ -531,14 +697,14 @@ string PrintTime(time_t time)
 void TransportStreamParser::DumpEIT(dvbpsi_eit_t * eit)
 {
     dvbpsi_eit_event_t * event = eit->p_first_event;
-    cout << endl << "New EIT" << endl
-         << "  Transport stream ID : " << PrintValue(eit->i_ts_id) << endl
-         << "  Network ID          : " << PrintValue(eit->i_network_id) << endl
-         << "  Version number      : " << PrintValue(eit->i_version) << endl
-         << "  Table ID            : " << PrintValue(eit->i_table_id) << endl
-         << "  Last Table ID       : " << PrintValue(eit->i_last_table_id) << endl
-         << "  Sub Table (Program) : " << PrintValue(eit->i_extension) << endl
-         << "  Last Section Number : " << PrintValue(eit->i_segment_last_section_number) << endl;
+    Out() << '\n' << "New EIT" << '\n'
+         << "  Transport stream ID : " << PrintValue(eit->i_ts_id) << '\n'
+         << "  Network ID          : " << PrintValue(eit->i_network_id) << '\n'
+         << "  Version number      : " << PrintValue(eit->i_version) << '\n'
+         << "  Table ID            : " << PrintValue(eit->i_table_id) << '\n'
+         << "  Last Table ID       : " << PrintValue(eit->i_last_table_id) << '\n'
+         << "  Sub Table (Program) : " << PrintValue(eit->i_extension) << '\n'
+         << "  Last Section Number : " << PrintValue(eit->i_segment_last_section_number) << '\n';
 
     while (event)
     {
@@ -554,22 +720,272 @@ void TransportStreamParser::DumpEIT(dvbpsi_eit_t * eit)
         // 5        service off-air
         // 6 to 7   reserved for future use
 
-        cout << endl << "Event" << endl
-             << "  ID             : " << PrintValue(event->i_event_id) << endl
-             << "  Start          : " << PrintTime(start) << endl
-             << "  End            : " << PrintTime(end) << endl
-             << "  Running Status : " << PrintValue(event->i_running_status) << endl
-             << "  FTA            : " << (event->b_free_ca ? "Y" : "N") << endl
-             << "  NVOD           : " << (event->b_nvod ? "Y" : "N") << endl;
+        Out() << '\n' << "Event" << '\n'
+             << "  ID             : " << PrintValue(event->i_event_id) << '\n'
+             << "  Start          : " << PrintTime(start) << '\n'
+             << "  End            : " << PrintTime(end) << '\n'
+             << "  Running Status : " << PrintValue(event->i_running_status) << '\n'
+             << "  FTA            : " << (event->b_free_ca ? "Y" : "N") << '\n'
+             << "  NVOD           : " << (event->b_nvod ? "Y" : "N") << '\n';
         dvbpsi_descriptor_t * descriptor = event->p_first_descriptor;
         while (descriptor)
         {
-            cout << PrintDescriptor(descriptor) << endl;
+            Out() << PrintDescriptor(descriptor) << '\n';
             descriptor = descriptor->p_next;
         }
         event = event->p_next;
     }
-    cout << "  active              : " << eit->b_current_next << endl;
+    Out() << "  active              : " << eit->b_current_next << '\n';
+}
+
+void TransportStreamParser::DumpEIT(const EitSection & section)
+{
+    Out() << '\n' << "New EIT section" << '\n'
+         << "  Transport stream ID : " << PrintValue(section.transportStreamId) << '\n'
+         << "  Network ID          : " << PrintValue(section.originalNetworkId) << '\n'
+         << "  Version number      : " << PrintValue(section.version) << '\n'
+         << "  Table ID            : " << PrintValue(section.tableId) << '\n'
+         << "  Last Table ID       : " << PrintValue(section.lastTableId) << '\n'
+         << "  Sub Table (Program) : " << PrintValue(section.serviceId) << '\n'
+         << "  Section Number      : " << PrintValue(section.sectionNumber) << '\n'
+         << "  Last Section Number : " << PrintValue(section.segmentLastSectionNumber) << '\n';
+
+    for (size_t index = 0; index < section.eventCount; ++index)
+    {
+        const EitEvent & event = section.events[index];
+        time_t start = event.start;
+        time_t end = start + event.duration;
+        Out() << '\n' << "Event" << '\n'
+             << "  ID             : " << PrintValue(event.eventId) << '\n'
+             << "  Start          : " << PrintTime(start) << '\n'
+             << "  End            : " << PrintTime(end) << '\n'
+             << "  Running Status : " << PrintValue(event.runningStatus) << '\n'
+             << "  FTA            : " << (event.freeCA ? "Y" : "N") << '\n'
+             << "  NVOD           : " << (event.nvod ? "Y" : "N") << '\n';
+        for (size_t descriptor = 0; descriptor < event.descriptorCount; ++descriptor)
+        {
+            const EitDescriptor & eventDescriptor = event.descriptors[descriptor];
+            Out() << PrintDescriptor(eventDescriptor.tag, eventDescriptor.length, eventDescriptor.data, nullptr)
+                  << '\n';
+        }
+    }
+    Out() << "  active              : " << section.currentNext << '\n';
+}
+
+void TransportStreamParser::StoreEIT(dvbpsi_eit_t * eit)
+{
+    ServiceKey key { eit->i_network_id, eit->i_ts_id, eit->i_extension };
+    StringPool & strings = _store.Strings();
+
+    for (dvbpsi_eit_event_t * event = eit->p_first_event; event; event = event->p_next)
+    {
+        EpgEvent record {};
+        record.start = static_cast<uint32_t>(si_date(event->i_start_time));
+        record.duration = static_cast<uint32_t>(si_time(event->i_duration));
+        record.eventId = event->i_event_id;
+        record.tableId = eit->i_table_id;
+        record.version = eit->i_version;
+        record.flags = static_cast<uint8_t>((event->i_running_status & EpgEvent::RunningStatusMask) |
+                                            (event->b_free_ca ? EpgEvent::FreeCAFlag : 0) |
+                                            (event->b_nvod ? EpgEvent::NVODFlag : 0));
+        if (!_store.InWindow(record))
+            continue;
+        _eventText.Clear();
+        for (dvbpsi_descriptor_t * descriptor = event->p_first_descriptor; descriptor; descriptor = descriptor->p_next)
+            AddEventDescriptor(descriptor->i_tag, descriptor->p_data, descriptor->i_length, record, _eventText);
+        record.title = strings.Intern(_eventText.title);
+        record.text = strings.Intern(_eventText.text);
+        record.extendedText = strings.Intern(_eventText.extendedText);
+        _store.Upsert(key, record);
+    }
+    if (_eventTracker)
+    {
+        vector<uint16_t> eventIds;
+        for (dvbpsi_eit_event_t * event = eit->p_first_event; event; event = event->p_next)
+            eventIds.push_back(event->i_event_id);
+        _eventTracker->Update(key, eit->i_table_id, 0, eit->i_version, eventIds.data(), eventIds.size(), _store);
+    }
+    if (_window)
+        _window->Update(_clock.Now());
+    if (_changeFeed)
+        _changeFeed->Flush();
+    if (_publisher)
+        _publisher->Update(_store);
+}
+
+struct GuideQuery
+{
+    bool nowNext;
+    uint32_t nowTime;
+    bool grid;
+    uint32_t gridFrom;
+    uint32_t gridTo;
+    // Words to look up in the titles and texts, nullptr for no search
+    const char * search;
+    // Narrow all down to these level 1 genres (bit per genre) and parental ratings, 0 for all
+    uint16_t genres;
+    uint8_t maxRating;
+
+    bool Any() const { return nowNext || grid || search; }
+    bool Filtered() const { return (genres != 0) || (maxRating != 0); }
+    EpgGenreIndex::Query Filter(uint32_t from, uint32_t to) const
+    {
+        return EpgGenreIndex::Query { genres, maxRating, from, to };
+    }
+};
+
+string PrintServiceKey(const ServiceKey & key)
+{
+    return PrintValue(key.originalNetworkId) + " / " + PrintValue(key.transportStreamId) + " / " +
+           PrintValue(key.serviceId);
+}
+
+// The event a text search found, nullptr if the time index does not hold it
+const EpgEvent * FindMatch(const EpgTimeIndex & index, const EpgTextIndex::Match & match, int & service)
+{
+    service = index.FindService(match.key);
+    if (service < 0)
+        return nullptr;
+    const EpgTimeIndex::Schedule & schedule = index.Service(static_cast<size_t>(service));
+    const EpgEvent * end = schedule.events + schedule.count;
+    const EpgEvent * event = lower_bound(schedule.events, end, match.start,
+                                         [](const EpgEvent & other, uint32_t start) { return other.start < start; });
+    for (; (event != end) && (event->start == match.start); ++event)
+    {
+        if (event->eventId == match.eventId)
+            return event;
+    }
+    return nullptr;
+}
+
+// Answers the now/next, grid and search queries from the time and text indexes instead of printing the whole guide.
+// textIndex is only used for a search, genreIndex for a filtered grid; without it the grid is filtered event by event.
+template<typename StringLookup>
+void RunGuideQuery(const EpgTimeIndex & index, const EpgTextIndex * textIndex, const EpgGenreIndex * genreIndex,
+                   const GuideQuery & query, const StringLookup & strings, ostream & stream)
+{
+    if (query.nowNext)
+    {
+        vector<EpgTimeIndex::NowNext> nowNext;
+        index.GetNowNext(query.nowTime, nowNext);
+        stream << "Now/next at " << PrintTime(query.nowTime) << '\n';
+        EpgGenreIndex::Query filter = query.Filter(0, 0);
+        for (EpgTimeIndex::NowNext & entry : nowNext)
+        {
+            if (entry.now && !EpgGenreIndex::Matches(filter, *entry.now))
+                entry.now = nullptr;
+            if (entry.next && !EpgGenreIndex::Matches(filter, *entry.next))
+                entry.next = nullptr;
+            if (query.Filtered() && !entry.now && !entry.next)
+                continue;
+            stream << "Service " << PrintServiceKey(index.Service(entry.service).key) << '\n';
+            if (entry.now)
+                stream << "  now  " << PrintTime(entry.now->start) << " - " << PrintTime(entry.now->End())
+                       << " " << strings(entry.now->title) << '\n';
+            if (entry.next)
+                stream << "  next " << PrintTime(entry.next->start) << " - " << PrintTime(entry.next->End())
+                       << " " << strings(entry.next->title) << '\n';
+        }
+    }
+    if (query.grid)
+    {
+        vector<EpgTimeIndex::GridEntry> grid;
+        EpgGenreIndex::Query filter = query.Filter(query.gridFrom, query.gridTo);
+        if (query.Filtered() && genreIndex)
+        {
+            // The genre index gives the events in start time order over all services; the grid lists them per
+            // service, which keeps their start time order within a service
+            genreIndex->Find(filter, grid);
+            stable_sort(grid.begin(), grid.end(),
+                        [](const EpgTimeIndex::GridEntry & first, const EpgTimeIndex::GridEntry & second)
+                        { return first.service < second.service; });
+        }
+        else
+        {
+            index.Grid(0, index.ServiceCount(), query.gridFrom, query.gridTo, grid);
+            if (query.Filtered())
+            {
+                grid.erase(remove_if(grid.begin(), grid.end(), [&filter](const EpgTimeIndex::GridEntry & entry)
+                                     { return !EpgGenreIndex::Matches(filter, *entry.event); }),
+                           grid.end());
+            }
+        }
+        stream << "Grid " << PrintTime(query.gridFrom) << " - " << PrintTime(query.gridTo) << ": "
+               << grid.size() << " events" << '\n';
+        for (const EpgTimeIndex::GridEntry & entry : grid)
+        {
+            stream << "  " << PrintServiceKey(index.Service(entry.service).key) << "  "
+                   << PrintTime(entry.event->start) << " - " << PrintTime(entry.event->End()) << " "
+                   << strings(entry.event->title) << '\n';
+        }
+    }
+    if (query.search && textIndex)
+    {
+        vector<EpgTextIndex::Match> matches;
+        textIndex->Search(query.search, matches);
+        vector<EpgTimeIndex::GridEntry> found;
+        EpgGenreIndex::Query filter = query.Filter(0, 0);
+        for (const EpgTextIndex::Match & match : matches)
+        {
+            int service = -1;
+            const EpgEvent * event = FindMatch(index, match, service);
+            if (event && EpgGenreIndex::Matches(filter, *event))
+                found.push_back(EpgTimeIndex::GridEntry { static_cast<uint32_t>(service), event });
+        }
+        stream << "Search \"" << query.search << "\": " << found.size() << " events" << '\n';
+        for (const EpgTimeIndex::GridEntry & entry : found)
+        {
+            stream << "  " << PrintServiceKey(index.Service(entry.service).key) << "  "
+                   << PrintTime(entry.event->start) << " - " << PrintTime(entry.event->End()) << " "
+                   << strings(entry.event->title) << '\n';
+        }
+    }
+}
+
+// Unix time, or "now"
+bool ParseTime(const char * text, uint32_t & time)
+{
+    if (string(text) == "now")
+    {
+        time = static_cast<uint32_t>(::time(nullptr));
+        return true;
+    }
+    char * end = nullptr;
+    unsigned long value = strtoul(text, &end, 10);
+    if ((end == text) || (*end != '\0'))
+        return false;
+    time = static_cast<uint32_t>(value);
+    return true;
+}
+
+// Comma separated genre names or numbers, to a bit per genre
+bool ParseGenres(const char * text, uint16_t & genres)
+{
+    genres = 0;
+    string list = text;
+    size_t begin = 0;
+    while (begin <= list.size())
+    {
+        size_t comma = list.find(',', begin);
+        if (comma == string::npos)
+            comma = list.size();
+        uint8_t genre = 0;
+        if (!ParseContentGenre(list.substr(begin, comma - begin).c_str(), genre))
+            return false;
+        genres |= static_cast<uint16_t>(1u << genre);
+        begin = comma + 1;
+    }
+    return true;
+}
+
+bool ParseTimeRange(const char * text, uint32_t & from, uint32_t & to)
+{
+    string range = text;
+    size_t comma = range.find(',');
+    if (comma == string::npos)
+        return false;
+    return ParseTime(range.substr(0, comma).c_str(), from) && ParseTime(range.substr(comma + 1).c_str(), to) &&
+           (from < to);
 }
 
 void TransportStreamParser::MessageCallback(dvbpsi_t * handle,
@@ -584,54 +1000,56 @@ void TransportStreamParser::MessageCallback(dvbpsi_t * handle,
         default: /* do nothing */
             return;
     }
-    cerr << msg << endl;
+    cerr << msg << '\n';
 }
 
 void TransportStreamParser::PATCallback(void * callbackData, dvbpsi_pat_t * pat)
 {
     TransportStreamParser * pThis = reinterpret_cast<TransportStreamParser *>(callbackData);
+    ScopedLatency latency(pThis->_patLatency);
     pThis->DumpPAT(pat);
 
-    dvbpsi_pat_program_t * program = pat->p_first_program;
-    while (program)
+    // Only a new PAT version changes the subscriptions
+    if (pat->b_current_next)
     {
-        if (!pThis->_listenerEIT.AttachEITHandler(uint8_t(SubTable::EventInformationActualTS), program->i_number, EITCallback, pThis))
-        {
-            cerr << "Failed to attach EIT handler (current, actual TS, for program " << program->i_number << ")" << endl;
-        }
-        else
-            cout << "Attached EIT handler (current, actual TS, for program " << program->i_number << ")" << endl;
-
-        if (!pThis->_listenerEIT.AttachEITHandler(uint8_t(SubTable::EventInformationActualTSNext), program->i_number, EITCallback, pThis))
-        {
-            cerr << "Failed to attach EIT handler (future, actual TS, for program " << program->i_number << ")" << endl;
-        }
-        else
-            cout << "Attached EIT handler (future, actual TS, for program " << program->i_number << ")" << endl;
-
-        if (!pThis->_listenerNIT.AttachNITHandler(uint8_t(SubTable::NetworkInformationActual), 40984, NITCallback, pThis))
-        {
-            cerr << "Failed to attach NIT handler (actual TS, for program " << program->i_number << ")" << endl;
-        }
-        else
-            cout << "Attached NIT handler (actual TS, for program " << program->i_number << ")" << endl;
-
-        if (!pThis->_listenerNIT.AttachNITHandler(uint8_t(SubTable::NetworkInformationOther), 40984, NITCallback, pThis))
-        {
-            cerr << "Failed to attach NIT handler (other TS, for program " << program->i_number << ")" << endl;
-        }
-        else
-            cout << "Attached NIT handler (other TS, for program " << program->i_number << ")" << endl;
-
-        program = program->p_next;
+        vector<ProgramEntry> programs;
+        for (dvbpsi_pat_program_t * program = pat->p_first_program; program; program = program->p_next)
+            programs.push_back(ProgramEntry { program->i_number, program->i_pid });
+        pThis->_subscriptions.UpdatePAT(pat->i_ts_id, pat->i_version, programs);
     }
 
     dvbpsi_pat_delete(pat);
 }
 
+void TransportStreamParser::OnProgramAdded(uint16_t programNumber)
+{
+    // The native EIT decoder takes every EIT section, libdvbpsi needs a handler per service
+    if (_nativeEIT)
+        return;
+    if (!_listenerEIT.AttachEITHandler(uint8_t(SubTable::EventInformationActualTS), programNumber, EITCallback, this))
+        cerr << "Failed to attach EIT handler (current, actual TS, for program " << programNumber << ")" << '\n';
+    else
+        Out() << "Attached EIT handler (current, actual TS, for program " << programNumber << ")" << '\n';
+
+    if (!_listenerEIT.AttachEITHandler(uint8_t(SubTable::EventInformationActualTSNext), programNumber, EITCallback, this))
+        cerr << "Failed to attach EIT handler (future, actual TS, for program " << programNumber << ")" << '\n';
+    else
+        Out() << "Attached EIT handler (future, actual TS, for program " << programNumber << ")" << '\n';
+}
+
+void TransportStreamParser::OnProgramRemoved(uint16_t programNumber)
+{
+    if (_nativeEIT)
+        return;
+    _listenerEIT.DetachEITHandler(uint8_t(SubTable::EventInformationActualTS), programNumber);
+    _listenerEIT.DetachEITHandler(uint8_t(SubTable::EventInformationActualTSNext), programNumber);
+    Out() << "Detached EIT handlers (for program " << programNumber << ")" << '\n';
+}
+
 void TransportStreamParser::NITCallback(void * callbackData, dvbpsi_nit_t * nit)
 {
     TransportStreamParser * pThis = reinterpret_cast<TransportStreamParser *>(callbackData);
+    ScopedLatency latency(pThis->_nitLatency);
     pThis->DumpNIT(nit);
     dvbpsi_nit_delete(nit);
 }
@@ -639,82 +1057,1282 @@ void TransportStreamParser::NITCallback(void * callbackData, dvbpsi_nit_t * nit)
 void TransportStreamParser::EITCallback(void * callbackData, dvbpsi_eit_t * eit)
 {
     TransportStreamParser * pThis = reinterpret_cast<TransportStreamParser *>(callbackData);
-    pThis->DumpEIT(eit);
+    ScopedLatency latency(pThis->_eitLatency);
+    pThis->StoreEIT(eit);
+    if (pThis->_dumpEIT)
+        pThis->DumpEIT(eit);
     dvbpsi_eit_delete(eit);
 }
 
+void TransportStreamParser::OnEitSection(const EitSection & section)
+{
+    ScopedLatency latency(_eitLatency);
+    // Sections for the next version of a table are announced ahead of time; only the current one is kept
+    if (section.currentNext)
+    {
+        StoreEitSection(section, _store, _eventText);
+        if (_eventTracker)
+            _eventTracker->Update(section, _store);
+        if (_window)
+            _window->Update(_clock.Now());
+        if (_changeFeed)
+            _changeFeed->Flush();
+        if (_publisher)
+            _publisher->Update(_store);
+    }
+    if (_dumpEIT)
+        DumpEIT(section);
+}
+
 void TransportStreamParser::DemuxCallback(dvbpsi_t * p_dvbpsi,  /*!< pointer to dvbpsi handle */
                                           uint8_t  i_table_id, /*!< table id to attach */
                                           uint16_t i_extension,/*!< table extention to attach */
                                           void *  callbackData) /*!< pointer to callback data */
 {
     TransportStreamParser * pThis = reinterpret_cast<TransportStreamParser *>(callbackData);
-    cout << endl << "New Demux" << endl
-        << "  Table ID            : " << PrintValue(i_table_id) << endl
-        << "  Sub table ID        : " << PrintValue(i_extension) << endl;
+    Out() << '\n' << "New Demux" << '\n'
+        << "  Table ID            : " << PrintValue(i_table_id) << '\n'
+        << "  Sub table ID        : " << PrintValue(i_extension) << '\n';
+}
+
+// The NIT handlers follow the network_id of the sub_tables in the stream
+void TransportStreamParser::NITDemuxCallback(dvbpsi_t * p_dvbpsi, uint8_t i_table_id, uint16_t i_extension,
+                                             void * callbackData)
+{
+    TransportStreamParser * pThis = reinterpret_cast<TransportStreamParser *>(callbackData);
+    const char * network = nullptr;
+    if (i_table_id == uint8_t(SubTable::NetworkInformationActual))
+    {
+        network = "actual";
+        pThis->_subscriptions.SetNetworkId(i_extension);
+    }
+    else if (i_table_id == uint8_t(SubTable::NetworkInformationOther))
+        network = "other";
+    else
+    {
+        DemuxCallback(p_dvbpsi, i_table_id, i_extension, callbackData);
+        return;
+    }
+    if (!pThis->_listenerNIT.AttachNITHandler(i_table_id, i_extension, NITCallback, pThis))
+        cerr << "Failed to attach NIT handler (" << network << " network " << i_extension << ")" << '\n';
+    else
+        Out() << "Attached NIT handler (" << network << " network " << i_extension << ")" << '\n';
 }
 
 bool TransportStreamParser::Setup()
 {
-    if (!_listenerPAT.Setup(PATCallback, MessageCallback, DVBPSI_MSG_DEBUG))
+    // libdvbpsi only formats and reports messages up to the level it was created with
+    if (!_listenerPAT.Setup(PATCallback, MessageCallback, _logLevel))
         return false;
-    if (!_listenerEIT.Setup(DemuxCallback, MessageCallback, DVBPSI_MSG_DEBUG))
+    if (!_nativeEIT && !_listenerEIT.Setup(DemuxCallback, MessageCallback, _logLevel))
         return false;
-    if (!_listenerNIT.Setup(DemuxCallback, MessageCallback, DVBPSI_MSG_DEBUG))
+    if (!_listenerNIT.Setup(NITDemuxCallback, MessageCallback, _logLevel))
         return false;
+    _subscriptions.Start();
 
+    PacketSink * sinkPAT = &_listenerPAT;
+    PacketSink * sinkNIT = &_listenerNIT;
+    PacketSink * sinkEIT = _nativeEIT ? static_cast<PacketSink *>(&_eitDecoder) : &_listenerEIT;
+    if (_useSectionCache)
+    {
+        sinkPAT = &_filterPAT;
+        sinkNIT = &_filterNIT;
+        sinkEIT = _nativeEIT ? &_filterEITSections : &_filterEIT;
+    }
+    if (_pipeline)
+    {
+        _dispatcher.Subscribe(uint16_t(PID::PAT), _pipeline->AddStage("decode-pat", sinkPAT));
+        _dispatcher.Subscribe(uint16_t(PID::NIT), _pipeline->AddStage("decode-nit", sinkNIT));
+        _dispatcher.Subscribe(uint16_t(PID::EIT), _pipeline->AddStage("decode-eit", sinkEIT));
+        _pipeline->Start();
+    }
+    else
+    {
+        _dispatcher.Subscribe(uint16_t(PID::PAT), sinkPAT);
+        _dispatcher.Subscribe(uint16_t(PID::NIT), sinkNIT);
+        _dispatcher.Subscribe(uint16_t(PID::EIT), sinkEIT);
+    }
+    // The TDT and TOT are decoded on the dispatching thread, they take a few bytes a second
+    _dispatcher.Subscribe(StreamClock::PID, &_filterTime);
     return true;
 }
 
 void TransportStreamParser::Process()
 {
-    size_t packetCounter = 0;
-    uint8_t data[TransportStreamReader::PacketSize];
-    //cout << "Read packet " << packetCounter++ << endl;
-    bool ok = _reader.ReadPacket(data);
-
-    while (ok)
+    // In pipeline mode, partially filled batches are handed over every so many packets, to bound the latency
+    // on live input where SI packets trickle in
+    static const size_t FlushInterval = 65536;
+    // A SIGUSR1 metrics request, EIT completeness and the timeout are checked every so many packets
+    static const size_t PollInterval = 4096;
+    size_t packetsUntilFlush = FlushInterval;
+    size_t packetsUntilPoll = PollInterval;
+    const uint8_t * data = _source.NextPacket();
+
+    while (data)
     {
-        uint16_t pid = ((uint16_t)(data[1] & 0x1f) << 8) + data[2];
-        switch (static_cast<PID>(pid))
+        if (_indexWriter)
+            _indexWriter->AddPacket(data);
+        if (_chunkEdges && _dispatcher.IsSubscribed(PidDispatcher::PacketPID(data)))
+            _chunkEdges->AddPacket(data);
+        _dispatcher.Dispatch(data);
+        if (_pipeline && (--packetsUntilFlush == 0))
         {
-        case PID::PAT:
-            _listenerPAT.PushData(data);
-            break;
-        case PID::NIT:
-            _listenerNIT.PushData(data);
-            break;
-        case PID::EIT:
-            _listenerEIT.PushData(data);
-            break;
-        default:
-            //cout << "Unsupported packet PID: " << PrintValue(pid) << endl;
-            break;
+            _pipeline->Flush();
+            packetsUntilFlush = FlushInterval;
         }
-        //cout << "Read packet " << packetCounter++ << endl;
-        ok = _reader.ReadPacket(data);
+        if (--packetsUntilPoll == 0)
+        {
+            // PMT PIDs of PAT versions decoded since, possibly on the PAT decoder thread
+            _subscriptions.ApplyPending();
+            if (_metricsCallback && TakeMetricsRequest())
+                _metricsCallback();
+            if (_completeness && (_completeAfter < 0) && _completeness->IsComplete())
+            {
+                // Formatted first and written in one go, as parsers of several inputs may report at the same time
+                _completeAfter = _source.ElapsedSeconds();
+                ostringstream report;
+                report << "EIT complete after " << fixed << setprecision(3) << _completeAfter << " s, "
+                       << _source.PacketsRead() << " packets: " << _completeness->SubTables() << " sub-tables\n";
+                cerr << report.str();
+                if (_stopWhenComplete)
+                    break;
+            }
+            if ((_timeout > 0) && (_source.ElapsedSeconds() >= _timeout))
+            {
+                ostringstream report;
+                report << "Stopped reading after " << fixed << setprecision(3) << _source.ElapsedSeconds() << " s\n";
+                cerr << report.str();
+                break;
+            }
+            packetsUntilPoll = PollInterval;
+        }
+        data = _source.NextPacket();
     }
+    if (_pipeline)
+        _pipeline->Stop();
+    _subscriptions.ApplyPending();
+    // What changed since the last publication; the EIT decoder thread has stopped
+    if (_publisher)
+        _publisher->Publish(_store);
+}
+
+uint64_t TransportStreamParser::SectionCacheHits() const
+{
+    return _filterPAT.Cache().Hits() + _filterNIT.Cache().Hits() + FilterEIT().Cache().Hits();
+}
+
+uint64_t TransportStreamParser::SectionCacheMisses() const
+{
+    return _filterPAT.Cache().Misses() + _filterNIT.Cache().Misses() + FilterEIT().Cache().Misses();
 }
 
 void TransportStreamParser::Cleanup()
 {
+    _subscriptions.Stop();
     _listenerPAT.Cleanup();
     _listenerNIT.Cleanup();
     _listenerEIT.Cleanup();
 }
 
-int main(int argc, char * argv[])
+// One line of JSON with the throughput, per PID and per table_id counters and the callback latencies
+void WriteMetrics(const TransportStreamParser & parser, OutputBuffer & output)
+{
+    const PacketSource & source = parser.Source();
+    const PidDispatcher & dispatcher = parser.Dispatcher();
+    double elapsed = source.ElapsedSeconds();
+    output.Append("{\"time\":");
+    output.AppendUnsigned(static_cast<uint64_t>(time(nullptr)));
+    output.Append(",\"elapsed_s\":");
+    output.AppendFixed(elapsed, 6);
+    output.Append(",\"packets\":");
+    output.AppendUnsigned(source.PacketsRead());
+    output.Append(",\"bytes\":");
+    output.AppendUnsigned(source.BytesConsumed());
+    output.Append(",\"packets_per_s\":");
+    output.AppendFixed((elapsed > 0) ? source.PacketsRead() / elapsed : 0, 1);
+    output.Append(",\"mb_per_s\":");
+    output.AppendFixed(source.ThroughputMBps(), 3);
+    source.AppendMetrics(output);
+    output.Append(",\"continuity_errors\":");
+    output.AppendUnsigned(dispatcher.ContinuityErrors());
+    output.Append(",\"transport_errors\":");
+    output.AppendUnsigned(dispatcher.TransportErrors());
+
+    output.Append(",\"pids\":[");
+    bool first = true;
+    for (size_t pid = 0; pid < PidDispatcher::PidCount; ++pid)
+    {
+        const PidDispatcher::Entry & entry = dispatcher[static_cast<uint16_t>(pid)];
+        if (entry.packets == 0)
+            continue;
+        output.Append(first ? "{\"pid\":" : ",{\"pid\":");
+        first = false;
+        output.AppendUnsigned(pid);
+        output.Append(",\"packets\":");
+        output.AppendUnsigned(entry.packets);
+        output.Append(",\"bytes\":");
+        output.AppendUnsigned(entry.packets * PacketSink::PacketSize);
+        output.Append(",\"continuity_errors\":");
+        output.AppendUnsigned((pid == PidDispatcher::NullPID) ? 0 : entry.continuityErrors);
+        output.Append(",\"transport_errors\":");
+        output.AppendUnsigned(entry.transportErrors);
+        output.Append('}');
+    }
+    output.Append(']');
+
+    // Sections that reached the decoders and repeats that were skipped, known when the section cache is used
+    if (parser.UsesSectionCache())
+    {
+        const SectionFilter * filters[] = { &parser.FilterPAT(), &parser.FilterNIT(), &parser.FilterEIT() };
+        output.Append(",\"sections\":[");
+        first = true;
+        for (unsigned tableId = 0; tableId < 256; ++tableId)
+        {
+            uint64_t decoded = 0;
+            uint64_t skipped = 0;
+            for (const SectionFilter * filter : filters)
+            {
+                decoded += filter->Cache().Misses(static_cast<uint8_t>(tableId));
+                skipped += filter->Cache().Hits(static_cast<uint8_t>(tableId));
+            }
+            if ((decoded == 0) && (skipped == 0))
+                continue;
+            output.Append(first ? "{\"table_id\":" : ",{\"table_id\":");
+            first = false;
+            output.AppendUnsigned(tableId);
+            output.Append(",\"decoded\":");
+            output.AppendUnsigned(decoded);
+            output.Append(",\"skipped\":");
+            output.AppendUnsigned(skipped);
+            output.Append('}');
+        }
+        output.Append("],\"section_discontinuities\":");
+        uint64_t discontinuities = 0;
+        for (const SectionFilter * filter : filters)
+            discontinuities += filter->Assembler().Discontinuities();
+        output.AppendUnsigned(discontinuities);
+    }
+
+    if (parser.UsesNativeEIT())
+    {
+        const EitDecoder & decoder = parser.NativeEITDecoder();
+        output.Append(",\"eit_decoder\":{\"sections\":");
+        output.AppendUnsigned(decoder.Sections());
+        output.Append(",\"events\":");
+        output.AppendUnsigned(decoder.Events());
+        output.Append(",\"crc_errors\":");
+        output.AppendUnsigned(decoder.CRCErrors());
+        output.Append(",\"malformed\":");
+        output.AppendUnsigned(decoder.MalformedSections());
+        output.Append('}');
+    }
+
+    if (parser.Clock().Now() != 0)
+    {
+        output.Append(",\"stream_time\":");
+        output.AppendUnsigned(parser.Clock().Now());
+    }
+    if (parser.Window())
+    {
+        const EpgWindow & window = *parser.Window();
+        output.Append(",\"window\":{\"from\":");
+        output.AppendUnsigned(window.From());
+        output.Append(",\"until\":");
+        output.AppendUnsigned(window.Until());
+        output.Append(",\"horizon_s\":");
+        output.AppendUnsigned(window.Horizon());
+        output.Append(",\"evicted\":");
+        output.AppendUnsigned(window.Evicted());
+        output.Append(",\"compactions\":");
+        output.AppendUnsigned(window.Compactions());
+        output.Append(",\"memory_bytes\":");
+        output.AppendUnsigned(window.MemoryUsage());
+        output.Append('}');
+    }
+
+    const SubscriptionManager & subscriptions = parser.Subscriptions();
+    output.Append(",\"subscriptions\":{\"pat_versions\":");
+    output.AppendUnsigned(subscriptions.PATVersions());
+    output.Append(",\"programs\":");
+    output.AppendUnsigned(subscriptions.ProgramCount());
+    output.Append(",\"pmt_pids\":");
+    output.AppendUnsigned(subscriptions.PmtPIDCount());
+    output.Append(",\"pmts\":");
+    output.AppendUnsigned(subscriptions.PMTCount());
+    output.Append(",\"services\":");
+    output.AppendUnsigned(subscriptions.Services().size());
+    output.Append(",\"pmt_updates\":");
+    output.AppendUnsigned(subscriptions.PMTUpdates());
+    output.Append(",\"sdt_updates\":");
+    output.AppendUnsigned(subscriptions.SDTUpdates());
+    output.Append(",\"crc_errors\":");
+    output.AppendUnsigned(subscriptions.CRCErrors());
+    if (subscriptions.HasNetworkId())
+    {
+        output.Append(",\"network_id\":");
+        output.AppendUnsigned(subscriptions.NetworkId());
+    }
+    output.Append('}');
+
+    if (parser.ChangeFeed())
+    {
+        const EpgChangeFeed & feed = *parser.ChangeFeed();
+        output.Append(",\"change_feed\":{\"added\":");
+        output.AppendUnsigned(feed.Added());
+        output.Append(",\"modified\":");
+        output.AppendUnsigned(feed.Modified());
+        output.Append(",\"removed\":");
+        output.AppendUnsigned(feed.Removed());
+        output.Append('}');
+    }
+
+    output.Append(",\"callbacks\":{\"pat\":");
+    parser.PATLatency().AppendJson(output);
+    output.Append(",\"nit\":");
+    parser.NITLatency().AppendJson(output);
+    output.Append(",\"eit\":");
+    parser.EITLatency().AppendJson(output);
+    output.Append("}}\n");
+}
+
+// Appends the metrics to path, or writes them to stderr without a path
+void DumpMetrics(const TransportStreamParser & parser, const char * path)
 {
-    int fileHandle = open(argv[1], 0);
+    int fileHandle = path ? open(path, O_WRONLY | O_CREAT | O_APPEND, 0644) : STDERR_FILENO;
     if (fileHandle < 0)
-        return 1;
+    {
+        cerr << "Cannot open " << path << endl;
+        return;
+    }
+    {
+        // One write per dump, so concurrent readers of the file never see half a line
+        OutputBuffer output(fileHandle, 256 * 1024);
+        WriteMetrics(parser, output);
+    }
+    if (path)
+        close(fileHandle);
+}
+
+bool ParseLogLevel(const char * text, dvbpsi_msg_level_t & level)
+{
+    string value = text;
+    if (value == "none")
+        level = DVBPSI_MSG_NONE;
+    else if (value == "error")
+        level = DVBPSI_MSG_ERROR;
+    else if (value == "warn")
+        level = DVBPSI_MSG_WARN;
+    else if (value == "debug")
+        level = DVBPSI_MSG_DEBUG;
+    else
+        return false;
+    return true;
+}
+
+// Network input has no end of its own; SIGINT and SIGTERM end it, after which the guide is written as usual
+UdpReceiver * stopOnSignal = nullptr;
+
+void StopSignalHandler(int)
+{
+    if (stopOnSignal)
+        stopOnSignal->Stop();
+}
+
+void InstallStopSignalHandler(UdpReceiver & receiver)
+{
+    stopOnSignal = &receiver;
+    struct sigaction action {};
+    action.sa_handler = StopSignalHandler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+void PrintTextIndexSummary(const EpgTextIndex & index, ostream & stream)
+{
+    stream << "Text index holds " << index.EventCount() << " events, " << index.TokenCount() << " tokens, "
+           << index.MemoryUsage() / 1024 << " KiB (" << index.Indexed() << " events indexed, " << index.Unchanged()
+           << " modified with the same text, " << index.Compactions() << " compactions)" << endl;
+}
+
+void PrintPublisherSummary(const SharedEpgWriter & publisher, ostream & stream)
+{
+    stream << "Published the EPG " << publisher.Publications() << " times to shared memory " << publisher.Name()
+           << ", last " << publisher.LastSize() / 1024 << " KiB";
+    if (publisher.Oversized() > 0)
+        stream << ", " << publisher.Oversized() << " times too large to publish";
+    stream << endl;
+}
+
+// The service names of the SDT, for the XMLTV channels
+class SdtServiceNames : public ServiceNames
+{
+public:
+    explicit SdtServiceNames(const SubscriptionManager & subscriptions) : _subscriptions(subscriptions) {}
+
+    string Name(const ServiceKey & key) const override
+    {
+        const ServiceInfo * service = _subscriptions.FindService(key);
+        return service ? service->serviceName : string();
+    }
+
+private:
+    const SubscriptionManager & _subscriptions;
+};
+
+// Answers the query, or writes the whole guide in the output format. textIndex follows the store for a search;
+// names, if there are any, name the services of the guide.
+void WriteGuide(const EpgStore & store, const EpgTextIndex * textIndex, const GuideQuery & query,
+                OutputFormat outputFormat, const ServiceNames * names)
+{
+    if (query.Any())
+    {
+        EpgTimeIndex index;
+        index.Build(store);
+        EpgGenreIndex genreIndex;
+        if (query.grid && query.Filtered())
+            genreIndex.Build(index);
+        const StringPool & strings = store.Strings();
+        RunGuideQuery(index, textIndex, &genreIndex, query, [&strings](uint32_t id) { return strings.Get(id); },
+                      cout);
+    }
+    else
+    {
+        // The guide is written straight to the file handle, after what went through cout
+        cout.flush();
+        OutputBuffer output(STDOUT_FILENO);
+        WriteEpg(store, *CreateEpgSink(outputFormat, output, names));
+    }
+}
+
+// A capture file, read whole or, when it has an up to date SI index, just its SI packets
+struct FileInput
+{
+    unique_ptr<TransportStreamReader> reader;
+    unique_ptr<SiIndexReader> indexReader;
+    // Builds the index during a full read
+    unique_ptr<SiIndexWriter> indexWriter;
+    string indexPath;
+
+    PacketSource & Source() { return indexReader ? static_cast<PacketSource &>(*indexReader) : *reader; }
+};
+
+// With useIndex, reads through the index next to the file if there is a valid one, and builds it otherwise
+void OpenFileInput(int fileHandle, const char * path, ReadMode readMode, size_t blockSize, PacketFormat packetFormat,
+                   bool useIndex, FileInput & input)
+{
+    if (useIndex)
+    {
+        input.indexPath = string(path) + SiIndexSuffix;
+        input.indexReader.reset(new SiIndexReader(fileHandle));
+        if (input.indexReader->Open(input.indexPath))
+            return;
+        input.indexReader.reset();
+    }
+    input.reader.reset(new TransportStreamReader(fileHandle, readMode, blockSize, packetFormat));
+    if (useIndex)
+        input.indexWriter.reset(new SiIndexWriter(*input.reader));
+}
 
-    TransportStreamParser parser(fileHandle);
-    parser.Setup();
-    parser.Process();
-    parser.Cleanup();
+// Writes the index built while reading, if the whole file was read. Returns false if writing failed.
+bool FinishFileInput(FileInput & input, int fileHandle, ostream & report)
+{
+    if (!input.indexWriter || !input.reader->AtEnd())
+        return true;
+    if (!input.indexWriter->Write(input.indexPath, fileHandle))
+        return false;
+    report << "Indexed " << input.indexWriter->PacketCount() << " SI packets in " << input.indexPath << endl;
+    return true;
+}
 
+// Settings that apply to every input when several are processed at once
+struct InputSettings
+{
+    ReadMode readMode;
+    size_t blockSize;
+    PacketFormat packetFormat;
+    bool dumpEIT;
+    bool useSectionCache;
+    dvbpsi_msg_level_t logLevel;
+    bool metrics;
+    const char * metricsPath;
+    bool nativeEIT;
+    unsigned completeTables;        // 0 to not track completeness
+    bool stopWhenComplete;
+    double timeout;
+    bool useIndex;
+    const EpgRetention * retention;     // nullptr to keep every event
+};
+
+// A file, or a byte range of one when a file is scanned in chunks
+struct InputRange
+{
+    const char * path;
+    uint64_t begin;
+    uint64_t end;       // 0 for the whole file
+};
+
+struct InputResult
+{
+    bool opened;
+    EpgStore store;
+    // For a chunk
+    unique_ptr<ChunkEdges> edges;
+};
+
+// Parses one of several inputs on a worker thread. Decoder output is collected and written in one go when the
+// input is done, so the output of inputs does not interleave.
+void ProcessInput(const InputRange & range, uint32_t index, const InputSettings & settings,
+                  TableVersionRegistry & registry, mutex & outputLock, InputResult & result)
+{
+    const char * path = range.path;
+    result.opened = false;
+    int fileHandle = open(path, O_RDONLY);
+    if (fileHandle < 0)
+    {
+        lock_guard<mutex> guard(outputLock);
+        cerr << "Cannot open " << path << endl;
+        return;
+    }
+    result.opened = true;
+    if (range.end != 0)
+        lseek(fileHandle, static_cast<off_t>(range.begin), SEEK_SET);
+    ostringstream output;
+    PacketPipeline::SetThreadOutput(&output);
+    FileInput input;
+    OpenFileInput(fileHandle, path, settings.readMode, settings.blockSize, settings.packetFormat, settings.useIndex,
+                  input);
+    PacketSource & reader = input.Source();
+    if (range.end != 0)
+    {
+        input.reader->SetLimit(range.end);
+        result.edges.reset(new ChunkEdges);
+    }
+    {
+        TransportStreamParser parser(reader);
+        parser.SetIndexWriter(input.indexWriter.get());
+        parser.SetChunkEdges(result.edges.get());
+        parser.SetDumpEIT(settings.dumpEIT);
+        parser.SetUseSectionCache(settings.useSectionCache);
+        parser.SetLogLevel(settings.logLevel);
+        parser.SetNativeEIT(settings.nativeEIT);
+        parser.SetTableVersionRegistry(&registry, index);
+        if (settings.completeTables != 0)
+            parser.TrackCompleteness(settings.completeTables);
+        parser.SetStopWhenComplete(settings.stopWhenComplete);
+        parser.SetTimeout(settings.timeout);
+        if (settings.retention)
+            parser.SetRetention(*settings.retention);
+        parser.Setup();
+        parser.Process();
+        parser.Cleanup();
+        PacketPipeline::SetThreadOutput(nullptr);
+        result.store = move(parser.Store());
+        ostringstream indexReport;
+        FinishFileInput(input, fileHandle, indexReport);
+
+        lock_guard<mutex> guard(outputLock);
+        if (settings.metrics)
+            DumpMetrics(parser, settings.metricsPath);
+        cout << output.str();
+        cerr << path;
+        if (range.end != 0)
+            cerr << " [" << range.begin << ", " << range.end << ")";
+        cerr << ": " << reader.PacketsRead() << " packets in " << fixed << setprecision(3)
+             << reader.ElapsedSeconds() << " s (" << setprecision(1) << reader.ThroughputMBps() << " MB/s), "
+             << result.store.EventCount() << " events for " << result.store.ServiceCount() << " services"
+             << (input.indexReader ? ", through the SI index" : "") << endl
+             << indexReport.str();
+    }
     close(fileHandle);
+}
+
+// Decodes the sections that span the boundaries between chunks, from the packets each chunk kept at its edges.
+// Every boundary gets its own parser, as the packets of different boundaries do not continue each other.
+void StitchChunks(const vector<InputResult> & results, const InputSettings & settings,
+                  TableVersionRegistry & registry, EpgStore & store)
+{
+    size_t packetCount = 0;
+    for (size_t index = 0; index + 1 < results.size(); ++index)
+    {
+        if (!results[index].edges || !results[index + 1].edges)
+            continue;
+        vector<uint8_t> packets;
+        results[index].edges->Stitch(*results[index + 1].edges, packets);
+        packetCount += packets.size() / ChunkEdges::PacketSize;
+        PacketListSource source(packets);
+        TransportStreamParser parser(source);
+        parser.SetDumpEIT(settings.dumpEIT);
+        parser.SetUseSectionCache(settings.useSectionCache);
+        parser.SetLogLevel(settings.logLevel);
+        parser.SetNativeEIT(settings.nativeEIT);
+        parser.SetTableVersionRegistry(&registry, static_cast<uint32_t>(results.size() + index));
+        parser.Setup();
+        parser.Process();
+        parser.Cleanup();
+        store.Merge(parser.Store());
+    }
+    cerr << "Stitched " << packetCount << " packets across " << results.size() - 1 << " chunk boundaries: "
+         << store.EventCount() << " events" << endl;
+}
+
+// Runs one parser per input on a pool of jobs worker threads. An EIT table carried on several inputs (EIT other)
+// is decoded by one parser only, and the EPGs are merged into store in input order, the newer version of an event
+// winning, so the result does not depend on which worker finished first. Returns false if an input failed to open.
+bool ProcessInputs(const vector<InputRange> & inputs, unsigned jobs, const InputSettings & settings,
+                   EpgStore & store)
+{
+    // The native decoder works section by section, so the sections of a sub_table can be left to different inputs
+    TableVersionRegistry registry(settings.nativeEIT ? TableVersionRegistry::Granularity::Section
+                                                     : TableVersionRegistry::Granularity::SubTable);
+    vector<InputResult> results(inputs.size());
+    atomic<size_t> nextInput(0);
+    mutex outputLock;
+    auto worker = [&]()
+    {
+        for (size_t index = nextInput.fetch_add(1); index < inputs.size(); index = nextInput.fetch_add(1))
+            ProcessInput(inputs[index], static_cast<uint32_t>(index), settings, registry, outputLock, results[index]);
+    };
+
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (size_t i = 0; i < min<size_t>(jobs, inputs.size()); ++i)
+        workers.emplace_back(worker);
+    for (thread & workerThread : workers)
+        workerThread.join();
+    EpgStore stitched;
+    if (inputs[0].end != 0)
+        StitchChunks(results, settings, registry, stitched);
+    double processTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    bool allOpened = true;
+    size_t merged = 0;
+    for (InputResult & result : results)
+    {
+        allOpened = allOpened && result.opened;
+        // Taking over the first store as it is would not tell a change listener about its events
+        if ((store.ServiceCount() == 0) && !store.ChangeListener())
+            store = move(result.store);
+        else
+            merged += store.Merge(result.store);
+        result.store.Clear();
+    }
+    merged += store.Merge(stitched);
+    double totalTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    cerr << "Processed " << inputs.size() << ((inputs[0].end != 0) ? " chunks" : " inputs") << " on "
+         << workers.size() << " threads in " << fixed << setprecision(3) << processTime << " s, merged in "
+         << totalTime - processTime << " s (" << merged << " events added or replaced)" << endl
+         << "Decoded " << registry.Claimed() << " EIT table versions, left " << registry.Rejected()
+         << " sections to the input that decoded them" << endl;
+    return allOpened;
+}
+
+// Chunks smaller than this are not worth a thread
+const uint64_t MinimumChunkSize = 16 * 1024 * 1024;
+
+// Splits a file in up to chunks byte ranges. Each chunk starts scanning at the first packet boundary in its range
+// and ends at the first packet starting in the next one.
+bool PlanChunks(const char * path, unsigned chunks, vector<InputRange> & ranges)
+{
+    struct stat status;
+    if ((stat(path, &status) != 0) || !S_ISREG(status.st_mode))
+    {
+        cerr << "Cannot scan " << path << " in chunks, it is not a regular file" << endl;
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(status.st_size);
+    uint64_t count = max<uint64_t>(1, min<uint64_t>(chunks, size / MinimumChunkSize));
+    for (uint64_t index = 0; index < count; ++index)
+        ranges.push_back(InputRange { path, size * index / count, size * (index + 1) / count });
+    return true;
+}
+
+const double DefaultIdleTimeout = 5;
+// Two hours back and eight days ahead: now/next and a full week's schedule
+const EpgRetention DefaultRetention { 2 * 3600, 8 * 24 * 3600, 0 };
+
+void Usage(const char * program)
+{
+    cerr << "Usage: " << program << " [--read-mode=auto|mmap|buffered] [--block-size=<bytes>]" << endl
+         << "       [--packet-size=auto|188|192|204] [--pipeline] [--dump-eit] [--no-section-cache]" << endl
+         << "       [--write-snapshot=<file>] [--now-next[=<time>]] [--grid=<from>,<to>]" << endl
+         << "       [--search=<words>] [--genre=<genres>] [--max-age=<years>]" << endl
+         << "       [--format=text|json|xmltv] [--log-level=none|error|warn|debug] [--metrics[=<file>]]" << endl
+         << "       [--interface=<address>] [--socket-buffer=<bytes>] [--idle-timeout=<s>]" << endl
+         << "       [--eit-decoder=native|dvbpsi] [--complete[=<tables>]] [--stop-when-complete] [--timeout=<s>]" << endl
+         << "       [--window=<hours before>,<hours after>] [--max-memory=<MiB>]" << endl
+         << "       [--shared-memory=<name>] [--changes] [--index] [--chunks=<count>] [--jobs=<count>]" << endl
+         << "       <file|-|udp://[@]<address>:<port>|rtp://[@]<address>:<port>> [<file>...]" << endl
+         << "       " << program << " [--now-next[=<time>]] [--grid=<from>,<to>] [--search=<words>]" << endl
+         << "       [--genre=<genres>] [--max-age=<years>] [--format=text|json|xmltv]" << endl
+         << "       --snapshot=<file>|--from-shared-memory=<name>" << endl
+         << "  --read-mode   auto maps regular files and streams pipes (default auto)" << endl
+         << "  --block-size  read block size for buffered mode (default "
+         << TransportStreamReader::DefaultBlockSize << ")" << endl
+         << "  --packet-size 188 (TS), 192 (M2TS) or 204 (Reed-Solomon) byte framing (default auto)" << endl
+         << "  --pipeline    decode PAT, NIT and EIT on separate threads, with a separate output thread" << endl
+         << "  --dump-eit    print every decoded EIT table, next to collecting the EPG" << endl
+         << "  --no-section-cache  pass repeated sections on to the decoders" << endl
+         << "  --write-snapshot  write the collected EPG as a binary snapshot" << endl
+         << "  --snapshot    print the EPG from a binary snapshot instead of reading a transport stream" << endl
+         << "  --shared-memory  publish the EPG as it changes (at most once a second) in a POSIX shared memory" << endl
+         << "                segment of this name, for local processes to read without locking" << endl
+         << "                (several inputs or --chunks publish the merged EPG once, when all are read)" << endl
+         << "  --from-shared-memory  print the EPG published in shared memory instead of reading a transport stream"
+         << endl
+         << "  --now-next    print what is on now and next on every service, at a Unix time (default now)" << endl
+         << "  --grid        print all events overlapping the Unix time range [from, to)" << endl
+         << "  --search      print the events whose title or texts hold all these words; a word ending in * matches" << endl
+         << "                every word it starts (case and accents are ignored)" << endl
+         << "  --genre       only events of these genres in the now/next, grid or search: a comma separated list of" << endl
+         << "                movie, news, show, sports, children, music, arts, social, education, leisure, special," << endl
+         << "                user or numbers (content_nibble_level_1)" << endl
+         << "  --max-age     only events rated for this age or younger, or not rated, in the now/next, grid or search"
+         << endl
+         << "  --format      output format of the whole guide; the now/next, grid and search are text (default text)" << endl
+         << "  --log-level   libdvbpsi messages to report (default warn)" << endl
+         << "  --metrics     write metrics as a JSON line on exit and on SIGUSR1, to a file or stderr" << endl
+         << "  --interface   address of the interface to join a multicast group on" << endl
+         << "  --socket-buffer  socket receive buffer size for network input (default "
+         << UdpReceiver::DefaultSocketBufferSize << ")" << endl
+         << "  --idle-timeout   end network input after this many seconds without data, 0 for never (default "
+         << DefaultIdleTimeout << ")" << endl
+         << "  --eit-decoder decode EIT with the built-in decoder or with libdvbpsi (default native)" << endl
+         << "  --complete    report when the EIT tables are complete: a comma separated list of pf, schedule," << endl
+         << "                pf-other, schedule-other, actual or all (default actual)" << endl
+         << "  --stop-when-complete  stop reading once the EIT tables are complete (implies --complete)" << endl
+         << "  --timeout     stop reading after this many seconds" << endl
+         << "  --changes     write only the added, modified and removed events as they are decoded, instead of the" << endl
+         << "                guide at the end (text or json)" << endl
+         << "  --window      keep only the events from this many hours before to this many hours after the stream" << endl
+         << "                time from the TDT/TOT (default " << DefaultRetention.past / 3600 << ","
+         << DefaultRetention.future / 3600 << " with --max-memory)" << endl
+         << "  --max-memory  keep the EPG under this many MiB by cutting the far end of the window" << endl
+         << "  --index       read only the SI packets of a capture through its index <file>" << SiIndexSuffix
+         << ", and build" << endl
+         << "                the index while reading the whole file when there is no up to date one" << endl
+         << "  --chunks      scan one capture file as this many byte ranges in parallel, on --jobs threads" << endl
+         << "  --jobs        worker threads for several input files, merged into one EPG (default one per core);" << endl
+         << "                --pipeline is not used then" << endl
+         << "  Use - to read from stdin. Network input ends on SIGINT or SIGTERM, or when idle." << endl;
+}
+
+int main(int argc, char * argv[])
+{
+    ReadMode readMode = ReadMode::Auto;
+    size_t blockSize = TransportStreamReader::DefaultBlockSize;
+    PacketFormat packetFormat = PacketFormat::Unknown;
+    bool pipelined = false;
+    bool dumpEIT = false;
+    bool useSectionCache = true;
+    const char * inputPath = nullptr;
+    const char * snapshotPath = nullptr;
+    const char * writeSnapshotPath = nullptr;
+    const char * sharedMemoryName = nullptr;
+    const char * readSharedMemoryName = nullptr;
+    GuideQuery query {};
+    OutputFormat outputFormat = OutputFormat::Text;
+    dvbpsi_msg_level_t logLevel = DVBPSI_MSG_WARN;
+    bool metrics = false;
+    const char * metricsPath = nullptr;
+    string interfaceAddress;
+    int socketBufferSize = UdpReceiver::DefaultSocketBufferSize;
+    double idleTimeout = DefaultIdleTimeout;
+    unsigned jobs = max(1u, thread::hardware_concurrency());
+    bool nativeEIT = true;
+    unsigned completeTables = 0;
+    bool stopWhenComplete = false;
+    double timeout = 0;
+    bool changes = false;
+    bool useIndex = false;
+    unsigned chunks = 1;
+    bool retain = false;
+    EpgRetention retention = DefaultRetention;
+    vector<const char *> inputPaths;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string argument = argv[i];
+        if (argument.compare(0, 12, "--read-mode=") == 0)
+        {
+            if (!ParseReadMode(argv[i] + 12, readMode))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (argument.compare(0, 13, "--block-size=") == 0)
+        {
+            blockSize = strtoul(argv[i] + 13, nullptr, 0);
+        }
+        else if (argument.compare(0, 14, "--packet-size=") == 0)
+        {
+            if (!ParsePacketFormat(argv[i] + 14, packetFormat))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (argument == "--pipeline")
+        {
+            pipelined = true;
+        }
+        else if (argument == "--dump-eit")
+        {
+            dumpEIT = true;
+        }
+        else if (argument == "--no-section-cache")
+        {
+            useSectionCache = false;
+        }
+        else if (argument.compare(0, 17, "--write-snapshot=") == 0)
+        {
+            writeSnapshotPath = argv[i] + 17;
+        }
+        else if ((argument == "--now-next") || (argument.compare(0, 11, "--now-next=") == 0))
+        {
+            query.nowNext = true;
+            if (!ParseTime((argument == "--now-next") ? "now" : argv[i] + 11, query.nowTime))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (argument.compare(0, 7, "--grid=") == 0)
+        {
+            query.grid = true;
+            if (!ParseTimeRange(argv[i] + 7, query.gridFrom, query.gridTo))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (argument.compare(0, 8, "--genre=") == 0)
+        {
+            if (!ParseGenres(argv[i] + 8, query.genres))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (argument.compare(0, 10, "--max-age=") == 0)
+        {
+            unsigned long age = strtoul(argv[i] + 10, nullptr, 10);
+            if ((age < ParentalRatingDescriptor::MinimumAge(1)) ||
+                (age > ParentalRatingDescriptor::MinimumAge(ParentalRatingDescriptor::MaxAgeRating)))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+            query.maxRating = static_cast<uint8_t>(age - ParentalRatingDescriptor::MinimumAge(0));
+        }
+        else if (argument.compare(0, 9, "--search=") == 0)
+        {
+            query.search = argv[i] + 9;
+        }
+        else if (argument.compare(0, 9, "--format=") == 0)
+        {
+            if (!ParseOutputFormat(argv[i] + 9, outputFormat))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (argument.compare(0, 12, "--log-level=") == 0)
+        {
+            if (!ParseLogLevel(argv[i] + 12, logLevel))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if ((argument == "--metrics") || (argument.compare(0, 10, "--metrics=") == 0))
+        {
+            metrics = true;
+            metricsPath = (argument == "--metrics") ? nullptr : argv[i] + 10;
+        }
+        else if (argument.compare(0, 12, "--interface=") == 0)
+        {
+            interfaceAddress = argv[i] + 12;
+        }
+        else if (argument.compare(0, 16, "--socket-buffer=") == 0)
+        {
+            socketBufferSize = static_cast<int>(strtoul(argv[i] + 16, nullptr, 0));
+        }
+        else if (argument.compare(0, 15, "--idle-timeout=") == 0)
+        {
+            idleTimeout = strtod(argv[i] + 15, nullptr);
+        }
+        else if ((argument == "--complete") || (argument.compare(0, 11, "--complete=") == 0))
+        {
+            if (!EitCompleteness::ParseTables((argument == "--complete") ? "actual" : argv[i] + 11, completeTables))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (argument.compare(0, 14, "--eit-decoder=") == 0)
+        {
+            string decoder = argv[i] + 14;
+            if ((decoder != "native") && (decoder != "dvbpsi"))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+            nativeEIT = (decoder == "native");
+        }
+        else if (argument == "--stop-when-complete")
+        {
+            stopWhenComplete = true;
+        }
+        else if (argument.compare(0, 10, "--timeout=") == 0)
+        {
+            timeout = strtod(argv[i] + 10, nullptr);
+        }
+        else if (argument == "--changes")
+        {
+            changes = true;
+        }
+        else if (argument == "--index")
+        {
+            useIndex = true;
+        }
+        else if (argument.compare(0, 9, "--window=") == 0)
+        {
+            char * end = nullptr;
+            double before = strtod(argv[i] + 9, &end);
+            double after = (*end == ',') ? strtod(end + 1, &end) : -1;
+            if ((*end != '\0') || (before < 0) || (after <= 0))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+            retain = true;
+            retention.past = static_cast<uint32_t>(before * 3600);
+            retention.future = static_cast<uint32_t>(after * 3600);
+        }
+        else if (argument.compare(0, 13, "--max-memory=") == 0)
+        {
+            retain = true;
+            retention.maxBytes = static_cast<size_t>(strtoul(argv[i] + 13, nullptr, 0)) * 1024 * 1024;
+        }
+        else if (argument.compare(0, 9, "--chunks=") == 0)
+        {
+            chunks = max(1u, static_cast<unsigned>(strtoul(argv[i] + 9, nullptr, 0)));
+        }
+        else if (argument.compare(0, 7, "--jobs=") == 0)
+        {
+            jobs = max(1u, static_cast<unsigned>(strtoul(argv[i] + 7, nullptr, 0)));
+        }
+        else if (argument.compare(0, 11, "--snapshot=") == 0)
+        {
+            snapshotPath = argv[i] + 11;
+        }
+        else if (argument.compare(0, 16, "--shared-memory=") == 0)
+        {
+            sharedMemoryName = argv[i] + 16;
+        }
+        else if (argument.compare(0, 21, "--from-shared-memory=") == 0)
+        {
+            readSharedMemoryName = argv[i] + 21;
+        }
+        else if (argument.compare(0, 2, "--") == 0)
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+        else
+            inputPaths.push_back(argv[i]);
+    }
+    if (!inputPaths.empty())
+        inputPath = inputPaths[0];
+    if (stopWhenComplete && (completeTables == 0))
+        completeTables = EitCompleteness::Actual;
+    if ((completeTables != 0) && !useSectionCache)
+    {
+        cerr << "EIT completeness is tracked by the section cache, it cannot be combined with --no-section-cache"
+             << endl;
+        return 1;
+    }
+    if (query.Filtered() && !query.Any())
+    {
+        cerr << "--genre and --max-age filter the now/next, grid or search, they need --now-next, --grid or --search"
+             << endl;
+        return 1;
+    }
+    if (query.Any() && (outputFormat != OutputFormat::Text))
+    {
+        cerr << "The now/next, grid and search are written as text, they cannot be combined with --format="
+             << OutputFormatName(outputFormat) << endl;
+        return 1;
+    }
+    if (changes && (query.Any() || (outputFormat == OutputFormat::Xmltv)))
+    {
+        cerr << "The change feed is written as text or json, it cannot be combined with a guide query" << endl;
+        return 1;
+    }
+    if (snapshotPath || readSharedMemoryName)
+    {
+        if (inputPath || changes || sharedMemoryName || (snapshotPath && readSharedMemoryName))
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+        chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+        EpgSnapshot snapshot;
+        // A published guide is copied out, as the publisher may overwrite it while it is printed
+        vector<uint64_t> published;
+        if (snapshotPath && !snapshot.Open(snapshotPath))
+            return 1;
+        if (readSharedMemoryName)
+        {
+            SharedEpgReader reader;
+            if (!reader.Open(readSharedMemoryName))
+                return 1;
+            if (!reader.Read(published, snapshot))
+            {
+                cerr << "No EPG has been published to " << readSharedMemoryName << " yet" << endl;
+                return 1;
+            }
+        }
+        double openTime = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        if (query.Any())
+        {
+            EpgTimeIndex index;
+            index.Build(snapshot);
+            EpgTextIndex textIndex;
+            if (query.search)
+                textIndex.Build(snapshot);
+            EpgGenreIndex genreIndex;
+            if (query.grid && query.Filtered())
+                genreIndex.Build(index);
+            RunGuideQuery(index, &textIndex, &genreIndex, query,
+                          [&snapshot](uint32_t id) { return snapshot.String(id); }, cout);
+        }
+        else
+        {
+            OutputBuffer output(STDOUT_FILENO);
+            WriteEpg(snapshot, *CreateEpgSink(outputFormat, output));
+        }
+        cerr << (snapshotPath ? "Snapshot" : "Published EPG") << " holds " << snapshot.EventCount() << " events for "
+             << snapshot.ServiceCount() << " services, " << snapshot.Size() / 1024 << " KiB, opened in " << fixed
+             << setprecision(3) << openTime * 1000 << " ms" << endl;
+        return 0;
+    }
+    if (!inputPath)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+    if ((inputPaths.size() > 1) || (chunks > 1))
+    {
+        for (const char * path : inputPaths)
+        {
+            if (NetworkAddress::IsNetworkUrl(path) || (string(path) == "-"))
+            {
+                cerr << "Only files can be processed together or in chunks" << endl;
+                return 1;
+            }
+        }
+        vector<InputRange> inputs;
+        if (chunks > 1)
+        {
+            if ((inputPaths.size() > 1) || useIndex || retain)
+            {
+                cerr << "Only a single capture file without --index or --window can be scanned in chunks" << endl;
+                return 1;
+            }
+            if (!PlanChunks(inputPath, chunks, inputs))
+                return 1;
+        }
+        else
+        {
+            for (const char * path : inputPaths)
+                inputs.push_back(InputRange { path, 0, 0 });
+        }
+        InputSettings settings { readMode, blockSize, packetFormat, dumpEIT, useSectionCache, logLevel, metrics,
+                                 metricsPath, nativeEIT, completeTables, stopWhenComplete, timeout, useIndex,
+                                 retain ? &retention : nullptr };
+        EpgStore store;
+        streambuf * coutBuffer = cout.rdbuf();
+        if ((outputFormat != OutputFormat::Text) || changes)
+            cout.rdbuf(cerr.rdbuf());
+        // The inputs are merged into the store one after the other, so the feed reports what each adds
+        unique_ptr<EpgChangeFeed> feed(changes ? new EpgChangeFeed(outputFormat, STDOUT_FILENO) : nullptr);
+        store.SetChangeListener(feed.get());
+        // A search is a guide query, so there is never a change feed next to the text index
+        unique_ptr<EpgTextIndex> textIndex(query.search ? new EpgTextIndex : nullptr);
+        if (textIndex)
+            store.SetChangeListener(textIndex.get());
+        bool allOpened = ProcessInputs(inputs, jobs, settings, store);
+        // The inputs are read side by side and merged at the end, so there is only the merged EPG to publish
+        SharedEpgWriter publisher;
+        if (sharedMemoryName && (!publisher.Create(sharedMemoryName) || !publisher.Publish(store)))
+            return 1;
+        if (feed)
+        {
+            feed->Flush();
+            cerr << "Change feed: " << feed->Added() << " added, " << feed->Modified() << " modified, "
+                 << feed->Removed() << " removed" << endl;
+        }
+        else
+            WriteGuide(store, textIndex.get(), query, outputFormat, nullptr);
+        cout.rdbuf(coutBuffer);
+        if (textIndex)
+            PrintTextIndexSummary(*textIndex, cerr);
+        if (publisher.IsOpen())
+            PrintPublisherSummary(publisher, cerr);
+        cerr << "EPG holds " << store.EventCount() << " events for " << store.ServiceCount() << " services, "
+             << store.Strings().Count() << " distinct strings, " << store.MemoryUsage() / 1024 << " KiB" << endl;
+        if (writeSnapshotPath && !EpgSnapshot::Write(store, writeSnapshotPath))
+            return 1;
+        return allOpened ? 0 : 1;
+    }
+
+    bool network = NetworkAddress::IsNetworkUrl(inputPath);
+    bool useStdin = (string(inputPath) == "-");
+    if (useIndex && (network || useStdin))
+    {
+        cerr << "Only capture files can be indexed" << endl;
+        return 1;
+    }
+    int fileHandle = -1;
+    FileInput file;
+    unique_ptr<UdpReceiver> receiver;
+    if (network)
+    {
+        NetworkAddress address;
+        if (!NetworkAddress::Parse(inputPath, address))
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+        receiver.reset(new UdpReceiver);
+        if (!receiver->Open(address, interfaceAddress, socketBufferSize))
+            return 1;
+        receiver->SetIdleTimeout(idleTimeout);
+        InstallStopSignalHandler(*receiver);
+    }
+    else
+    {
+        fileHandle = useStdin ? STDIN_FILENO : open(inputPath, O_RDONLY);
+        if (fileHandle < 0)
+        {
+            cerr << "Cannot open " << inputPath << endl;
+            return 1;
+        }
+        OpenFileInput(fileHandle, inputPath, readMode, blockSize, packetFormat, useIndex, file);
+    }
+    PacketSource & source = network ? static_cast<PacketSource &>(*receiver) : file.Source();
+    const TransportStreamReader * reader = file.reader.get();
+
+    {
+        // Table dumps and decoder messages go through cout. With a machine readable format or a change feed stdout
+        // only carries the guide or the feed, so they are sent to stderr instead.
+        streambuf * coutBuffer = cout.rdbuf();
+        if ((outputFormat != OutputFormat::Text) || changes)
+            cout.rdbuf(cerr.rdbuf());
+        unique_ptr<EpgChangeFeed> feed(changes ? new EpgChangeFeed(outputFormat, STDOUT_FILENO) : nullptr);
+        TransportStreamParser parser(source, pipelined);
+        parser.SetChangeFeed(feed.get());
+        unique_ptr<EpgTextIndex> textIndex(query.search ? new EpgTextIndex : nullptr);
+        if (textIndex)
+            parser.SetTextIndex(textIndex.get());
+        SharedEpgWriter publisher;
+        if (sharedMemoryName)
+        {
+            if (!publisher.Create(sharedMemoryName))
+                return 1;
+            parser.SetPublisher(&publisher);
+        }
+        parser.SetIndexWriter(file.indexWriter.get());
+        parser.SetDumpEIT(dumpEIT);
+        parser.SetUseSectionCache(useSectionCache);
+        parser.SetLogLevel(logLevel);
+        parser.SetNativeEIT(nativeEIT);
+        if (completeTables != 0)
+            parser.TrackCompleteness(completeTables);
+        parser.SetStopWhenComplete(stopWhenComplete);
+        parser.SetTimeout(timeout);
+        if (retain)
+            parser.SetRetention(retention);
+        if (metrics)
+        {
+            InstallMetricsSignalHandler();
+            parser.SetMetricsCallback([&parser, metricsPath]() { DumpMetrics(parser, metricsPath); });
+        }
+        parser.Setup();
+        parser.Process();
+        parser.Cleanup();
+        FinishFileInput(file, fileHandle, cerr);
+        if (metrics)
+            DumpMetrics(parser, metricsPath);
+        const EpgStore & store = parser.Store();
+        SdtServiceNames names(parser.Subscriptions());
+        if (feed)
+            feed->Flush();
+        else
+            WriteGuide(store, textIndex.get(), query, outputFormat, &names);
+        cout.rdbuf(coutBuffer);
+
+        if (file.indexReader)
+            cerr << "Read " << source.PacketsRead() << " SI packets through the index (" << source.BytesConsumed()
+                 << " of " << file.indexReader->FileSize() << " bytes, " << file.indexReader->Reads() << " reads) in "
+                 << fixed << setprecision(3) << source.ElapsedSeconds() << " s: " << setprecision(1)
+                 << source.ThroughputMBps() << " MB/s" << endl;
+        else if (reader)
+            cerr << "Read " << reader->PacketsRead() << " packets (" << reader->BytesConsumed() << " bytes, "
+                 << reader->BytesSkipped() << " skipped) in " << fixed << setprecision(3) << reader->ElapsedSeconds()
+                 << " s using " << ReadModeName(reader->Mode()) << " input: " << setprecision(1)
+                 << reader->ThroughputMBps() << " MB/s" << endl
+                 << "Packet size " << PacketFormatName(reader->Format()) << ", " << reader->SyncLosses()
+                 << " sync losses (" << SyncScanner::KernelName() << " scanner)" << endl;
+        else
+            cerr << "Received " << receiver->PacketsRead() << " packets in " << receiver->Datagrams()
+                 << " datagrams (" << receiver->RtpDatagrams() << " RTP) in " << fixed << setprecision(3)
+                 << receiver->ElapsedSeconds() << " s: " << setprecision(1) << receiver->ThroughputMBps()
+                 << " MB/s" << endl
+                 << receiver->LostDatagrams() << " datagrams lost, " << receiver->ReorderedDatagrams()
+                 << " reordered, " << receiver->MalformedDatagrams() << " malformed, socket buffer "
+                 << receiver->SocketBufferSize() << " bytes" << endl;
+        const PidDispatcher & dispatcher = parser.Dispatcher();
+        cerr << "Dispatched " << dispatcher.DispatchedPackets() << " of " << dispatcher.TotalPackets()
+             << " packets, " << dispatcher.ActivePIDs() << " PIDs seen" << endl;
+        if (useSectionCache)
+            cerr << "Section cache dropped " << parser.SectionCacheHits() << " repeated sections, passed on "
+                 << parser.SectionCacheMisses() << endl;
+        const SubscriptionManager & subscriptions = parser.Subscriptions();
+        cerr << "Followed " << subscriptions.PATVersions() << " PAT versions (" << subscriptions.ProgramsAdded()
+             << " programs added, " << subscriptions.ProgramsRemoved() << " removed), "
+             << subscriptions.PMTUpdates() << " PMT and " << subscriptions.SDTUpdates() << " SDT updates, "
+             << subscriptions.Services().size() << " services";
+        if (subscriptions.HasNetworkId())
+            cerr << ", network " << subscriptions.NetworkId();
+        cerr << endl;
+        if (const EpgWindow * window = parser.Window())
+        {
+            if (parser.Clock().Now() == 0)
+                cerr << "EPG window not applied, the stream has no TDT or TOT" << endl;
+            else
+                cerr << "EPG window [" << window->From() << ", " << window->Until() << "), "
+                     << window->Evicted() << " events evicted, " << window->Compactions() << " compactions" << endl;
+        }
+        if (feed)
+            cerr << "Change feed: " << feed->Added() << " added, " << feed->Modified() << " modified, "
+                 << feed->Removed() << " removed" << endl;
+        if (textIndex)
+            PrintTextIndexSummary(*textIndex, cerr);
+        if (publisher.IsOpen())
+            PrintPublisherSummary(publisher, cerr);
+        cerr << "EPG holds " << store.EventCount() << " events for " << store.ServiceCount() << " services, "
+             << store.Strings().Count() << " distinct strings, " << store.MemoryUsage() / 1024 << " KiB" << endl;
+        if (writeSnapshotPath && !EpgSnapshot::Write(store, writeSnapshotPath))
+            return 1;
+    }
+
+    file = FileInput();
+    if (!network && !useStdin)
+        close(fileHandle);
 
     return 0;
-}
\ No newline at end of file
+}
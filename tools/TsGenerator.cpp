@@ -0,0 +1,431 @@
+#include "TsGenerator.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include "Crc32.h"
+#include "Section.h"
+
+using namespace std;
+
+namespace {
+
+const char * const TitleWords[] =
+{
+    "News", "Weather", "Late", "Night", "Show", "Football", "Live", "Documentary", "Planet", "Kitchen",
+    "Detective", "Quiz", "Music", "Concert", "Film", "Journey", "History", "Science", "Garden", "Comedy",
+};
+const size_t TitleWordCount = sizeof(TitleWords) / sizeof(TitleWords[0]);
+
+void Append16(vector<uint8_t> & data, uint16_t value)
+{
+    data.push_back(static_cast<uint8_t>(value >> 8));
+    data.push_back(static_cast<uint8_t>(value));
+}
+
+uint8_t ToBCD(unsigned value)
+{
+    return static_cast<uint8_t>(((value / 10) << 4) | (value % 10));
+}
+
+// Starts a long section; FinishSection fills in the length and CRC_32
+vector<uint8_t> StartSection(uint8_t tableId, uint16_t extension, uint8_t version, uint8_t sectionNumber,
+                             uint8_t lastSectionNumber)
+{
+    vector<uint8_t> section;
+    section.reserve(SectionHeader::MaxSectionSize);
+    section.push_back(tableId);
+    // section_syntax_indicator, reserved bits, length filled in later. SI tables other than the PAT set the
+    // private indicator bit.
+    section.push_back(tableId == 0x00 ? 0xB0 : 0xF0);
+    section.push_back(0);
+    Append16(section, extension);
+    section.push_back(static_cast<uint8_t>(0xC1 | ((version & 0x1F) << 1)));
+    section.push_back(sectionNumber);
+    section.push_back(lastSectionNumber);
+    return section;
+}
+
+void FinishSection(vector<uint8_t> & section)
+{
+    size_t length = section.size() + SectionHeader::CRCSize - SectionHeader::ShortHeaderSize;
+    section[1] = static_cast<uint8_t>((section[1] & 0xF0) | ((length >> 8) & 0x0F));
+    section[2] = static_cast<uint8_t>(length);
+    uint32_t crc = Crc32::Compute(section.data(), section.size());
+    section.push_back(static_cast<uint8_t>(crc >> 24));
+    section.push_back(static_cast<uint8_t>(crc >> 16));
+    section.push_back(static_cast<uint8_t>(crc >> 8));
+    section.push_back(static_cast<uint8_t>(crc));
+}
+
+void AppendDescriptor(vector<uint8_t> & data, uint8_t tag, const vector<uint8_t> & body)
+{
+    data.push_back(tag);
+    data.push_back(static_cast<uint8_t>(body.size()));
+    data.insert(data.end(), body.begin(), body.end());
+}
+
+void AppendText(vector<uint8_t> & data, const string & text)
+{
+    data.push_back(static_cast<uint8_t>(text.size()));
+    data.insert(data.end(), text.begin(), text.end());
+}
+
+} // namespace
+
+TsGeneratorOptions::TsGeneratorOptions()
+    : muxBitrate(38000000)
+    , siBitrate(2000000)
+    , duration(30)
+    , services(10)
+    , scheduleDays(7)
+    , eventMinutes(30)
+    , startTime(1704067200)     // 2024-01-01
+    , clockTime(0)
+    , nullRatio(0.5)
+    , corruptionRate(0)
+    , format(PacketFormat::TS188)
+    , seed(1)
+{
+}
+
+TsGenerator::TsGenerator(const TsGeneratorOptions & options)
+    : _options(options)
+    , _random(options.seed)
+    , _carousel()
+    , _carouselPosition(0)
+    , _continuityCounters()
+    , _sectionCount(0)
+    , _eventCount(0)
+    , _corruptedPackets(0)
+    , _nextVideoService(0)
+    , _clockSecond(0)
+    , _clockDue(false)
+{
+    _options.startTime -= _options.startTime % 86400;
+    _options.scheduleDays = min(_options.scheduleDays, 64u);
+    _options.eventMinutes = max(_options.eventMinutes, 1u);
+    _options.services = max(_options.services, 1u);
+    if (_options.format == PacketFormat::Unknown)
+        _options.format = PacketFormat::TS188;
+    if (_options.siBitrate > _options.muxBitrate)
+        _options.siBitrate = _options.muxBitrate;
+    BuildCarousel();
+}
+
+uint64_t TsGenerator::PacketCount() const
+{
+    return static_cast<uint64_t>(_options.duration * _options.muxBitrate / (SectionPacketizer::PacketSize * 8));
+}
+
+void TsGenerator::AddSection(SectionPacketizer & packetizer, vector<uint8_t> & section)
+{
+    FinishSection(section);
+    packetizer.Packetize(section.data(), section.size(), _carousel);
+    ++_sectionCount;
+}
+
+void TsGenerator::BuildCarousel()
+{
+    BuildPAT();
+    BuildNIT();
+    BuildEIT();
+}
+
+void TsGenerator::BuildPAT()
+{
+    SectionPacketizer packetizer(0x0000);
+    vector<uint8_t> section = StartSection(0x00, TransportStreamId, 0, 0, 0);
+    Append16(section, 0);
+    Append16(section, 0xE000 | NITPID);
+    for (unsigned service = 0; service < _options.services; ++service)
+    {
+        Append16(section, static_cast<uint16_t>(service + 1));
+        Append16(section, static_cast<uint16_t>(0xE000 | (FirstPMTPID + service)));
+    }
+    AddSection(packetizer, section);
+}
+
+void TsGenerator::BuildNIT()
+{
+    SectionPacketizer packetizer(NITPID);
+    vector<uint8_t> section = StartSection(0x40, NetworkId, 0, 0, 0);
+    vector<uint8_t> networkDescriptors;
+    string name = "Synthetic network";
+    AppendDescriptor(networkDescriptors, 0x40, vector<uint8_t>(name.begin(), name.end()));
+    Append16(section, static_cast<uint16_t>(0xF000 | networkDescriptors.size()));
+    section.insert(section.end(), networkDescriptors.begin(), networkDescriptors.end());
+
+    vector<uint8_t> serviceList;
+    for (unsigned service = 0; service < _options.services; ++service)
+    {
+        Append16(serviceList, static_cast<uint16_t>(service + 1));
+        serviceList.push_back(0x01);    // digital television
+    }
+    vector<uint8_t> transportDescriptors;
+    AppendDescriptor(transportDescriptors, 0x41, serviceList);
+    Append16(section, static_cast<uint16_t>(0xF000 | (6 + transportDescriptors.size())));
+    Append16(section, TransportStreamId);
+    Append16(section, NetworkId);
+    Append16(section, static_cast<uint16_t>(0xF000 | transportDescriptors.size()));
+    section.insert(section.end(), transportDescriptors.begin(), transportDescriptors.end());
+    AddSection(packetizer, section);
+}
+
+void TsGenerator::AppendEvent(vector<uint8_t> & section, unsigned service, uint32_t start)
+{
+    uint32_t duration = _options.eventMinutes * 60;
+    uint16_t eventId = static_cast<uint16_t>((start - _options.startTime) / duration);
+    Append16(section, eventId);
+    uint32_t mjd = start / 86400 + 40587;
+    Append16(section, static_cast<uint16_t>(mjd));
+    uint32_t seconds = start % 86400;
+    section.push_back(ToBCD(seconds / 3600));
+    section.push_back(ToBCD(seconds / 60 % 60));
+    section.push_back(ToBCD(seconds % 60));
+    section.push_back(ToBCD(duration / 3600));
+    section.push_back(ToBCD(duration / 60 % 60));
+    section.push_back(ToBCD(duration % 60));
+
+    // Titles repeat across days, like real schedules, so interning has work to do
+    unsigned slot = (start % 86400) / duration;
+    string title = string(TitleWords[(slot + service) % TitleWordCount]) + " " +
+                   TitleWords[(slot * 7 + service * 3) % TitleWordCount];
+    string text = "Episode " + to_string(eventId % 100) + " of " + title + ", on service " + to_string(service + 1);
+    vector<uint8_t> descriptors;
+    vector<uint8_t> body { 'e', 'n', 'g' };
+    AppendText(body, title);
+    AppendText(body, text);
+    AppendDescriptor(descriptors, 0x4D, body);
+
+    body.assign({ 0x00, 'e', 'n', 'g' });
+    vector<uint8_t> items;
+    AppendText(items, "Director");
+    AppendText(items, string(TitleWords[eventId % TitleWordCount]) + " Smith");
+    AppendText(items, "Year");
+    AppendText(items, to_string(1960 + eventId % 60));
+    body.push_back(static_cast<uint8_t>(items.size()));
+    body.insert(body.end(), items.begin(), items.end());
+    AppendText(body, "A longer description of " + title + ", with \xC2" "e and \xC8" "u accents in ISO 6937.");
+    AppendDescriptor(descriptors, 0x4E, body);
+
+    AppendDescriptor(descriptors, 0x54, { static_cast<uint8_t>(((slot % 11) + 1) << 4 | (eventId % 4)), 0x00 });
+    AppendDescriptor(descriptors, 0x55, { 'G', 'B', 'R', static_cast<uint8_t>(eventId % 16) });
+
+    // running_status 1 (not running), free_CA_mode 0
+    Append16(section, static_cast<uint16_t>(0x2000 | descriptors.size()));
+    section.insert(section.end(), descriptors.begin(), descriptors.end());
+    ++_eventCount;
+}
+
+void TsGenerator::BuildEIT()
+{
+    // Schedule: table 0x50 + n covers days 4n to 4n + 3, in 3 hour segments of 8 sections. Every segment is
+    // sent as one section, its first.
+    SectionPacketizer packetizer(EITPID);
+    uint32_t duration = _options.eventMinutes * 60;
+    unsigned tableCount = (_options.scheduleDays + 3) / 4;
+    uint8_t lastTableId = static_cast<uint8_t>(0x50 + (tableCount ? tableCount - 1 : 0));
+    for (unsigned service = 0; service < _options.services; ++service)
+    {
+        uint16_t serviceId = static_cast<uint16_t>(service + 1);
+
+        // Present/following, for the first two events of the schedule
+        for (uint8_t number = 0; number < 2; ++number)
+        {
+            vector<uint8_t> section = StartSection(0x4E, serviceId, 0, number, 1);
+            Append16(section, TransportStreamId);
+            Append16(section, NetworkId);
+            section.push_back(1);
+            section.push_back(0x4E);
+            AppendEvent(section, service, _options.startTime + number * duration);
+            AddSection(packetizer, section);
+        }
+
+        for (unsigned table = 0; table < tableCount; ++table)
+        {
+            unsigned days = min(4u, _options.scheduleDays - table * 4);
+            unsigned segments = days * 8;
+            uint8_t lastSection = static_cast<uint8_t>((segments - 1) * 8);
+            for (unsigned segment = 0; segment < segments; ++segment)
+            {
+                uint8_t sectionNumber = static_cast<uint8_t>(segment * 8);
+                vector<uint8_t> section = StartSection(static_cast<uint8_t>(0x50 + table), serviceId, 0,
+                                                       sectionNumber, lastSection);
+                Append16(section, TransportStreamId);
+                Append16(section, NetworkId);
+                section.push_back(sectionNumber);   // segment_last_section_number
+                section.push_back(lastTableId);
+                uint32_t segmentStart = _options.startTime + (table * 4 * 8 + segment) * 3 * 3600;
+                for (uint32_t start = segmentStart; start < segmentStart + 3 * 3600; start += duration)
+                {
+                    // Keep room for one more event and the CRC
+                    if (section.size() > SectionHeader::MaxSectionSize - 400)
+                        break;
+                    AppendEvent(section, service, start);
+                }
+                AddSection(packetizer, section);
+            }
+        }
+    }
+}
+
+void TsGenerator::BuildTDT(uint8_t * packet, uint32_t time)
+{
+    memset(packet, 0xFF, SectionPacketizer::PacketSize);
+    packet[0] = 0x47;
+    packet[1] = static_cast<uint8_t>(0x40 | (TDTPID >> 8));
+    packet[2] = static_cast<uint8_t>(TDTPID);
+    packet[3] = 0x10;
+    packet[4] = 0;      // pointer_field
+    // Short section: table_id, section_syntax_indicator 0, section_length 5, UTC_time
+    uint8_t * section = packet + 5;
+    section[0] = 0x70;
+    section[1] = 0x70;
+    section[2] = 0x05;
+    uint32_t mjd = time / 86400 + 40587;
+    section[3] = static_cast<uint8_t>(mjd >> 8);
+    section[4] = static_cast<uint8_t>(mjd);
+    uint32_t seconds = time % 86400;
+    section[5] = ToBCD(seconds / 3600);
+    section[6] = ToBCD(seconds / 60 % 60);
+    section[7] = ToBCD(seconds % 60);
+}
+
+void TsGenerator::NextPacket(uint8_t * packet, uint64_t index)
+{
+    if (_options.clockTime != 0)
+    {
+        uint64_t second = index * SectionPacketizer::PacketSize * 8 / _options.muxBitrate;
+        if ((index == 0) || (second != _clockSecond))
+        {
+            _clockSecond = second;
+            _clockDue = true;
+        }
+    }
+
+    // Spread the SI packets evenly: one every muxBitrate / siBitrate packets
+    uint64_t siBefore = index * _options.siBitrate / _options.muxBitrate;
+    uint64_t siAfter = (index + 1) * _options.siBitrate / _options.muxBitrate;
+    if ((siAfter > siBefore) && !_carousel.empty())
+    {
+        memcpy(packet, _carousel.data() + _carouselPosition, SectionPacketizer::PacketSize);
+        _carouselPosition += SectionPacketizer::PacketSize;
+        if (_carouselPosition >= _carousel.size())
+            _carouselPosition = 0;
+    }
+    else if (_clockDue)
+    {
+        // In the place of a padding packet, so the carousel timing stays the same
+        BuildTDT(packet, static_cast<uint32_t>(_options.clockTime + _clockSecond));
+        _clockDue = false;
+    }
+    else if (uniform_real_distribution<double>(0, 1)(_random) < _options.nullRatio)
+    {
+        memset(packet, 0xFF, SectionPacketizer::PacketSize);
+        packet[0] = 0x47;
+        packet[1] = 0x1F;
+        packet[2] = 0xFF;
+        packet[3] = 0x10;
+        return;
+    }
+    else
+    {
+        uint16_t pid = static_cast<uint16_t>(FirstVideoPID + _nextVideoService);
+        _nextVideoService = (_nextVideoService + 1) % _options.services;
+        packet[0] = 0x47;
+        packet[1] = static_cast<uint8_t>(pid >> 8);
+        packet[2] = static_cast<uint8_t>(pid);
+        packet[3] = 0x10;
+        // Payload that looks random enough, without paying for the random generator per byte
+        uint32_t value = static_cast<uint32_t>(_random());
+        for (size_t offset = 4; offset < SectionPacketizer::PacketSize; ++offset)
+        {
+            value = value * 1664525u + 1013904223u;
+            packet[offset] = static_cast<uint8_t>(value >> 24);
+        }
+    }
+    uint16_t pid = static_cast<uint16_t>(((packet[1] & 0x1F) << 8) | packet[2]);
+    packet[3] = static_cast<uint8_t>((packet[3] & 0xF0) | _continuityCounters[pid]);
+    _continuityCounters[pid] = (_continuityCounters[pid] + 1) & 0x0F;
+}
+
+void TsGenerator::AppendFramed(vector<uint8_t> & block, const uint8_t * packet, uint64_t index)
+{
+    if (_options.format == PacketFormat::M2TS192)
+    {
+        // TP_extra_header: copy permission 0, 30 bit arrival time stamp on a 27 MHz clock
+        uint32_t timestamp = static_cast<uint32_t>(index * SectionPacketizer::PacketSize * 8 * 27000000 /
+                                                   _options.muxBitrate) & 0x3FFFFFFF;
+        block.push_back(static_cast<uint8_t>(timestamp >> 24));
+        block.push_back(static_cast<uint8_t>(timestamp >> 16));
+        block.push_back(static_cast<uint8_t>(timestamp >> 8));
+        block.push_back(static_cast<uint8_t>(timestamp));
+    }
+    block.insert(block.end(), packet, packet + SectionPacketizer::PacketSize);
+    if (_options.format == PacketFormat::RS204)
+        block.insert(block.end(), 16, 0);   // Reed-Solomon parity, not computed
+}
+
+bool TsGenerator::Generate(const function<bool(const uint8_t * data, size_t size)> & write)
+{
+    static const size_t BlockSize = 1024 * 1024;
+    _carouselPosition = 0;
+    memset(_continuityCounters, 0, sizeof(_continuityCounters));
+    _random.seed(_options.seed);
+    _corruptedPackets = 0;
+    _clockSecond = 0;
+    _clockDue = false;
+
+    vector<uint8_t> block;
+    block.reserve(BlockSize + 256);
+    uint8_t packet[SectionPacketizer::PacketSize];
+    uniform_real_distribution<double> chance(0, 1);
+    uint64_t packetCount = PacketCount();
+    for (uint64_t index = 0; index < packetCount; ++index)
+    {
+        NextPacket(packet, index);
+        if ((_options.corruptionRate > 0) && (chance(_random) < _options.corruptionRate))
+        {
+            ++_corruptedPackets;
+            switch (_random() % 4)
+            {
+            case 0:     // Bit error in the payload
+                packet[4 + _random() % (SectionPacketizer::PacketSize - 4)] ^= static_cast<uint8_t>(1 << (_random() % 8));
+                break;
+            case 1:     // Lost packet
+                continue;
+            case 2:     // Uncorrectable error flagged by the demodulator
+                packet[1] |= 0x80;
+                break;
+            default:    // Garbage in front of the packet, so sync is lost
+                {
+                    size_t garbage = 1 + _random() % 100;
+                    for (size_t i = 0; i < garbage; ++i)
+                        block.push_back(static_cast<uint8_t>(_random() & 0x7F));
+                }
+                break;
+            }
+        }
+        AppendFramed(block, packet, index);
+        if (block.size() >= BlockSize)
+        {
+            if (!write(block.data(), block.size()))
+                return false;
+            block.clear();
+        }
+    }
+    return block.empty() || write(block.data(), block.size());
+}
+
+vector<uint8_t> TsGenerator::Generate()
+{
+    vector<uint8_t> stream;
+    stream.reserve(static_cast<size_t>(PacketCount() * PacketStride(_options.format)));
+    Generate([&stream](const uint8_t * data, size_t size)
+             {
+                 stream.insert(stream.end(), data, data + size);
+                 return true;
+             });
+    return stream;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <vector>
+#include "SectionPacketizer.h"
+#include "SyncScanner.h"
+
+struct TsGeneratorOptions
+{
+    uint64_t muxBitrate;        // bits/s of the whole mux
+    uint64_t siBitrate;         // bits/s of the PAT/NIT/EIT carousel
+    double duration;            // seconds of stream
+    unsigned services;
+    unsigned scheduleDays;      // EIT schedule depth, at most 64
+    unsigned eventMinutes;
+    uint32_t startTime;         // Unix time of the first scheduled event, rounded down to a day
+    uint32_t clockTime;         // Unix time in the TDT at the start of the stream, 0 for no TDT
+    double nullRatio;           // part of the non-SI packets that are null packets, the rest is "video"
+    double corruptionRate;      // chance per packet of a flipped byte, a lost packet, a TEI or inserted garbage
+    PacketFormat format;
+    uint32_t seed;
+
+    TsGeneratorOptions();
+};
+
+// Builds a synthetic transport stream: a PAT, a NIT and EIT present/following and schedule sections for a
+// number of services, carouselled at the SI bitrate between null and video packets, with optional corruption.
+// With a clock time, a TDT with the stream time goes out every second as well.
+// The output is the same for the same options.
+class TsGenerator
+{
+public:
+    static const uint16_t NITPID = 0x0010;
+    static const uint16_t EITPID = 0x0012;
+    static const uint16_t TDTPID = 0x0014;
+    static const uint16_t FirstPMTPID = 0x0100;
+    static const uint16_t FirstVideoPID = 0x0200;
+    static const uint16_t NetworkId = 0x3001;
+    static const uint16_t TransportStreamId = 0x0401;
+
+    explicit TsGenerator(const TsGeneratorOptions & options);
+
+    // Generates the stream, handing it to write in blocks. Stops early if write returns false.
+    bool Generate(const std::function<bool(const uint8_t * data, size_t size)> & write);
+    // Convenience for benchmarks: the whole stream in memory
+    std::vector<uint8_t> Generate();
+
+    uint64_t PacketCount() const;
+    size_t SectionCount() const { return _sectionCount; }
+    size_t EventCount() const { return _eventCount; }
+    size_t CarouselPackets() const { return _carousel.size() / SectionPacketizer::PacketSize; }
+    uint64_t CorruptedPackets() const { return _corruptedPackets; }
+
+private:
+    void BuildCarousel();
+    void BuildPAT();
+    void BuildNIT();
+    void BuildEIT();
+    void AddSection(SectionPacketizer & packetizer, std::vector<uint8_t> & section);
+    void AppendEvent(std::vector<uint8_t> & section, unsigned service, uint32_t start);
+    void BuildTDT(uint8_t * packet, uint32_t time);
+    void NextPacket(uint8_t * packet, uint64_t index);
+    void AppendFramed(std::vector<uint8_t> & block, const uint8_t * packet, uint64_t index);
+
+    TsGeneratorOptions _options;
+    std::mt19937 _random;
+    // SI packets for one turn of the carousel. Continuity counters are set when they are sent.
+    std::vector<uint8_t> _carousel;
+    size_t _carouselPosition;
+    uint8_t _continuityCounters[0x2000];
+    size_t _sectionCount;
+    size_t _eventCount;
+    uint64_t _corruptedPackets;
+    unsigned _nextVideoService;
+    // Second of stream time of the last TDT, and whether the TDT for the current second is still to be sent
+    uint64_t _clockSecond;
+    bool _clockDue;
+};
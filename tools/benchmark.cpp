@@ -0,0 +1,320 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Arena.h"
+#include "Crc32.h"
+#include "EitDecoder.h"
+#include "EpgSink.h"
+#include "EpgStore.h"
+#include "OutputBuffer.h"
+#include "PidDispatcher.h"
+#include "SectionAssembler.h"
+#include "SectionCache.h"
+#include "TransportStreamReader.h"
+#include "TsGenerator.h"
+
+using namespace std;
+
+namespace {
+
+class CountingSink : public PacketSink
+{
+public:
+    CountingSink() : packets(0) {}
+    void PushPacket(const uint8_t *) override { ++packets; }
+
+    uint64_t packets;
+};
+
+class SectionCollector : public SectionHandler
+{
+public:
+    SectionCollector() : sections(0), bytes(0), keep(false), collected() {}
+    void OnSection(const uint8_t * section, size_t size) override
+    {
+        ++sections;
+        bytes += size;
+        if (keep)
+            collected.emplace_back(section, section + size);
+    }
+
+    uint64_t sections;
+    uint64_t bytes;
+    bool keep;
+    vector<vector<uint8_t>> collected;
+};
+
+struct Result
+{
+    double seconds;
+    uint64_t bytes;
+    uint64_t items;
+};
+
+// Runs stage iterations times and keeps the fastest run
+Result Measure(int iterations, const function<Result()> & stage)
+{
+    Result best { 0, 0, 0 };
+    for (int i = 0; i < iterations; ++i)
+    {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        Result result = stage();
+        result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if ((i == 0) || (result.seconds < best.seconds))
+            best = result;
+    }
+    return best;
+}
+
+void Report(const string & name, const string & itemName, const Result & result)
+{
+    double seconds = (result.seconds > 0) ? result.seconds : 1e-9;
+    cout << left << setw(22) << name << right << fixed << setprecision(3) << setw(10) << result.seconds * 1000
+         << " ms" << setprecision(1) << setw(12) << result.bytes / seconds / 1000000 << " MB/s"
+         << setw(14) << setprecision(0) << result.items / seconds << " " << itemName << "/s" << endl;
+}
+
+void Usage(const char * program)
+{
+    cerr << "Usage: " << program << " [--iterations=<n>] [--input=<file>] [tsgen options]" << endl
+         << "  Times the reader, PID dispatch, section assembly, CRC, EIT parsing and decoding and output stages separately." << endl
+         << "  Without --input a stream is generated; --bitrate, --si-bitrate, --duration, --services, --days," << endl
+         << "  --event-minutes, --null-ratio, --corruption and --seed are passed to the generator." << endl;
+}
+
+} // namespace
+
+int main(int argc, char * argv[])
+{
+    TsGeneratorOptions options;
+    int iterations = 5;
+    const char * inputPath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string argument = argv[i];
+        size_t equals = argument.find('=');
+        if (equals == string::npos)
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+        string name = argument.substr(0, equals);
+        const char * value = argv[i] + equals + 1;
+        if (name == "--iterations")
+            iterations = max(1, atoi(value));
+        else if (name == "--input")
+            inputPath = value;
+        else if (name == "--bitrate")
+            options.muxBitrate = strtoull(value, nullptr, 0);
+        else if (name == "--si-bitrate")
+            options.siBitrate = strtoull(value, nullptr, 0);
+        else if (name == "--duration")
+            options.duration = strtod(value, nullptr);
+        else if (name == "--services")
+            options.services = static_cast<unsigned>(strtoul(value, nullptr, 0));
+        else if (name == "--days")
+            options.scheduleDays = static_cast<unsigned>(strtoul(value, nullptr, 0));
+        else if (name == "--event-minutes")
+            options.eventMinutes = static_cast<unsigned>(strtoul(value, nullptr, 0));
+        else if (name == "--null-ratio")
+            options.nullRatio = strtod(value, nullptr);
+        else if (name == "--corruption")
+            options.corruptionRate = strtod(value, nullptr);
+        else if (name == "--seed")
+            options.seed = static_cast<uint32_t>(strtoul(value, nullptr, 0));
+        else
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // The reader works on a file, so a generated stream is written to a temporary one
+    string path;
+    bool temporary = !inputPath;
+    if (temporary)
+    {
+        char name[] = "/tmp/dvbepg-benchmark-XXXXXX";
+        int fileHandle = mkstemp(name);
+        if (fileHandle < 0)
+        {
+            cerr << "Cannot create a temporary file" << endl;
+            return 1;
+        }
+        TsGenerator generator(options);
+        vector<uint8_t> stream = generator.Generate();
+        bool ok = (write(fileHandle, stream.data(), stream.size()) == static_cast<ssize_t>(stream.size()));
+        close(fileHandle);
+        path = name;
+        if (!ok)
+        {
+            cerr << "Cannot write " << path << endl;
+            unlink(path.c_str());
+            return 1;
+        }
+        cout << "Generated " << stream.size() / 1000000.0 << " MB: " << generator.PacketCount() << " packets, "
+             << generator.SectionCount() << " sections, " << generator.EventCount() << " events, "
+             << options.services << " services" << endl;
+    }
+    else
+        path = inputPath;
+
+    // Reader
+    vector<uint8_t> packets;
+    for (ReadMode mode : { ReadMode::Mmap, ReadMode::Buffered })
+    {
+        uint64_t checksum = 0;
+        Result result = Measure(iterations, [&path, mode, &checksum]()
+        {
+            int fileHandle = open(path.c_str(), O_RDONLY);
+            TransportStreamReader reader(fileHandle, mode);
+            const uint8_t * packet;
+            // Touch every packet header, like the dispatcher does
+            while ((packet = reader.NextPacket()) != nullptr)
+                checksum += packet[1] + packet[2];
+            close(fileHandle);
+            return Result { 0, reader.BytesConsumed(), reader.PacketsRead() };
+        });
+        Report(string("read (") + ReadModeName(mode) + ")", "packets", result);
+    }
+    {
+        int fileHandle = open(path.c_str(), O_RDONLY);
+        TransportStreamReader reader(fileHandle);
+        const uint8_t * packet;
+        while ((packet = reader.NextPacket()) != nullptr)
+            packets.insert(packets.end(), packet, packet + TransportStreamReader::PacketSize);
+        close(fileHandle);
+    }
+    if (temporary)
+        unlink(path.c_str());
+    size_t packetCount = packets.size() / TransportStreamReader::PacketSize;
+
+    // PID dispatch
+    Result result = Measure(iterations, [&packets, packetCount]()
+    {
+        PidDispatcher dispatcher;
+        CountingSink sink;
+        dispatcher.Subscribe(0x0000, &sink);
+        dispatcher.Subscribe(TsGenerator::NITPID, &sink);
+        dispatcher.Subscribe(TsGenerator::EITPID, &sink);
+        for (size_t i = 0; i < packetCount; ++i)
+            dispatcher.Dispatch(packets.data() + i * TransportStreamReader::PacketSize);
+        return Result { 0, packetCount * TransportStreamReader::PacketSize, packetCount };
+    });
+    Report("dispatch", "packets", result);
+
+    vector<const uint8_t *> eitPackets;
+    for (size_t i = 0; i < packetCount; ++i)
+    {
+        const uint8_t * packet = packets.data() + i * TransportStreamReader::PacketSize;
+        if (PidDispatcher::PacketPID(packet) == TsGenerator::EITPID)
+            eitPackets.push_back(packet);
+    }
+
+    // Section assembly, and assembly with the repeat cache
+    SectionCollector collector;
+    result = Measure(iterations, [&eitPackets, &collector]()
+    {
+        collector.sections = 0;
+        collector.bytes = 0;
+        SectionAssembler assembler(collector);
+        for (const uint8_t * packet : eitPackets)
+            assembler.PushPacket(packet);
+        return Result { 0, eitPackets.size() * TransportStreamReader::PacketSize, collector.sections };
+    });
+    Report("assemble", "sections", result);
+
+    collector.keep = true;
+    {
+        SectionAssembler assembler(collector);
+        for (const uint8_t * packet : eitPackets)
+            assembler.PushPacket(packet);
+    }
+    const vector<vector<uint8_t>> & sections = collector.collected;
+    uint64_t sectionBytes = 0;
+    for (const vector<uint8_t> & section : sections)
+        sectionBytes += section.size();
+
+    result = Measure(iterations, [&sections, sectionBytes]()
+    {
+        SectionCache cache;
+        uint64_t repeats = 0;
+        for (const vector<uint8_t> & section : sections)
+            repeats += cache.IsRepeat(section.data(), section.size()) ? 1 : 0;
+        return Result { 0, sectionBytes, sections.size() };
+    });
+    Report("section cache", "sections", result);
+
+    // CRC_32 of every section, slice-by-8 and one byte at a time
+    for (bool sliced : { true, false })
+    {
+        result = Measure(iterations, [&sections, sectionBytes, sliced]()
+        {
+            uint32_t crcs = 0;
+            for (const vector<uint8_t> & section : sections)
+                crcs ^= sliced ? Crc32::Compute(section.data(), section.size())
+                               : Crc32::ComputeBytewise(section.data(), section.size());
+            return Result { 0, sectionBytes + (crcs & 1), sections.size() };
+        });
+        Report(sliced ? "crc32 slice-by-8" : "crc32 bytewise", "sections", result);
+    }
+
+    // EIT parsing into arena spans, then decoding into the store: descriptor views, text conversion and interning
+    result = Measure(iterations, [&sections, sectionBytes]()
+    {
+        Arena arena;
+        uint64_t events = 0;
+        for (const vector<uint8_t> & section : sections)
+        {
+            EitSection parsed;
+            if (EitDecoder::Parse(section.data(), section.size(), arena, parsed))
+                events += parsed.eventCount;
+            arena.Reset();
+        }
+        return Result { 0, sectionBytes, events };
+    });
+    Report("parse EIT", "events", result);
+
+    EpgStore store;
+    result = Measure(iterations, [&sections, sectionBytes, &store]()
+    {
+        store.Clear();
+        Arena arena;
+        EventText text;
+        uint64_t events = 0;
+        for (const vector<uint8_t> & section : sections)
+        {
+            EitSection parsed;
+            if (EitDecoder::Parse(section.data(), section.size(), arena, parsed))
+                events += StoreEitSection(parsed, store, text);
+            arena.Reset();
+        }
+        return Result { 0, sectionBytes, events };
+    });
+    Report("decode EIT", "events", result);
+
+    // Output
+    int nullHandle = open("/dev/null", O_WRONLY);
+    for (OutputFormat format : { OutputFormat::Text, OutputFormat::Json, OutputFormat::Xmltv })
+    {
+        result = Measure(iterations, [&store, format, nullHandle]()
+        {
+            OutputBuffer output(nullHandle);
+            WriteEpg(store, *CreateEpgSink(format, output));
+            output.Flush();
+            return Result { 0, output.BytesWritten(), store.EventCount() };
+        });
+        Report(string("output (") + OutputFormatName(format) + ")", "events", result);
+    }
+    close(nullHandle);
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include "TsGenerator.h"
+
+using namespace std;
+
+void Usage(const char * program)
+{
+    TsGeneratorOptions defaults;
+    cerr << "Usage: " << program << " [--bitrate=<bits/s>] [--si-bitrate=<bits/s>] [--duration=<seconds>]" << endl
+         << "       [--services=<count>] [--days=<count>] [--event-minutes=<minutes>] [--start=<unix time>]" << endl
+         << "       [--clock=<unix time>] [--null-ratio=<0..1>] [--corruption=<0..1>] [--packet-size=188|192|204] [--seed=<n>]" << endl
+         << "       <file|->" << endl
+         << "  --bitrate        mux bitrate (default " << defaults.muxBitrate << ")" << endl
+         << "  --si-bitrate     bitrate of the PAT/NIT/EIT carousel (default " << defaults.siBitrate << ")" << endl
+         << "  --duration       stream length (default " << defaults.duration << ")" << endl
+         << "  --services       number of services (default " << defaults.services << ")" << endl
+         << "  --days           EIT schedule depth (default " << defaults.scheduleDays << ")" << endl
+         << "  --event-minutes  event length (default " << defaults.eventMinutes << ")" << endl
+         << "  --start          first day of the schedule (default " << defaults.startTime << ")" << endl
+         << "  --clock          stream time at the start, sent in a TDT every second (default none)" << endl
+         << "  --null-ratio     part of the padding sent as null packets instead of video (default "
+         << defaults.nullRatio << ")" << endl
+         << "  --corruption     chance per packet of a bit error, lost packet, TEI or garbage (default 0)" << endl
+         << "  Use - to write to stdout" << endl;
+}
+
+int main(int argc, char * argv[])
+{
+    TsGeneratorOptions options;
+    const char * outputPath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string argument = argv[i];
+        size_t equals = argument.find('=');
+        string name = argument.substr(0, equals);
+        const char * value = (equals != string::npos) ? argv[i] + equals + 1 : nullptr;
+        if (name.compare(0, 2, "--") != 0)
+        {
+            if (outputPath)
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+            outputPath = argv[i];
+        }
+        else if (!value)
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+        else if (name == "--bitrate")
+            options.muxBitrate = strtoull(value, nullptr, 0);
+        else if (name == "--si-bitrate")
+            options.siBitrate = strtoull(value, nullptr, 0);
+        else if (name == "--duration")
+            options.duration = strtod(value, nullptr);
+        else if (name == "--services")
+            options.services = static_cast<unsigned>(strtoul(value, nullptr, 0));
+        else if (name == "--days")
+            options.scheduleDays = static_cast<unsigned>(strtoul(value, nullptr, 0));
+        else if (name == "--event-minutes")
+            options.eventMinutes = static_cast<unsigned>(strtoul(value, nullptr, 0));
+        else if (name == "--start")
+            options.startTime = static_cast<uint32_t>(strtoul(value, nullptr, 0));
+        else if (name == "--clock")
+            options.clockTime = static_cast<uint32_t>(strtoul(value, nullptr, 0));
+        else if (name == "--null-ratio")
+            options.nullRatio = strtod(value, nullptr);
+        else if (name == "--corruption")
+            options.corruptionRate = strtod(value, nullptr);
+        else if (name == "--seed")
+            options.seed = static_cast<uint32_t>(strtoul(value, nullptr, 0));
+        else if (name == "--packet-size")
+        {
+            if (!ParsePacketFormat(value, options.format) || (options.format == PacketFormat::Unknown))
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!outputPath || (options.muxBitrate == 0))
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    bool useStdout = (string(outputPath) == "-");
+    int fileHandle = useStdout ? STDOUT_FILENO : open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fileHandle < 0)
+    {
+        cerr << "Cannot create " << outputPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    TsGenerator generator(options);
+    bool ok = generator.Generate([fileHandle](const uint8_t * data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t written = write(fileHandle, data, size);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    });
+    if (!ok)
+        cerr << "Write failed: " << strerror(errno) << endl;
+    if (!useStdout)
+        close(fileHandle);
+
+    cerr << "Generated " << generator.PacketCount() << " packets, " << generator.SectionCount() << " sections with "
+         << generator.EventCount() << " events (" << generator.CarouselPackets() << " packets per carousel), "
+         << generator.CorruptedPackets() << " corrupted packets" << endl;
+    return ok ? 0 : 1;
+}
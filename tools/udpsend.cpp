@@ -0,0 +1,166 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "TransportStreamReader.h"
+#include "UdpReceiver.h"
+
+using namespace std;
+
+// Sends a transport stream as UDP or RTP datagrams of 7 packets, the way an IP headend does, to feed dvbepg's
+// network input without a real multicast source.
+
+const size_t PacketsPerDatagram = 7;
+const size_t RtpHeaderSize = 12;
+// RTP payload type of MPEG-2 transport streams (RFC 3551)
+const uint8_t RtpPayloadTypeMP2T = 33;
+
+void Usage(const char * program)
+{
+    cerr << "Usage: " << program << " [--bitrate=<bits/s>] [--ttl=<hops>] [--drop=<0..1>] [--seed=<n>]" << endl
+         << "       <file|-> <udp://<address>:<port>|rtp://<address>:<port>>" << endl
+         << "  --bitrate  send rate, 0 sends as fast as possible (default 0)" << endl
+         << "  --ttl      multicast time to live (default 1)" << endl
+         << "  --drop     chance per datagram to leave it out, to test loss detection (default 0)" << endl
+         << "  Use - to read from stdin" << endl;
+}
+
+int main(int argc, char * argv[])
+{
+    uint64_t bitrate = 0;
+    int ttl = 1;
+    double dropRate = 0;
+    uint32_t seed = 1;
+    const char * inputPath = nullptr;
+    const char * destination = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string argument = argv[i];
+        if (argument.compare(0, 10, "--bitrate=") == 0)
+            bitrate = strtoull(argv[i] + 10, nullptr, 0);
+        else if (argument.compare(0, 6, "--ttl=") == 0)
+            ttl = atoi(argv[i] + 6);
+        else if (argument.compare(0, 7, "--drop=") == 0)
+            dropRate = strtod(argv[i] + 7, nullptr);
+        else if (argument.compare(0, 7, "--seed=") == 0)
+            seed = static_cast<uint32_t>(strtoul(argv[i] + 7, nullptr, 0));
+        else if (!inputPath)
+            inputPath = argv[i];
+        else if (!destination)
+            destination = argv[i];
+        else
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+    NetworkAddress address;
+    if (!inputPath || !destination || !NetworkAddress::Parse(destination, address) || address.host.empty())
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    bool useStdin = (string(inputPath) == "-");
+    int fileHandle = useStdin ? STDIN_FILENO : open(inputPath, O_RDONLY);
+    if (fileHandle < 0)
+    {
+        cerr << "Cannot open " << inputPath << endl;
+        return 1;
+    }
+    int udpSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (udpSocket < 0)
+    {
+        cerr << "Cannot create socket: " << strerror(errno) << endl;
+        return 1;
+    }
+    setsockopt(udpSocket, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    sockaddr_in target {};
+    target.sin_family = AF_INET;
+    target.sin_port = htons(address.port);
+    inet_pton(AF_INET, address.host.c_str(), &target.sin_addr);
+
+    uint64_t datagrams = 0;
+    uint64_t dropped = 0;
+    mt19937 random(seed);
+    uniform_real_distribution<double> chance(0.0, 1.0);
+    {
+        // The reader takes care of 192 and 204 byte framing, only 188 byte packets are sent
+        TransportStreamReader reader(fileHandle);
+        vector<uint8_t> datagram(RtpHeaderSize + PacketsPerDatagram * TransportStreamReader::PacketSize);
+        size_t headerSize = address.rtp ? RtpHeaderSize : 0;
+        uint32_t ssrc = random();
+        uint16_t sequenceNumber = 0;
+        chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+        uint64_t bytesSent = 0;
+        bool more = true;
+        while (more)
+        {
+            size_t packets = 0;
+            while (packets < PacketsPerDatagram)
+            {
+                const uint8_t * packet = reader.NextPacket();
+                if (!packet)
+                {
+                    more = false;
+                    break;
+                }
+                memcpy(datagram.data() + headerSize + packets * TransportStreamReader::PacketSize, packet,
+                       TransportStreamReader::PacketSize);
+                ++packets;
+            }
+            if (packets == 0)
+                break;
+            double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+            if (address.rtp)
+            {
+                // 90 kHz timestamp, as for any MPEG-2 TS payload
+                uint32_t timestamp = static_cast<uint32_t>(elapsed * 90000);
+                datagram[0] = 0x80;
+                datagram[1] = RtpPayloadTypeMP2T;
+                datagram[2] = static_cast<uint8_t>(sequenceNumber >> 8);
+                datagram[3] = static_cast<uint8_t>(sequenceNumber);
+                for (int i = 0; i < 4; ++i)
+                {
+                    datagram[4 + i] = static_cast<uint8_t>(timestamp >> (24 - 8 * i));
+                    datagram[8 + i] = static_cast<uint8_t>(ssrc >> (24 - 8 * i));
+                }
+                ++sequenceNumber;
+            }
+            size_t size = headerSize + packets * TransportStreamReader::PacketSize;
+            bytesSent += packets * TransportStreamReader::PacketSize;
+            ++datagrams;
+            if ((dropRate > 0) && (chance(random) < dropRate))
+                ++dropped;
+            else if (sendto(udpSocket, datagram.data(), size, 0, reinterpret_cast<const sockaddr *>(&target),
+                            sizeof(target)) < 0)
+            {
+                cerr << "Send failed: " << strerror(errno) << endl;
+                break;
+            }
+            if (bitrate > 0)
+            {
+                // Pace against the start time rather than per datagram, so sleep granularity does not add up
+                chrono::duration<double> due(static_cast<double>(bytesSent) * 8 / static_cast<double>(bitrate));
+                this_thread::sleep_until(startTime + chrono::duration_cast<chrono::steady_clock::duration>(due));
+            }
+        }
+    }
+    cerr << "Sent " << datagrams - dropped << " datagrams, dropped " << dropped << endl;
+
+    close(udpSocket);
+    if (!useStdin)
+        close(fileHandle);
+    return 0;
+}